@@ -0,0 +1,38 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec3 color;
+layout (location = 3) in vec2 uv;
+
+out struct fragment_data
+{
+    vec3 position;
+    vec3 normal;
+    vec3 color;
+    vec2 uv;
+	vec3 eye;
+} fragment;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+#ifdef LOGARITHMIC_DEPTH
+uniform float logDepthCoefficient; // 2 / log2(far + 1)
+#endif
+
+void main()
+{
+	fragment.position = vec3(model * vec4(position,1.0));
+	fragment.normal   = vec3(model * vec4(normal  ,0.0));
+	fragment.color = color;
+	fragment.uv = uv;
+	fragment.eye = vec3(inverse(view)*vec4(0,0,0,1.0));
+
+	gl_Position = projection * view * model * vec4(position, 1.0);
+#ifdef LOGARITHMIC_DEPTH
+	// Small objects only: the depth is interpolated linearly between the vertices
+	gl_Position.z = (log2(max(1e-6, 1.0 + gl_Position.w)) * logDepthCoefficient - 1.0) * gl_Position.w;
+#endif
+}
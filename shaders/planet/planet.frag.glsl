@@ -12,6 +12,10 @@ in struct fragment_data
 
 in vec3 localCoords;
 in vec3 localNormal;
+#ifdef LOGARITHMIC_DEPTH
+in float logDepthW;
+uniform float logDepthCoefficient; // 2 / log2(far + 1)
+#endif
 
 layout(location=0) out vec4 FragColor;
 
@@ -36,7 +40,7 @@ uniform vec3 steepColor;
 uniform vec3 flatLowColor;
 uniform vec3 flatHighColor;
 
-uniform bool isSun;
+// Compiled variants, see Planet::selectShaderVariants: SUN lights the inside of the sphere without specular
 
 vec4 colorFromTriplanarMapping() {
   vec2 uvxy = localCoords.xy / textureScale;
@@ -61,17 +65,20 @@ void main()
   vec3 normMap = normalize(vec3(textureSample) * 2.0f - 1.0f);
   vec3 N = normalize(fragment.normal);
   N = normalize(N + normMap * normalMapInfluence);
-  if (isSun)
-    N = -N;
+#ifdef SUN
+  N = -N;
+#endif
 	vec3 L = normalize(light-fragment.position);
 
 	float diffuse = max(dot(N,L),0.0);
 	float specular = 0.0;
-	if(diffuse>0.0 && !isSun){
+#ifndef SUN
+	if(diffuse>0.0){
 		vec3 R = reflect(-L,N);
 		vec3 V = normalize(fragment.eye-fragment.position);
 		specular = pow( max(dot(R,V),0.0), specular_exp );
 	}
+#endif
 
 
   vec4 color_image_texture=vec4(1.0,1.0,1.0,1.0);
@@ -92,4 +99,7 @@ void main()
 	vec3 color_shading = (Ka + Kd * diffuse) * color_object + Ks * specular * vec3(1.0, 1.0, 1.0);
 
 	FragColor = vec4(color_shading, alpha * color_image_texture.a);
+#ifdef LOGARITHMIC_DEPTH
+	gl_FragDepth = log2(logDepthW) * 0.5 * logDepthCoefficient;
+#endif
 }
@@ -1,9 +1,10 @@
 #version 330 core
 
-layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normal;
-layout (location = 2) in vec3 color;
-layout (location = 3) in vec2 uv;
+// Compact planet vertex, see PlanetVertex in src/planet_mesh_drawable.hpp
+layout (location = 0) in vec3 direction; // Unit sphere direction, shared by the planets of the same division
+layout (location = 1) in vec2 octNormal; // Octahedral encoded normal
+layout (location = 2) in float height;   // Normalized in heightRange
+layout (location = 3) in float slope;
 
 out struct fragment_data
 {
@@ -16,20 +17,42 @@ out struct fragment_data
 
 out vec3 localCoords;
 out vec3 localNormal;
+#ifdef LOGARITHMIC_DEPTH
+out float logDepthW; // 1 + w, the depth is computed per fragment
+#endif
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+uniform vec2 heightRange;  // Smallest and largest distance to the center of the planet
+uniform float planetRadius;
+
+vec3 octahedralDecode(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
 void main()
 {
+  float distanceToCenter = mix(heightRange.x, heightRange.y, height);
+  vec3 position = direction * distanceToCenter;
+  vec3 normal = octahedralDecode(octNormal);
+
   localCoords = position;
   localNormal = normal;
 	fragment.position = vec3(model * vec4(position,1.0));
 	fragment.normal   = vec3(model * vec4(normal  ,0.0));
-	fragment.color = color;
-	fragment.uv = uv;
+	fragment.color = vec3(distanceToCenter / (2.0 * planetRadius), slope, 0.0);
+	fragment.uv = vec2(0.0);
 	fragment.eye = vec3(inverse(view)*vec4(0,0,0,1.0));
 
 	gl_Position = projection * view * model * vec4(position, 1.0);
+#ifdef LOGARITHMIC_DEPTH
+  logDepthW = 1.0 + gl_Position.w;
+#endif
 }
@@ -0,0 +1,12 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 uv_frag;
+
+uniform sampler2D image_texture;
+
+void main()
+{
+    FragColor = vec4(texture(image_texture, uv_frag).rgb, 1.0);
+}
@@ -1,16 +1,18 @@
 #version 330 core
 
-out vec4 FragColor;
+// The pass is blended over the image: color = FragColor.rgb + color * FragColor.a
+layout(location=0) out vec4 FragColor;
+layout(location=1) out float ScatteringDepth; // Only written by the low resolution scattering pass
 
 in vec2 uv_frag;
 
-uniform sampler2D image_texture;
 uniform sampler2D image_texture_2; // Depth buffer
 
 uniform mat4 viewMatrix;
 uniform mat4 perspectiveInverse;
 uniform float near;
-uniform float far;
+uniform float far; // Distance returned when a ray hits nothing
+uniform bool logarithmicDepth = false;
 
 uniform vec4 worldPlanetCenter;
 uniform float planetRadius;
@@ -21,24 +23,37 @@ uniform float waterBlendMultiplier;
 uniform vec4 waterColorDeep;
 uniform vec4 waterColorSurface;
 
-uniform bool hasAtmosphere;
 uniform float atmosphereHeight;
 uniform int nScatteringPoints;
 uniform int nOpticalDepthPoints;
 uniform float densityFalloff;
 uniform vec3 scatteringCoeffs;
 
-uniform bool isSun;
-uniform bool waterGlow;
-uniform bool specularWater;
+// Compiled variants, see Planet::selectShaderVariants
+// SUN: lit from the inside, WATER_GLOW: emissive water, SPECULAR_WATER: sun reflection, ATMOSPHERE: scattering
+
+// 0: water and atmosphere at full resolution
+// 1: atmosphere only, rendered in the low resolution scattering target
+// 2: water at full resolution, atmosphere upsampled from the scattering target
+uniform int passMode = 0;
+uniform sampler2D scatteringImage;   // Inscattered light and transmittance
+uniform sampler2D scatteringDepth;   // View distance at which the scattering was evaluated
+uniform sampler2D scatteringHistory; // Previous frame scattering for the temporal accumulation
+uniform float scatteringJitter = 0.0;
+uniform float historyWeight = 0.0;
+uniform mat4 reprojection;           // Current camera space to previous frame clip space
+uniform vec4 historyBounds;          // Texture coordinates of the history written last frame
 
 
 uniform vec3 lightSource;
 
+// View distance from the depth buffer, see depth.cpp
 float LinearizeDepth(float depth)
 {
-    float z = depth * 2.0 - 1.0; // back to NDC
-    return (2.0 * near * far) / (far + near - z * (far - near));
+    if (logarithmicDepth)
+        return exp2(depth * log2(far + 1.0)) - 1.0;
+    // Reverse-Z with an infinite far plane: depth = near / distance
+    return near / max(depth, near / far);
 }
 
 vec2 raySphere(vec3 center, float radius, vec3 rayOrigin, vec3 rayDir) {
@@ -82,19 +97,21 @@ float opticalDepth(vec3 point, vec3 direction, float rayLength, vec3 planetCente
   return opticalDepth;
 }
 
-vec3 calculateLight(vec3 rayOrigin, vec3 rayDirection, float rayLength, vec3 planetCenter, vec3 lightPosition, vec3 originalColor) {
-  vec3 scatterPoint = rayOrigin;
-  float stepSize = rayLength / (nScatteringPoints - 1);
+vec4 calculateLight(vec3 rayOrigin, vec3 rayDirection, float rayLength, vec3 planetCenter, vec3 lightPosition) {
+  // With the temporal accumulation, the samples are spread over the frames by the jitter
+  float stepSize = historyWeight > 0 ? rayLength / nScatteringPoints : rayLength / (nScatteringPoints - 1);
+  vec3 scatterPoint = rayOrigin + rayDirection * stepSize * scatteringJitter;
   vec3 scatteredLight = vec3(0.0);
   float viewRayOpticalDepth = 0.0;
 
   for (int i = 0; i < nScatteringPoints; i++) {
     vec3 dirToSun = normalize(lightPosition-scatterPoint);
     float sunRayLength = raySphere(planetCenter, atmosphereHeight, scatterPoint, dirToSun).y;
-    if (isSun)
-      sunRayLength = min(sunRayLength, 1.0f);
+#ifdef SUN
+    sunRayLength = min(sunRayLength, 1.0f);
+#endif
     float sunRayOpticalDepth = opticalDepth(scatterPoint, dirToSun, sunRayLength, planetCenter);
-    viewRayOpticalDepth = opticalDepth(scatterPoint, -rayDirection, stepSize * i, planetCenter);
+    viewRayOpticalDepth = opticalDepth(scatterPoint, -rayDirection, stepSize * (i + scatteringJitter), planetCenter);
     vec3 transmittance = exp(-(sunRayOpticalDepth + viewRayOpticalDepth) * scatteringCoeffs);
     float localDensity = densityAtPoint(scatterPoint, planetCenter);
 
@@ -103,64 +120,128 @@ vec3 calculateLight(vec3 rayOrigin, vec3 rayDirection, float rayLength, vec3 pla
   }
   float originalColorTransmittance = exp(-viewRayOpticalDepth);
 
-  return scatteredLight + originalColor * originalColorTransmittance;
+  return vec4(scatteredLight, originalColorTransmittance);
+}
+
+// Depth aware upsampling of the low resolution scattering
+vec4 upsampleScattering(float depthFromCamera) {
+  ivec2 size = textureSize(scatteringImage, 0);
+  vec2 coord = uv_frag * vec2(size) - 0.5;
+  ivec2 base = ivec2(floor(coord));
+  vec2 f = fract(coord);
+
+  vec4 scattering = vec4(0.0);
+  float totalWeight = 0.0;
+  for (int j = 0; j < 2; j++) {
+    for (int i = 0; i < 2; i++) {
+      ivec2 texel = clamp(base + ivec2(i, j), ivec2(0), size - 1);
+      float bilinear = (i == 0 ? 1 - f.x : f.x) * (j == 0 ? 1 - f.y : f.y);
+      float sampleDepth = texelFetch(scatteringDepth, texel, 0).r;
+      float weight = bilinear * exp(-abs(sampleDepth - depthFromCamera) / (0.05 * depthFromCamera)) + 1e-5;
+      scattering += weight * texelFetch(scatteringImage, texel, 0);
+      totalWeight += weight;
+    }
+  }
+  return scattering / totalWeight;
 }
 
 void main() {
-    FragColor = texture(image_texture, uv_frag);
-    float depth = LinearizeDepth(texture(image_texture_2, uv_frag).r);
+    float depth;
+    if (passMode == 1) {
+      // Take the depth of a single full resolution texel, filtering it would mix the silhouettes
+      ivec2 texel = ivec2(uv_frag * vec2(textureSize(image_texture_2, 0)));
+      depth = LinearizeDepth(texelFetch(image_texture_2, texel, 0).r);
+    }
+    else {
+      depth = LinearizeDepth(texture(image_texture_2, uv_frag).r);
+    }
     vec3 direction = cameraDirection(2 * uv_frag - 1);
     vec3 camSpaceFrag = direction * depth / direction.z;
     float depthFromCamera = length(camSpaceFrag);
     vec3 camSpacePlanet = vec3(viewMatrix * worldPlanetCenter);
     vec3 camSpaceLight = vec3(viewMatrix * vec4(lightSource, 1.0));
 
+    // Light added to the image and attenuation of the image behind
+    vec3 added = vec3(0.0);
+    float multiplier = 1.0;
+
     // Water shader
     vec2 hitInfo = raySphere(camSpacePlanet, oceanLevel, vec3(0.0f, 0.0f, 0.0f), direction);
     float dstToOcean = hitInfo.x;
     float dstThroughOcean = hitInfo.y;
     float oceanViewDepth = min(dstThroughOcean, depthFromCamera - dstToOcean);
-    if (oceanViewDepth > 0) {
+    if (oceanViewDepth > 0 && passMode == 1) {
+      depthFromCamera = dstToOcean;
+    }
+    else if (oceanViewDepth > 0) {
       float opticalDepth = 1 - exp(-oceanViewDepth * depthMultiplier);
       vec4 oceanCol = mix(waterColorSurface, waterColorDeep, opticalDepth);
 
       float alpha = 1 - exp(-oceanViewDepth * oceanCol.w * waterBlendMultiplier);
-      vec3 color = mix(vec3(FragColor), vec3(oceanCol), alpha);
 
       vec3 camSpaceActual = direction * dstToOcean;
       vec3 N = normalize(camSpaceActual - camSpacePlanet);
-      if (isSun)
-        N = -N;
+#ifdef SUN
+      N = -N;
+#endif
       vec3 L = normalize(camSpaceLight - camSpaceActual);
-
       float diffuse = max(dot(N,L),0.0);
-      float specular = 0.0;
-      if(diffuse>0.0 && !isSun){
+
+      // Water color is mix(image, ocean, alpha), then lit
+#ifdef WATER_GLOW
+      float lighting = 1.0;
+#else
+      float lighting = diffuse + 0.05;
+#endif
+      added = vec3(oceanCol) * alpha * lighting;
+      multiplier = (1 - alpha) * lighting;
+#if defined(SPECULAR_WATER) && !defined(WATER_GLOW) && !defined(SUN)
+      if(diffuse>0.0){
         vec3 R = reflect(-L,N);
         vec3 V = normalize(-camSpaceActual);
         float specular_exp = 128;
-        specular = pow( max(dot(R,V),0.0), specular_exp );
+        added += vec3(1.0f, 1.0f, 1.0f) * pow( max(dot(R,V),0.0), specular_exp ) * 0.3;
       }
-
-      if (waterGlow)
-        FragColor = vec4(color, 1.0f);
-      else if (specularWater)
-        FragColor = vec4(color * (diffuse + 0.05)+ vec3(1.0f, 1.0f, 1.0f) * specular * 0.3, 1.0f);
-      else
-        FragColor = vec4(color * (diffuse + 0.05), 1.0f);
+#endif
       depthFromCamera = dstToOcean;
     }
 
-    if (hasAtmosphere) {
+    if (passMode == 2) {
+      vec4 scattering = upsampleScattering(depthFromCamera);
+      FragColor = vec4(scattering.rgb + added * scattering.a, multiplier * scattering.a);
+    }
+#ifdef ATMOSPHERE
+    else {
       // Atmosphere shader
       hitInfo = raySphere(camSpacePlanet, atmosphereHeight, vec3(0.0f, 0.0f, 0.0f), direction);
       float dstToAtmosphere = hitInfo.x;
       float dstThroughAtmosphere = hitInfo.y;
       float atmosphereViewDepth = min(dstThroughAtmosphere, depthFromCamera - dstToAtmosphere);
+      vec4 scattering = vec4(0.0, 0.0, 0.0, 1.0);
       if (atmosphereViewDepth > 0) {
         vec3 firstPointInAtmosphere = direction * dstToAtmosphere;
-        vec3 intensity = calculateLight(firstPointInAtmosphere, direction, atmosphereViewDepth, camSpacePlanet, camSpaceLight, vec3(FragColor));
-        FragColor = vec4(intensity, 1.0);
+        scattering = calculateLight(firstPointInAtmosphere, direction, atmosphereViewDepth, camSpacePlanet, camSpaceLight);
       }
+
+      if (passMode == 1) {
+        if (historyWeight > 0) {
+          // Reproject the middle of the atmosphere segment in the previous frame
+          float reprojectedDistance = atmosphereViewDepth > 0 ? dstToAtmosphere + 0.5 * atmosphereViewDepth : min(depthFromCamera, far);
+          vec4 previousClip = reprojection * vec4(direction * reprojectedDistance, 1.0);
+          vec2 previousUv = previousClip.xy / previousClip.w * 0.5 + 0.5;
+          if (previousClip.w > 0 && all(greaterThanEqual(previousUv, historyBounds.xy)) && all(lessThanEqual(previousUv, historyBounds.zw)))
+            scattering = mix(scattering, texture(scatteringHistory, previousUv), historyWeight);
+        }
+        FragColor = scattering;
+        ScatteringDepth = depthFromCamera;
+      }
+      else {
+        FragColor = vec4(scattering.rgb + added * scattering.a, multiplier * scattering.a);
+      }
+    }
+#else
+    else {
+      FragColor = vec4(added, multiplier);
     }
+#endif
 }
@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec3 starColor;
+
+layout(location=0) out vec4 FragColor;
+
+void main()
+{
+  // Round point fading on its border. No discard nor depth write, so the early depth test rejects the covered stars.
+  float falloff = 1.0 - smoothstep(0.5, 1.0, length(2.0 * gl_PointCoord - 1.0));
+  FragColor = vec4(starColor * falloff, 1.0);
+}
@@ -0,0 +1,23 @@
+#version 330 core
+
+layout (location = 0) in vec3 direction;
+layout (location = 1) in float magnitude;
+layout (location = 2) in vec3 color;
+
+out vec3 starColor;
+
+uniform mat4 view;       // Rotation of the camera only, the stars are at infinity
+uniform mat4 projection;
+uniform float skyDepth = 0.999999; // Depth of the sky: 0 with reverse-Z, 1 otherwise
+uniform float faintestMagnitude = 6.5;
+
+void main()
+{
+  // Flux relative to the faintest stars, 2.512 times more per magnitude
+  float flux = pow(10.0, -0.4 * (magnitude - faintestMagnitude));
+  gl_PointSize = clamp(sqrt(flux), 1.0, 5.0);
+  starColor = color * clamp(0.15 * flux, 0.1, 1.0);
+
+  gl_Position = projection * view * vec4(direction, 1.0);
+  gl_Position = vec4(gl_Position.x, gl_Position.y, gl_Position.w*skyDepth, gl_Position.w);
+}
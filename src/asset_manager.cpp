@@ -0,0 +1,107 @@
+#include "asset_manager.hpp"
+#include "mapped_file.hpp"
+#include "texture_container.hpp"
+#include "trace.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+using namespace vcl;
+
+AssetManager& assetManager() {
+    static AssetManager manager;
+    return manager;
+}
+
+// Must be called with the mutex locked
+std::shared_future<AssetManager::Image> AssetManager::decode(std::string const& path) {
+    auto const cached = images.find(path);
+    if (cached != images.end())
+        return cached->second;
+
+    counters.decodes++;
+    std::shared_future<Image> decoded = std::async(std::launch::async, [this, path]() {
+        TraceScope trace("image_load_png", path);
+        auto const start = std::chrono::steady_clock::now();
+        Image image = std::make_shared<image_raw const>(image_load_png(path));
+        std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.decodeMilliseconds += duration.count();
+        return image;
+    }).share();
+    images[path] = decoded;
+    return decoded;
+}
+
+void AssetManager::prefetch(std::vector<std::string> const& paths) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::string const& path : paths)
+        if (!std::ifstream(bakedTexturePath(path)).good())
+            decode(path);
+}
+
+AssetManager::Image AssetManager::image(std::string const& path) {
+    std::shared_future<Image> decoded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.imageRequests++;
+        decoded = decode(path);
+    }
+    return decoded.get();
+}
+
+AssetManager::Texture AssetManager::texture(std::string const& path, GLint wrapS, GLint wrapT) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.textureRequests++;
+        if (Texture texture = textures[std::make_tuple(path, wrapS, wrapT)].lock())
+            return texture;
+    }
+
+    // Only the GL thread creates textures, so nobody can insert the same one meanwhile
+    if (Texture texture = loadBaked(path, wrapS, wrapT))
+        return texture;
+
+    std::shared_future<Image> decoded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded = decode(path);
+    }
+    Texture texture = std::make_shared<gl_texture const>(opengl_texture_to_gpu(*decoded.get(), wrapS, wrapT));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.textureUploads++;
+    textures[std::make_tuple(path, wrapS, wrapT)] = texture;
+    images.erase(path);
+    return texture;
+}
+
+AssetManager::Texture AssetManager::loadBaked(std::string const& path, GLint wrapS, GLint wrapT) {
+    TraceScope trace("loadBaked", path);
+    auto const start = std::chrono::steady_clock::now();
+    std::string const bakedPath = bakedTexturePath(path);
+    MappedFile const file(bakedPath);
+    if (!file.valid())
+        return nullptr;
+    TextureView view;
+    if (!parseTextureContainer(file.data(), file.size(), view)) {
+        std::cerr << "Invalid baked texture " << bakedPath << ", falling back to " << path << std::endl;
+        return nullptr;
+    }
+    Texture texture = std::make_shared<gl_texture const>(uploadTextureContainer(view, wrapS, wrapT));
+    std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.textureUploads++;
+    counters.bakedLoads++;
+    counters.bakedMilliseconds += duration.count();
+    textures[std::make_tuple(path, wrapS, wrapT)] = texture;
+    return texture;
+}
+
+AssetStats AssetManager::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
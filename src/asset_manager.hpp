@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "gl_object.hpp"
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct AssetStats {
+    int decodes = 0;          // PNG files actually decoded
+    int imageRequests = 0;
+    int textureUploads = 0;   // Textures actually created
+    int textureRequests = 0;
+    float decodeMilliseconds = 0.0f; // Summed over the worker threads
+    int bakedLoads = 0;       // Textures read from a baked container instead of the PNG
+    float bakedMilliseconds = 0.0f;
+};
+
+// Images and textures loaded once per path and shared by all their users.
+// The PNG decodes run on worker threads, the textures are created on the thread of the OpenGL context.
+// A texture baked next to its PNG (see texture_container.hpp) is mapped and uploaded without any decode.
+class AssetManager {
+public:
+    using Image = std::shared_ptr<vcl::image_raw const>;
+    using Texture = std::shared_ptr<gl_texture const>;
+
+    // Start decoding in the background, so that the decodes overlap each other and the rest of the startup.
+    // Images having a baked texture are skipped.
+    void prefetch(std::vector<std::string> const& paths);
+
+    // Waits for the decode if it is still running
+    Image image(std::string const& path);
+
+    // The texture is deleted when its last user releases it.
+    // Its decoded image is dropped once uploaded, the GPU keeps the only copy.
+    Texture texture(std::string const& path, GLint wrapS = GL_CLAMP_TO_EDGE, GLint wrapT = GL_CLAMP_TO_EDGE);
+
+    AssetStats stats() const;
+
+private:
+    std::shared_future<Image> decode(std::string const& path);
+    Texture loadBaked(std::string const& path, GLint wrapS, GLint wrapT);
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_future<Image>> images;
+    std::map<std::tuple<std::string, GLint, GLint>, std::weak_ptr<gl_texture const>> textures;
+    AssetStats counters;
+};
+
+// Assets of the application
+AssetManager& assetManager();
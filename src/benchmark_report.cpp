@@ -0,0 +1,204 @@
+#include "benchmark_report.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+static std::string quoted(std::string const& text) {
+    std::string result = "\"";
+    for (char const c : text) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+std::string benchmarkJson(BenchmarkReport const& report) {
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\n  \"suite\": " << quoted(report.suite) << ",\n  \"threads\": " << report.threads << ",\n  \"results\": [";
+    for (size_t i = 0; i < report.results.size(); i++) {
+        BenchmarkResult const& result = report.results[i];
+        json << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << quoted(result.name) << ", \"value\": " << result.value
+            << ", \"unit\": " << quoted(result.unit) << ", \"lower_is_better\": " << (result.lowerIsBetter ? "true" : "false") << "}";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+// String value following "key": on the line, false when the key is absent
+static bool stringField(std::string const& line, char const* key, std::string& value) {
+    std::string const pattern = std::string("\"") + key + "\": \"";
+    size_t position = line.find(pattern);
+    if (position == std::string::npos)
+        return false;
+    value.clear();
+    for (position += pattern.size(); position < line.size() && line[position] != '"'; position++) {
+        if (line[position] == '\\' && position + 1 < line.size())
+            position++;
+        value += line[position];
+    }
+    return position < line.size();
+}
+
+static bool numberField(std::string const& line, char const* key, double& value) {
+    std::string const pattern = std::string("\"") + key + "\": ";
+    size_t const position = line.find(pattern);
+    if (position == std::string::npos)
+        return false;
+    char const* const start = line.c_str() + position + pattern.size();
+    char* end = nullptr;
+    value = std::strtod(start, &end);
+    return end != start;
+}
+
+bool parseBenchmarkJson(std::string const& text, BenchmarkReport& report) {
+    report = BenchmarkReport();
+    bool hasSuite = false;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        BenchmarkResult result;
+        double threads = 0.0;
+        if (stringField(line, "name", result.name)) {
+            if (!numberField(line, "value", result.value))
+                return false;
+            stringField(line, "unit", result.unit);
+            result.lowerIsBetter = line.find("\"lower_is_better\": true") != std::string::npos;
+            report.results.push_back(result);
+        }
+        else if (stringField(line, "suite", report.suite))
+            hasSuite = true;
+        else if (numberField(line, "threads", threads))
+            report.threads = (unsigned int)threads;
+    }
+    return hasSuite;
+}
+
+bool writeBenchmarkReport(std::string const& path, BenchmarkReport const& report) {
+    std::ofstream file(path);
+    file << benchmarkJson(report);
+    return bool(file);
+}
+
+bool readBenchmarkReport(std::string const& path, BenchmarkReport& report) {
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::string const text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return parseBenchmarkJson(text, report);
+}
+
+std::vector<BenchmarkChange> compareBenchmarks(BenchmarkReport const& baseline, BenchmarkReport const& current, double threshold) {
+    std::map<std::string, double> baselineValues;
+    for (BenchmarkResult const& result : baseline.results)
+        baselineValues[result.name] = result.value;
+
+    std::vector<BenchmarkChange> changes;
+    for (BenchmarkResult const& result : current.results) {
+        auto const previous = baselineValues.find(result.name);
+        if (previous == baselineValues.end() || previous->second <= 0.0 || result.value <= 0.0)
+            continue;
+        BenchmarkChange change;
+        change.name = result.name;
+        change.baseline = previous->second;
+        change.current = result.value;
+        change.improvement = result.lowerIsBetter ? change.baseline / change.current - 1.0 : change.current / change.baseline - 1.0;
+        change.regression = change.improvement < -threshold;
+        changes.push_back(change);
+    }
+    return changes;
+}
+
+int printBenchmarkComparison(std::string const& baselinePath, std::string const& currentPath, double threshold) {
+    BenchmarkReport baseline, current;
+    if (!readBenchmarkReport(baselinePath, baseline)) {
+        std::cerr << "Cannot read the benchmark report " << baselinePath << std::endl;
+        return -1;
+    }
+    if (!readBenchmarkReport(currentPath, current)) {
+        std::cerr << "Cannot read the benchmark report " << currentPath << std::endl;
+        return -1;
+    }
+
+    int regressions = 0;
+    for (BenchmarkChange const& change : compareBenchmarks(baseline, current, threshold)) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-56s %14.6g %14.6g %+7.1f%%%s", change.name.c_str(), change.baseline, change.current,
+            100.0 * change.improvement, change.regression ? "  REGRESSION" : "");
+        std::cout << line << std::endl;
+        regressions += change.regression ? 1 : 0;
+    }
+    std::cout << regressions << " regression(s) above " << 100.0 * threshold << "%" << std::endl;
+    return regressions;
+}
+
+static bool hasPlanetExtension(std::string const& name) {
+    return name.size() > 4 && name.compare(name.size() - 4, 4, ".pbf") == 0;
+}
+
+std::vector<std::string> planetFilesIn(std::string const& directory) {
+    std::vector<std::string> paths;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE const search = FindFirstFileA((directory + "/*.pbf").c_str(), &entry);
+    if (search != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && hasPlanetExtension(entry.cFileName))
+                paths.push_back(directory + "/" + entry.cFileName);
+        } while (FindNextFileA(search, &entry));
+        FindClose(search);
+    }
+#else
+    if (DIR* const entries = opendir(directory.c_str())) {
+        while (dirent const* const entry = readdir(entries))
+            if (hasPlanetExtension(entry->d_name))
+                paths.push_back(directory + "/" + entry->d_name);
+        closedir(entries);
+    }
+#endif
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+bool parseBenchmarkCommandLine(int argc, char** argv, std::string const& options, BenchmarkOption const& option, BenchmarkCommandLine& commandLine) {
+    for (int i = 1; i < argc; i++) {
+        std::string const argument = argv[i];
+        if (argument == "--compare" && i + 2 < argc) {
+            double threshold = 0.05;
+            if (i + 4 < argc && std::strcmp(argv[i + 3], "--threshold") == 0)
+                threshold = std::atof(argv[i + 4]) / 100.0;
+            int const regressions = printBenchmarkComparison(argv[i + 1], argv[i + 2], threshold);
+            commandLine.exitCode = regressions == 0 ? 0 : 1;
+            return false;
+        }
+        else if (argument == "--out" && i + 1 < argc)
+            commandLine.output = argv[++i];
+        else if (hasPlanetExtension(argument))
+            commandLine.planets.push_back(argument);
+        else if (!option(argc, argv, i)) {
+            std::cerr << "Usage: " << argv[0] << " [--out report.json] " << options << " [planet.pbf...]" << std::endl
+                << "       " << argv[0] << " --compare baseline.json current.json [--threshold percent]" << std::endl;
+            commandLine.exitCode = 1;
+            return false;
+        }
+    }
+    if (commandLine.planets.empty())
+        commandLine.planets = planetFilesIn("planets");
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Results of the benchmark tools, saved as JSON so that two runs can be compared
+
+struct BenchmarkResult {
+    std::string name;  // Unique in a report, as "perlinNoise/octaves=6/batch/threads=1"
+    double value = 0.0;
+    std::string unit;  // As "samples/s" or "ms"
+    bool lowerIsBetter = false;
+};
+
+struct BenchmarkReport {
+    std::string suite;
+    unsigned int threads = 0; // Hardware threads of the machine
+    std::vector<BenchmarkResult> results;
+};
+
+// One result per line, which is what parseBenchmarkJson expects
+std::string benchmarkJson(BenchmarkReport const& report);
+// Reads back the output of benchmarkJson, false when it is not a report
+bool parseBenchmarkJson(std::string const& text, BenchmarkReport& report);
+
+bool writeBenchmarkReport(std::string const& path, BenchmarkReport const& report);
+bool readBenchmarkReport(std::string const& path, BenchmarkReport& report);
+
+struct BenchmarkChange {
+    std::string name;
+    double baseline = 0.0;
+    double current = 0.0;
+    double improvement = 0.0; // Relative, positive when the current run is better whatever the unit
+    bool regression = false;  // Worse by more than the threshold
+};
+
+// Results present in both reports, in the order of the current one
+std::vector<BenchmarkChange> compareBenchmarks(BenchmarkReport const& baseline, BenchmarkReport const& current, double threshold);
+
+// Prints the comparison of two report files, returns the number of regressions or -1 when a file cannot be read
+int printBenchmarkComparison(std::string const& baselinePath, std::string const& currentPath, double threshold);
+
+// Every .pbf file of the directory, sorted by name, so that the benchmarks cover the planets actually shipped
+std::vector<std::string> planetFilesIn(std::string const& directory);
+
+
+// Command line of the benchmark tools:
+//   tool [--out report.json] [options of the tool] [planet.pbf...]
+//   tool --compare baseline.json current.json [--threshold percent]
+struct BenchmarkCommandLine {
+    std::string output;               // Keeps the default of the tool without --out
+    std::vector<std::string> planets; // Every .pbf of planets/ when none is given
+    int exitCode = 0;                 // Of the comparison or of a usage error
+};
+
+// Handles an option of the tool at argv[i], advancing i past its values. False for an unknown option.
+using BenchmarkOption = std::function<bool(int argc, char** argv, int& i)>;
+
+// False when the tool has nothing left to do and exits with exitCode: after the comparison, or after printing
+// the usage, where options describes the options of the tool
+bool parseBenchmarkCommandLine(int argc, char** argv, std::string const& options, BenchmarkOption const& option, BenchmarkCommandLine& commandLine);
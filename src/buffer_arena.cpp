@@ -0,0 +1,204 @@
+#include "buffer_arena.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace vcl;
+
+float ArenaStats::fragmentation() const {
+    size_t const free = capacity - used;
+    if (free == 0)
+        return 0.0f;
+    return 1.0f - float(largestFreeRange) / float(free);
+}
+
+
+RangeAllocator::RangeAllocator(size_t capacity) {
+    grow(capacity);
+}
+
+size_t RangeAllocator::allocate(size_t size) {
+    assert_vcl(size > 0, "Cannot allocate an empty range");
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < size)
+            continue;
+        size_t const offset = it->first;
+        size_t const remaining = it->second - size;
+        freeRanges.erase(it);
+        if (remaining > 0)
+            freeRanges[offset + size] = remaining;
+        allocations[offset] = size;
+        return offset;
+    }
+    return invalid;
+}
+
+void RangeAllocator::release(size_t offset) {
+    auto const allocation = allocations.find(offset);
+    assert_vcl(allocation != allocations.end(), "Release of a range that was not allocated");
+    size_t start = offset;
+    size_t size = allocation->second;
+    allocations.erase(allocation);
+
+    // Merge with the free range after, then with the one before
+    auto next = freeRanges.find(start + size);
+    if (next != freeRanges.end()) {
+        size += next->second;
+        freeRanges.erase(next);
+    }
+    auto previous = freeRanges.lower_bound(start);
+    if (previous != freeRanges.begin()) {
+        --previous;
+        if (previous->first + previous->second == start) {
+            start = previous->first;
+            size += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+    freeRanges[start] = size;
+}
+
+void RangeAllocator::grow(size_t capacity) {
+    if (capacity <= total)
+        return;
+    size_t start = total;
+    size_t size = capacity - total;
+    total = capacity;
+
+    // Extend the free range touching the old end
+    if (!freeRanges.empty()) {
+        auto last = std::prev(freeRanges.end());
+        if (last->first + last->second == start) {
+            start = last->first;
+            size += last->second;
+            freeRanges.erase(last);
+        }
+    }
+    freeRanges[start] = size;
+}
+
+ArenaStats RangeAllocator::stats() const {
+    ArenaStats stats;
+    stats.capacity = total;
+    stats.allocations = allocations.size();
+    stats.freeRanges = freeRanges.size();
+    for (auto const& allocation : allocations)
+        stats.used += allocation.second;
+    for (auto const& range : freeRanges)
+        stats.largestFreeRange = std::max(stats.largestFreeRange, range.second);
+    return stats;
+}
+
+
+// Copy the content of a buffer into a larger one
+static gl_buffer resizedBuffer(gl_buffer const& previous, size_t previousSize, size_t size) {
+    gl_buffer resized = gl_buffer::create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized.id()); opengl_check;
+    glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(size), nullptr, GL_STATIC_DRAW); opengl_check;
+    if (previous && previousSize > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, previous.id()); opengl_check;
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(previousSize)); opengl_check;
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return resized;
+}
+
+void MeshArena::initialize(size_t vertexCapacity, size_t indexCapacity) {
+    vertexArray = gl_vertex_array::create();
+    reserveVertices(vertexCapacity);
+    reserveIndices(indexCapacity);
+}
+
+void MeshArena::reserveVertices(size_t count) {
+    size_t const previous = vertexRanges.capacity();
+    vertices = resizedBuffer(vertices, previous * sizeof(ArenaVertex), count * sizeof(ArenaVertex));
+    vertexRanges.grow(count);
+    setVertexAttributes();
+}
+
+void MeshArena::reserveIndices(size_t count) {
+    size_t const previous = indexRanges.capacity();
+    indices = resizedBuffer(indices, previous * sizeof(GLuint), count * sizeof(GLuint));
+    indexRanges.grow(count);
+    setVertexAttributes();
+}
+
+// Same attribute locations as vcl::mesh_drawable, so the meshes keep their shaders
+void MeshArena::setVertexAttributes() {
+    if (!vertices || !indices)
+        return;
+    GLsizei const stride = sizeof(ArenaVertex);
+    glBindVertexArray(vertexArray.id()); opengl_check;
+    glBindBuffer(GL_ARRAY_BUFFER, vertices.id()); opengl_check;
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(ArenaVertex, position))); opengl_check;
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(ArenaVertex, normal))); opengl_check;
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(ArenaVertex, color))); opengl_check;
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(ArenaVertex, uv))); opengl_check;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.id()); opengl_check;
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+ArenaMesh MeshArena::add(mesh const& mesh) {
+    ArenaMesh range;
+    range.vertexCount = mesh.position.size();
+    range.indexCount = 3 * mesh.connectivity.size();
+
+    range.firstVertex = vertexRanges.allocate(range.vertexCount);
+    if (range.firstVertex == RangeAllocator::invalid) {
+        reserveVertices(std::max(2 * vertexRanges.capacity(), vertexRanges.capacity() + range.vertexCount));
+        range.firstVertex = vertexRanges.allocate(range.vertexCount);
+    }
+    range.firstIndex = indexRanges.allocate(range.indexCount);
+    if (range.firstIndex == RangeAllocator::invalid) {
+        reserveIndices(std::max(2 * indexRanges.capacity(), indexRanges.capacity() + range.indexCount));
+        range.firstIndex = indexRanges.allocate(range.indexCount);
+    }
+
+    std::vector<ArenaVertex> packed(range.vertexCount);
+    for (size_t i = 0; i < packed.size(); i++)
+        packed[i] = { mesh.position[i], mesh.normal[i], mesh.color[i], mesh.uv[i] };
+    glBindBuffer(GL_ARRAY_BUFFER, vertices.id()); opengl_check;
+    glBufferSubData(GL_ARRAY_BUFFER, GLintptr(range.firstVertex * sizeof(ArenaVertex)), GLsizeiptr(packed.size() * sizeof(ArenaVertex)), packed.data()); opengl_check;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The element buffer binding belongs to the vertex array
+    glBindVertexArray(vertexArray.id()); opengl_check;
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(range.firstIndex * sizeof(GLuint)), GLsizeiptr(range.indexCount * sizeof(GLuint)), &mesh.connectivity[0]); opengl_check;
+    glBindVertexArray(0);
+    return range;
+}
+
+void MeshArena::remove(ArenaMesh const& mesh) {
+    vertexRanges.release(mesh.firstVertex);
+    indexRanges.release(mesh.firstIndex);
+}
+
+void MeshArena::bind() const {
+    glBindVertexArray(vertexArray.id()); opengl_check;
+    frameStats.binds++;
+}
+
+void MeshArena::unbind() {
+    glBindVertexArray(0);
+}
+
+// The program and the scene uniforms are set by the caller, once for all the draws
+void MeshArena::draw(arena_mesh_drawable const& drawable, affine_rts const& transform) const {
+    assert_vcl(drawable.texture != 0, "Try to draw arena_mesh_drawable without texture");
+    opengl_uniform(drawable.shader, drawable.shading);
+    opengl_uniform(drawable.shader, "model", transform.matrix());
+
+    glActiveTexture(GL_TEXTURE0); opengl_check;
+    glBindTexture(GL_TEXTURE_2D, drawable.texture); opengl_check;
+    opengl_uniform(drawable.shader, "image_texture", 0); opengl_check;
+
+    void* const offset = reinterpret_cast<void*>(drawable.range.firstIndex * sizeof(GLuint));
+    glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(drawable.range.indexCount), GL_UNSIGNED_INT, offset, GLint(drawable.range.firstVertex)); opengl_check;
+    frameStats.draws++;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "gl_object.hpp"
+
+#include <map>
+
+struct ArenaStats {
+    size_t capacity = 0;         // In elements: vertices or indices
+    size_t used = 0;
+    size_t allocations = 0;
+    size_t freeRanges = 0;
+    size_t largestFreeRange = 0;
+
+    // 0 when the free space is one range, close to 1 when it is scattered in small ranges
+    float fragmentation() const;
+};
+
+// First-fit allocator of ranges in [0, capacity), the freed ranges are merged with their free neighbours.
+// Only does the bookkeeping, so it serves both the vertex and the index buffers and runs without a GPU.
+class RangeAllocator {
+public:
+    static const size_t invalid = size_t(-1);
+
+    explicit RangeAllocator(size_t capacity = 0);
+
+    size_t allocate(size_t size); // Offset of the range, invalid when no free range is large enough
+    void release(size_t offset);
+    void grow(size_t capacity);   // Add free space at the end
+
+    size_t capacity() const { return total; }
+    ArenaStats stats() const;
+
+private:
+    size_t total = 0;
+    std::map<size_t, size_t> freeRanges;  // Offset -> size
+    std::map<size_t, size_t> allocations; // Offset -> size
+};
+
+
+// Vertex layout of the meshes of the arena, the attributes of vcl::mesh_drawable interleaved
+struct ArenaVertex {
+    vcl::vec3 position;
+    vcl::vec3 normal;
+    vcl::vec3 color;
+    vcl::vec2 uv;
+};
+
+// Place of a mesh in the arena. Indices are relative to firstVertex, which is passed as base vertex.
+struct ArenaMesh {
+    size_t firstVertex = 0;
+    size_t vertexCount = 0;
+    size_t firstIndex = 0;
+    size_t indexCount = 0;
+};
+
+// Mesh of the arena with the uniforms of a vcl::mesh_drawable
+struct arena_mesh_drawable {
+    ArenaMesh range;
+    GLuint shader = 0;
+    GLuint texture = 0;
+    vcl::affine_rts transform;
+    vcl::shading_parameters_phong shading;
+};
+
+struct ArenaDrawStats {
+    unsigned int binds = 0; // Vertex array switches
+    unsigned int draws = 0;
+};
+
+// Small static meshes sub-allocated in one vertex buffer and one index buffer sharing a single vertex array,
+// instead of five buffers and a vertex array per mesh. Both buffers grow by doubling when full.
+// Every function must be called on the thread of the OpenGL context.
+class MeshArena {
+public:
+    MeshArena() {}
+    void initialize(size_t vertexCapacity, size_t indexCapacity);
+
+    ArenaMesh add(vcl::mesh const& mesh);
+    void remove(ArenaMesh const& mesh);
+
+    // Consecutive draws of the arena only need one bind
+    void bind() const;
+    void draw(arena_mesh_drawable const& drawable, vcl::affine_rts const& transform) const;
+    static void unbind();
+
+    ArenaStats vertexStats() const { return vertexRanges.stats(); }
+    ArenaStats indexStats() const { return indexRanges.stats(); }
+    ArenaDrawStats drawStats() const { return frameStats; }
+    void resetDrawStats() { frameStats = ArenaDrawStats(); }
+
+private:
+    void reserveVertices(size_t count);
+    void reserveIndices(size_t count);
+    void setVertexAttributes();
+
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    gl_buffer vertices;
+    gl_buffer indices;
+    gl_vertex_array vertexArray;
+    mutable ArenaDrawStats frameStats;
+};
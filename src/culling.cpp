@@ -0,0 +1,59 @@
+#include "culling.hpp"
+
+#include <cmath>
+
+float Plane::distance(vcl::vec3 const& p) const {
+    return vcl::dot(normal, p) + d;
+}
+
+static Plane planeFromRows(vcl::mat4 const& m, int row, float sign) {
+    Plane plane;
+    plane.normal = vcl::vec3(m(3, 0) + sign * m(row, 0), m(3, 1) + sign * m(row, 1), m(3, 2) + sign * m(row, 2));
+    plane.d = m(3, 3) + sign * m(row, 3);
+    return plane;
+}
+
+static Plane planeFromRow(vcl::mat4 const& m, int row) {
+    Plane plane;
+    plane.normal = vcl::vec3(m(row, 0), m(row, 1), m(row, 2));
+    plane.d = m(row, 3);
+    return plane;
+}
+
+static void normalize(Plane& plane) {
+    float const length = vcl::norm(plane.normal);
+    // The far plane of an infinite projection has no normal, it contains everything
+    if (length < 1e-12f)
+        return;
+    plane.normal /= length;
+    plane.d /= length;
+}
+
+Frustum extractFrustum(vcl::mat4 const& viewProjection, bool zeroToOneDepth) {
+    Frustum frustum;
+    frustum.planes[0] = planeFromRows(viewProjection, 0, 1.0f);  // -w <= x
+    frustum.planes[1] = planeFromRows(viewProjection, 0, -1.0f); // x <= w
+    frustum.planes[2] = planeFromRows(viewProjection, 1, 1.0f);  // -w <= y
+    frustum.planes[3] = planeFromRows(viewProjection, 1, -1.0f); // y <= w
+    if (zeroToOneDepth) {
+        // Reverse-Z: the near plane is z = w and the far plane z = 0
+        frustum.planes[4] = planeFromRows(viewProjection, 2, -1.0f);
+        frustum.planes[5] = planeFromRow(viewProjection, 2);
+    }
+    else {
+        frustum.planes[4] = planeFromRows(viewProjection, 2, 1.0f);
+        frustum.planes[5] = planeFromRows(viewProjection, 2, -1.0f);
+    }
+
+    for (Plane& plane : frustum.planes)
+        normalize(plane);
+    return frustum;
+}
+
+bool sphereInFrustum(Frustum const& frustum, vcl::vec3 const& center, float radius) {
+    for (Plane const& plane : frustum.planes) {
+        if (plane.distance(center) < -radius)
+            return false;
+    }
+    return true;
+}
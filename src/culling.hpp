@@ -0,0 +1,31 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+// Plane dot(normal, p) + d = 0, the inside is where dot(normal, p) + d >= 0
+struct Plane {
+    vcl::vec3 normal;
+    float d = 0.0f;
+
+    float distance(vcl::vec3 const& p) const;
+};
+
+// Left, right, bottom, top, near, far. Normalized when the plane is not at infinity.
+struct Frustum {
+    Plane planes[6];
+};
+
+// Objects tested against the frustum during the current frame
+struct CullingStats {
+    int tested = 0;
+    int culled = 0;
+    unsigned int submittedTriangles = 0; // Triangles left after the cluster culling of the drawn planets
+    unsigned int totalTriangles = 0;
+};
+
+// Planes of the frustum of the matrix projection * view, in world space.
+// zeroToOneDepth is the clip control depth range [0, 1], otherwise the OpenGL default [-1, 1].
+Frustum extractFrustum(vcl::mat4 const& viewProjection, bool zeroToOneDepth);
+
+// Conservative: a sphere outside of the frustum but near one of its corners is kept
+bool sphereInFrustum(Frustum const& frustum, vcl::vec3 const& center, float radius);
@@ -0,0 +1,37 @@
+#include "depth.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+vcl::mat4 projectionForDepth(DepthSettings const& depth, float fov, float aspect) {
+    if (depth.mode == DepthMode::Logarithmic)
+        return vcl::projection_perspective(fov, aspect, depth.nearPlane, depth.farPlane);
+
+    // Infinite far plane, clip z is the near distance so that depth = near / distance
+    float const fy = 1 / std::tan(fov / 2);
+    float const fx = fy / aspect;
+    return vcl::mat4{
+        fx, 0, 0, 0,
+        0, fy, 0, 0,
+        0, 0, 0, depth.nearPlane,
+        0, 0, -1, 0
+    };
+}
+
+float logDepthCoefficient(DepthSettings const& depth) {
+    if (depth.mode == DepthMode::Logarithmic)
+        return 2.0f / std::log2(depth.farPlane + 1.0f);
+    return 0.0f;
+}
+
+float windowDepth(DepthSettings const& depth, float viewDistance) {
+    if (depth.mode == DepthMode::Logarithmic)
+        return std::log2(1.0f + viewDistance) * 0.5f * logDepthCoefficient(depth);
+    return depth.nearPlane / viewDistance;
+}
+
+float linearizeDepth(DepthSettings const& depth, float windowDepth) {
+    if (depth.mode == DepthMode::Logarithmic)
+        return std::exp2(windowDepth * std::log2(depth.farPlane + 1.0f)) - 1.0f;
+    return depth.nearPlane / std::max(windowDepth, depth.nearPlane / depth.farPlane);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+// How a single depth buffer covers the whole solar system, from the ground under the player to the farthest planet
+enum class DepthMode {
+    ReverseZ,   // Floating point depth, 1 at the near plane and 0 at infinity. Needs clip control.
+    Logarithmic // Fallback: depth is log2(1 + w) written by the LOGARITHMIC_DEPTH shader variants
+};
+
+struct DepthSettings {
+    DepthMode mode = DepthMode::ReverseZ;
+    float nearPlane = 0.1f;
+    float farPlane = 1000000.0f; // Only bounds the logarithmic depth, reverse-Z has no far plane
+};
+
+vcl::mat4 projectionForDepth(DepthSettings const& depth, float fov, float aspect);
+
+// 2 / log2(far + 1) for the logarithmic depth shaders, 0 for reverse-Z
+float logDepthCoefficient(DepthSettings const& depth);
+
+// Value stored in the depth buffer for a point at the given distance in front of the camera, and its inverse.
+// linearizeDepth mirrors LinearizeDepth in shaders/planet/water.frag.glsl.
+float windowDepth(DepthSettings const& depth, float viewDistance);
+float linearizeDepth(DepthSettings const& depth, float windowDepth);
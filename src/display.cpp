@@ -2,25 +2,24 @@
 #include "display.hpp"
 #include "vegetation.hpp"
 #include "planet.hpp"
+#include "profiler.hpp"
+#include "gl_task_queue.hpp"
 #include <algorithm>
 
+static void opengl_uniform(GLuint shader, scene_environment const& current_scene);
+
 
 using namespace vcl;
 
-void buildFrustrsums(scene_environment& scene, unsigned int width, unsigned int height, float interPlane) {
-	float farPlane = 10000.0f;
-	float nearPlane = 0.1f;
+void buildProjection(scene_environment& scene, unsigned int width, unsigned int height) {
 	float const aspect = width / static_cast<float>(height);
-	scene.farProjection = projection_perspective(pi / 3, aspect, interPlane, farPlane);
-	scene.nearProjection = projection_perspective(pi / 3, aspect, nearPlane, interPlane);
-	Planet::interPlane = interPlane;
-	Planet::nearPlane = nearPlane;
-	Planet::farPlane = farPlane;
+	scene.projection = projectionForDepth(scene.depth, pi / 3, aspect);
 }
 
 struct SortingPlanet {
 	Planet* pointer;
 	float distance;
+	ScreenRect rect; // Region of the screen covered by the planet and its atmosphere
 
 	SortingPlanet(Planet* planet, float distance) {
 		pointer = planet;
@@ -33,8 +32,23 @@ bool operator<(const SortingPlanet& first, const SortingPlanet& second)
 	return first.distance < second.distance;
 }
 
-static void drawPlant(const scene_environment& scene, hierarchy_mesh_drawable& plant, Planet& planet, vcl::vec3 position, float alpha, float scale) {
-	plant["troncon 0"].transform.translate = planet.getPlanetRadiusAt(position) * 0.999f;
+// Compute the screen rectangle of each planet and drop the ones that do not cover any pixel
+static void computeScreenRects(scene_environment& scene, std::vector<SortingPlanet>& planets, float nearPlane, float width, float height) {
+	mat4 const view = scene.camera.matrix_view();
+	for (SortingPlanet& planet : planets) {
+		vec4 const center = view * vec4(planet.pointer->getPosition(), 1.0f);
+		planet.rect = projectedSphereRect(vec3(center.x, center.y, center.z), planet.pointer->getBoundingRadius(), scene.projection, nearPlane, (unsigned int)width, (unsigned int)height);
+	}
+	size_t const count = planets.size();
+	planets.erase(std::remove_if(planets.begin(), planets.end(), [](SortingPlanet const& planet) { return !planet.rect.visible; }), planets.end());
+	scene.culling.culled += int(count - planets.size());
+}
+
+// The arena is bound and the scene uniforms are set by the caller.
+// position is the direction of the plant from the center of the planet, ground the point of the surface below it.
+static void drawPlant(const scene_environment& scene, Plant& plantMeshes, Planet& planet, vcl::vec3 position, vcl::vec3 ground, float alpha, float scale) {
+	hierarchy_mesh_drawable& plant = plantMeshes.hierarchy;
+	plant["troncon 0"].transform.translate = ground * 0.999f;
 	if (vcl::norm(plant["troncon 0"].transform.translate + planet.getPosition()) > 15.0f) {
 		return;
 	}
@@ -50,97 +64,114 @@ static void drawPlant(const scene_environment& scene, hierarchy_mesh_drawable& p
 	plant["troncon 0"].transform.scale = scale;
 	plant["troncon 0"].transform = planet.visual.transform * plant["troncon 0"].transform;
 	plant.update_local_to_global_coordinates();
-	draw(plant, scene);
+	for (size_t k = 0; k < plantMeshes.segments.size(); k++) {
+		arena_mesh_drawable const& segment = plantMeshes.segments[k];
+		scene.meshArena.draw(segment, plant.elements[k].global_transform * segment.transform);
+	}
 }
 
 
-void display_scene(scene_environment& scene, float time, float width, float height) {
-	plantAnimation(scene.plant, time * 0.5f);
-
-	scene.light = scene.planets[0].getPosition();
-
-	// Find the planet close to the player if it exists
-	// Create an adaptative frustrum for the multipass render
-	std::vector<SortingPlanet> farPlanets;
-	std::vector<int> nearPlanetIndices;
-	float separatingPlane = midDistance;
-	for (int i = 0; i < scene.planets.size(); i++) {
-		//float dist = vcl::norm(scene.planets[i].getPosition() - scene.camera.position());
-		float dist = vcl::norm(scene.planets[i].getPosition() - scene.camera.position());
-		float changeDist = scene.planets[i].radius * (scene.planets[i].hasAtmosphere ? std::max(scene.planets[i].atmosphereHeight, 1.3f) : 1.3f);
-		if (dist > separatingPlane + changeDist || !CAMERA_TYPE) {
-			if (dot(scene.camera.front(), scene.planets[i].getPosition()) > 0 || !CAMERA_TYPE)
-				farPlanets.push_back(SortingPlanet(&scene.planets[i], dist));
-		}
-		else {
-			nearPlanetIndices.push_back(i);
-			if (dist > separatingPlane - changeDist)
-				separatingPlane += changeDist;
+// Planets whose terrain or atmosphere is in the frustum, sorted from the closest
+static std::vector<SortingPlanet> visiblePlanets(scene_environment& scene, float width, float height) {
+	ProfileZone zone("Culling");
+	Frustum const frustum = extractFrustum(scene.projection * scene.camera.matrix_view(), scene.depth.mode == DepthMode::ReverseZ);
+	scene.culling = CullingStats();
+	std::vector<SortingPlanet> planets;
+	for (size_t i = 0; i < scene.planets.size(); i++) {
+		scene.culling.tested++;
+		if (!sphereInFrustum(frustum, scene.planets[i].getPosition(), scene.planets[i].getBoundingRadius())) {
+			scene.culling.culled++;
+			continue;
 		}
+		float dist = vcl::norm(scene.planets[i].getPosition() - scene.camera.position());
+		planets.push_back(SortingPlanet(&scene.planets[i], dist));
 	}
+	computeScreenRects(scene, planets, scene.depth.nearPlane, width, height);
+	std::sort(planets.begin(), planets.end());
+	return planets;
+}
 
-	if (nearPlanetIndices.empty())
-		buildFrustrsums(scene, width, height, midDistance);
-	else {
-		buildFrustrsums(scene, width, height, separatingPlane);
-	}
+void display_scene(scene_environment& scene, float time, float width, float height) {
+	plantAnimation(scene.plant.hierarchy, time * 0.5f);
+	scene.meshArena.resetDrawStats();
 
+	scene.light = scene.planets[0].getPosition();
 
-	std::sort(farPlanets.begin(), farPlanets.end());
+	// Every planet is rendered in a single pass, the depth buffer covers the whole system.
+	// Only the planets whose terrain or atmosphere is in the frustum are drawn and post processed.
+	std::vector<SortingPlanet> const planets = visiblePlanets(scene, width, height);
 
-	// Render all the distant planets on the screen
-	scene.projection = scene.farProjection;
-	Planet::startPlanetRendering();
-	for (int i = 0; i < farPlanets.size(); i++) {
-		farPlanets[i].pointer->renderPlanet(scene, farPlanets[i].distance > 200.0f);
+	Planet::startPlanetRendering(scene.depth);
+	for (size_t i = 0; i < planets.size(); i++) {
+		Planet* planet = planets[i].pointer;
+		{
+			ProfileZone zone("Terrain", true);
+			planet->renderPlanet(scene, planets[i].distance > 200.0f, &scene.culling);
+		}
+		if (planet == &scene.planets[2] && planets[i].distance < planet->getBoundingRadius() + vegetationDistance) {
+			ProfileZone zone("Plants", true);
+			GLuint const plantShader = scene.plant.segments[0].shader;
+			glUseProgram(plantShader);
+			opengl_uniform(plantShader, scene);
+			scene.meshArena.bind();
+			// The baked anchors replace the random directions, and their surface is not evaluated every frame
+			std::vector<vec3> const& anchors = planet->vegetationAnchors();
+			for (size_t j = 0; j < scene.plantInfos[0].size(); j++) {
+				if (!anchors.empty() && j >= anchors.size())
+					break;
+				vec3 pos = vcl::vec3(scene.plantInfos[2][j], scene.plantInfos[3][j], scene.plantInfos[4][j]);
+				vec3 ground = anchors.empty() ? planet->getPlanetRadiusAt(pos) : anchors[j];
+				if (!anchors.empty())
+					pos = vcl::normalize(ground);
+				drawPlant(scene, scene.plant, *planet, pos, ground, scene.plantInfos[5][j], scene.plantInfos[9][j] / 4);
+			}
+			MeshArena::unbind();
+		}
 	}
 
-	if (farPlanets.size() > 0 || farPlanets.empty())
-		scene.skybox.render(scene);
-
-	Planet::startWaterRendering(scene, false);
-	for (int i = farPlanets.size() - 1; i >= 1; i--) {
-		Planet::switchIntermediateTexture();
-		farPlanets[i].pointer->renderWater(scene);
+	{
+		ProfileZone zone("Stars", true);
+		scene.starfield.render(scene);
 	}
 
-	if (nearPlanetIndices.empty()) {
-		Planet::renderFinalPlanet();
-		if (farPlanets.size() > 0)
-			farPlanets[0].pointer->renderWater(scene);
-		else
-			scene.skybox.render(scene);
+	// Water and atmosphere are blended over the image from back to front
+	Planet::startWaterRendering();
+	for (auto planet = planets.rbegin(); planet != planets.rend(); ++planet) {
+		planet->pointer->renderWater(scene, planet->rect);
 	}
-	else {
-		if (farPlanets.size() > 0) {
-			Planet::switchIntermediateTexture();
-			farPlanets[0].pointer->renderWater(scene);
-		}
-		// We now need to render the near planet with the texture as the background.
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_DEPTH_TEST);
-		scene.projection = scene.nearProjection;
-		for (int i = 0; i < nearPlanetIndices.size(); i++) {
-			scene.planets[nearPlanetIndices[i]].renderPlanet(scene);
-			if (nearPlanetIndices[i] == 2) {
-				for (int j = 0; j < scene.plantInfos[0].size(); j++) {
-					vec3 pos = vcl::vec3(scene.plantInfos[2][j], scene.plantInfos[3][j], scene.plantInfos[4][j]);
-					drawPlant(scene, scene.plant, scene.planets[2], pos, scene.plantInfos[5][j], scene.plantInfos[9][j] / 4);
-				}
-			}
-		}
+	Planet::endWaterRendering();
 
-		Planet::startWaterRendering(scene, true);
-		for (int i = 0; i < nearPlanetIndices.size() - 1; i++) {
-			Planet::switchIntermediateTexture();
-			scene.planets[nearPlanetIndices[i]].renderWater(scene);
-		}
-		Planet::renderFinalPlanet();
-		scene.planets[nearPlanetIndices.back()].renderWater(scene);
-	}
+	ProfileZone zone("Present", true);
+	Planet::renderFinalImage();
 }
 
 void display_interface(scene_environment& scene, int* planet_index) {
+	ImGui::Text("Culled planets: %d / %d", scene.culling.culled, scene.culling.tested);
+	ImGui::Text("Submitted triangles: %u / %u", scene.culling.submittedTriangles, scene.culling.totalTriangles);
+	ImGui::Text("Owned GL objects: %d", gl_live_objects());
+	ArenaStats const vertices = scene.meshArena.vertexStats();
+	ArenaStats const indices = scene.meshArena.indexStats();
+	ArenaDrawStats const arenaDraws = scene.meshArena.drawStats();
+	ImGui::Text("Arena vertices: %zu / %zu in %zu meshes, fragmentation %.2f", vertices.used, vertices.capacity, vertices.allocations, vertices.fragmentation());
+	ImGui::Text("Arena indices: %zu / %zu, fragmentation %.2f", indices.used, indices.capacity, indices.fragmentation());
+	ImGui::Text("Arena draws: %u with %u binds", arenaDraws.draws, arenaDraws.binds);
+	ResidencyStats const& residency = Planet::residencyStats;
+	ImGui::Text("Planet meshes: %zu MB CPU, %zu MB GPU, budget %zu MB", residency.memory.cpu >> 20, residency.memory.gpu >> 20, residency.budget >> 20);
+	ImGui::Text("Full resolution planets: %d, %d loading", residency.full, residency.loading);
+	int budget = int(Planet::residencySettings.budget >> 20);
+	if (ImGui::SliderInt("Budget (MB)", &budget, 64, 4096))
+		Planet::residencySettings.budget = size_t(budget) << 20;
+	GLTaskStats const tasks = glTasks().stats();
+	ImGui::Text("GL tasks: %zu queued, %zu KB to upload, %u slices in %.2f ms", tasks.depth, tasks.backlog >> 10, tasks.slices, tasks.milliseconds);
+	ImGui::SliderFloat("GL task budget (ms)", &glTasks().budget, 0.5f, 8.0f);
+	// The catalog is generated again once the slider is released
+	static int stars = int(scene.starfield.settings.count);
+	ImGui::SliderInt("Stars", &stars, 0, 50000);
+	if (ImGui::IsItemDeactivatedAfterEdit() && stars != int(scene.starfield.settings.count)) {
+		StarfieldSettings settings = scene.starfield.settings;
+		settings.count = (unsigned int)stars;
+		scene.starfield.regenerate(settings);
+	}
 	ImGui::SliderInt("Planet index", planet_index, 0, scene.planets.size() - 1);
 	scene.planets[*planet_index].displayInterface();
 }
@@ -149,4 +180,5 @@ static void opengl_uniform(GLuint shader, scene_environment const& current_scene
 	opengl_uniform(shader, "projection", current_scene.projection, false);
 	opengl_uniform(shader, "view", current_scene.camera.matrix_view(), false);
 	opengl_uniform(shader, "light", current_scene.light, false);
+	opengl_uniform(shader, "logDepthCoefficient", logDepthCoefficient(current_scene.depth), false);
 }
@@ -3,7 +3,12 @@
 #include "vcl/vcl.hpp"
 #include "camera_fps.hpp"
 #include "player.hpp"
-#include "skybox.hpp"
+#include "starfield.hpp"
+#include "depth.hpp"
+#include "culling.hpp"
+#include "buffer_arena.hpp"
+#include "vegetation.hpp"
+#include "mapped_file.hpp"
 
 #define CAMERA_TYPE 1
 // 0 is edit mode
@@ -21,10 +26,11 @@ const int SCR_HEIGHT = 1024;
 static int resolution = 500;
 
 
+// Distance to the surface of a planet under which its vegetation is drawn
 #if CAMERA_TYPE
-static float midDistance = 30.0f;
+static float vegetationDistance = 30.0f;
 #else
-static float midDistance = 5.0f;
+static float vegetationDistance = 5.0f;
 #endif
 
 struct scene_environment
@@ -35,17 +41,19 @@ struct scene_environment
     vcl::camera_around_center camera;
 #endif
     vcl::mat4 projection;
-    vcl::mat4 nearProjection;
-    vcl::mat4 farProjection;
+    DepthSettings depth;
+    CullingStats culling; // Reset every frame by display_scene
     vcl::vec3 light;
     Player player;
+    MappedFile systemPack; // The planets point to the bakes it holds
     std::vector<Planet> planets;
-    Skybox skybox;
+    Starfield starfield;
 
-    vcl::hierarchy_mesh_drawable plant;
+    MeshArena meshArena; // Small static meshes, drawn without switching buffers
+    Plant plant;
     vcl::buffer<vcl::buffer<float>> plantInfos;
 };
 
-void buildFrustrsums(scene_environment& scene, unsigned int width, unsigned int height, float interPlane = midDistance);
+void buildProjection(scene_environment& scene, unsigned int width, unsigned int height);
 void display_scene(scene_environment& scene, float time, float width, float height);
 void display_interface(scene_environment& scene, int* planet_index);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+#include <atomic>
+
+// Move-only owner of an OpenGL object, deleted with its owner.
+// Traits provides static GLuint create() and static void destroy(GLuint).
+template <typename Traits>
+class gl_object {
+public:
+    gl_object() {}
+    explicit gl_object(GLuint id) { reset(id); }
+    static gl_object create() { return gl_object(Traits::create()); }
+
+    gl_object(gl_object const&) = delete;
+    gl_object& operator=(gl_object const&) = delete;
+    gl_object(gl_object&& other) noexcept : handle(other.handle) { other.handle = 0; }
+    gl_object& operator=(gl_object&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = other.handle;
+            other.handle = 0;
+        }
+        return *this;
+    }
+    ~gl_object() { reset(); }
+
+    GLuint id() const { return handle; }
+    explicit operator bool() const { return handle != 0; }
+
+    // Delete the current object and take the ownership of id
+    void reset(GLuint id = 0) {
+        if (handle != 0) {
+            Traits::destroy(handle);
+            liveCount--;
+        }
+        handle = id;
+        if (handle != 0)
+            liveCount++;
+    }
+
+    // Number of objects of this kind currently owned
+    static int live() { return liveCount; }
+
+private:
+    GLuint handle = 0;
+    static std::atomic<int> liveCount;
+};
+
+template <typename Traits>
+std::atomic<int> gl_object<Traits>::liveCount(0);
+
+
+struct gl_buffer_traits {
+    static GLuint create() { GLuint id = 0; glGenBuffers(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+struct gl_vertex_array_traits {
+    static GLuint create() { GLuint id = 0; glGenVertexArrays(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct gl_texture_traits {
+    static GLuint create() { GLuint id = 0; glGenTextures(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteTextures(1, &id); }
+};
+
+struct gl_framebuffer_traits {
+    static GLuint create() { GLuint id = 0; glGenFramebuffers(1, &id); return id; }
+    static void destroy(GLuint id) { glDeleteFramebuffers(1, &id); }
+};
+
+using gl_buffer = gl_object<gl_buffer_traits>;
+using gl_vertex_array = gl_object<gl_vertex_array_traits>;
+using gl_texture = gl_object<gl_texture_traits>;
+using gl_framebuffer = gl_object<gl_framebuffer_traits>;
+
+// Buffers, vertex arrays, textures and framebuffers alive
+inline int gl_live_objects() {
+    return gl_buffer::live() + gl_vertex_array::live() + gl_texture::live() + gl_framebuffer::live();
+}
@@ -0,0 +1,70 @@
+#include "gl_task_queue.hpp"
+
+#include <chrono>
+
+GLTaskQueue& glTasks() {
+    static GLTaskQueue queue;
+    return queue;
+}
+
+void GLTaskQueue::post(Task task, int priority, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry entry;
+    entry.task = std::move(task);
+    entry.bytes = bytes;
+    tasks.emplace(Key(-priority, posted++), std::move(entry));
+    backlog += bytes;
+}
+
+void GLTaskQueue::drain() {
+    auto const start = std::chrono::steady_clock::now();
+    unsigned int slices = 0;
+    float elapsed = 0.0f;
+    while (true) {
+        // The task runs unlocked, the workers keep posting meanwhile
+        Key key;
+        Entry entry;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty())
+                break;
+            auto const first = tasks.begin();
+            key = first->first;
+            entry = std::move(first->second);
+            tasks.erase(first);
+            backlog -= entry.bytes;
+        }
+
+        entry.bytes = entry.task();
+        slices++;
+        if (entry.bytes > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            backlog += entry.bytes;
+            tasks.emplace(key, std::move(entry));
+        }
+
+        elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= budget)
+            break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    lastSlices = slices;
+    lastMilliseconds = elapsed;
+}
+
+GLTaskStats GLTaskQueue::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    GLTaskStats stats;
+    stats.depth = tasks.size();
+    stats.backlog = backlog;
+    stats.slices = lastSlices;
+    stats.milliseconds = lastMilliseconds;
+    return stats;
+}
+
+void GLTaskQueue::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.clear();
+    backlog = 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+
+struct GLTaskStats {
+    size_t depth = 0;         // Tasks waiting, a task split over several frames counts once
+    size_t backlog = 0;       // Bytes left to upload, as last reported by the tasks
+    unsigned int slices = 0;  // Task calls of the last drain
+    float milliseconds = 0.0f; // Spent by the last drain
+};
+
+// Work needing the OpenGL context, posted from any thread and run by the render loop within a time budget per
+// frame, so that a large upload is spread over several frames instead of stalling one.
+// A task does one slice of its work per call and returns the bytes it has left, 0 once complete: a large upload
+// copies a range of its buffer per call and stays at its place in the queue until done.
+class GLTaskQueue {
+public:
+    using Task = std::function<size_t()>;
+
+    float budget = 2.0f; // Milliseconds per frame
+
+    // Thread safe. Higher priorities run first, then in the order of posting. bytes is the initial backlog.
+    void post(Task task, int priority = 0, size_t bytes = 0);
+
+    // Thread of the OpenGL context only. Runs slices until the budget is spent, at least one so that the queue
+    // always progresses. A task may post other tasks.
+    void drain();
+
+    GLTaskStats stats() const;
+
+    // Drops the tasks not run yet, at shutdown before the objects they refer to are released
+    void clear();
+
+private:
+    struct Entry {
+        Task task;
+        size_t bytes = 0;
+    };
+    using Key = std::pair<int, uint64_t>; // Negated priority, then the posting number
+
+    mutable std::mutex mutex;
+    std::map<Key, Entry> tasks;
+    uint64_t posted = 0;
+    size_t backlog = 0;
+    unsigned int lastSlices = 0;
+    float lastMilliseconds = 0.0f;
+};
+
+// Drained once per frame by the render loop
+GLTaskQueue& glTasks();
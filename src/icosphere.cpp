@@ -1,10 +1,42 @@
 #include "icosphere.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <utility>
 
 using namespace vcl;
 
-static std::vector<std::pair<int, mesh>> generatedIcospheres;
+struct icosphere_data {
+	buffer<vec3> position;
+	buffer<uint3> connectivity;
+	std::vector<int> lattice; // Vertex index of each point (i, j) of the triangular lattice of the 8 faces, i + j <= division + 1
+};
+
+// Topologies in use, released with the last planet holding them
+static std::mutex topologiesMutex;
+static std::map<std::pair<unsigned int, unsigned int>, std::weak_ptr<IcosphereTopology const>> topologies;
+
+static int latticeRow(int j, int division) {
+	return j * (division + 2) - j * (j - 1) / 2;
+}
+
+static int latticeSize(int division) {
+	return latticeRow(division + 2, division);
+}
+
+static void generateFaceVertex(vec3 v0, vec3 v1, vec3 v2, int division, vcl::buffer<vcl::vec3>& positions, vcl::buffer<vcl::uint3>& connectivity, int& count, int* base, int* lastVertices, int* lattice) {
+	// Points shared with the neighbour faces
+	for (int j = 0; j < division + 2; j++)
+		lattice[latticeRow(j, division) + division + 1 - j] = lastVertices[j];
+	if (base != NULL) {
+		for (int i = 0; i < division + 1; i++)
+			lattice[i] = base[i];
+	}
 
-static void generateFaceVertex(vec3 v0, vec3 v1, vec3 v2, int division, vcl::buffer<vcl::vec3>& positions, vcl::buffer<vcl::uint3>& connectivity, int& count, int* base, int* lastVertices) {
 	for (int j = 0; j < division + 1; j++) {
 		double ky = (double)j / (division + 1);
 		int offset = division - j;
@@ -23,6 +55,7 @@ static void generateFaceVertex(vec3 v0, vec3 v1, vec3 v2, int division, vcl::buf
 				double kx = (double)i / (division + 1);
 				vec3 vertex = v0 + kx * (v1 - v0) + ky * (v2 - v0);
 				vertex = normalize(vertex);
+				lattice[latticeRow(j, division) + i] = count;
 				positions[count++] = vertex;
 			}
 			connectivity.push_back({ count - 1, lastVertices[j + 1], lastVertices[j] });
@@ -37,14 +70,10 @@ static void generateFaceVertex(vec3 v0, vec3 v1, vec3 v2, int division, vcl::buf
 	}
 }
 
-mesh mesh_icosphere(float r, unsigned int division) {
-
-	for (int i = 0; i < generatedIcospheres.size(); i++) {
-		if (generatedIcospheres[i].first == division)
-			return generatedIcospheres[i].second;
-	}
-
-	mesh m;
+static icosphere_data generateIcosphere(unsigned int division) {
+	icosphere_data m;
+	std::vector<int> lattice(8 * latticeSize(division));
+	int face = 0;
 	int size = 4 * (division + 1) * (division + 1) + 2;
 	int upVertexCount = 2 * (division + 1) * (division + 2);
 	m.position.resize(size);
@@ -65,16 +94,16 @@ mesh mesh_icosphere(float r, unsigned int division) {
 	lastVertices[division + 1] = 0;
 
 	for (int j = 1; j < division + 1; j++) lastVertices[j] = lastVertices[j - 1] + division - j + 2;
-	generateFaceVertex(-v2, v1, v0, division, m.position, m.connectivity, count, NULL, lastVertices);
+	generateFaceVertex(-v2, v1, v0, division, m.position, m.connectivity, count, NULL, lastVertices, &lattice[latticeSize(division) * face++]);
 
 	for (int j = 0; j < division + 1; j++) lastVertices[j] += offset;
-	generateFaceVertex(v1, v2, v0, division, m.position, m.connectivity, count, NULL, lastVertices);
+	generateFaceVertex(v1, v2, v0, division, m.position, m.connectivity, count, NULL, lastVertices, &lattice[latticeSize(division) * face++]);
 
 	for (int j = 0; j < division + 1; j++) lastVertices[j] += offset;
-	generateFaceVertex(v2, -v1, v0, division, m.position, m.connectivity, count, NULL, lastVertices);
+	generateFaceVertex(v2, -v1, v0, division, m.position, m.connectivity, count, NULL, lastVertices, &lattice[latticeSize(division) * face++]);
 
 	for (int j = 0; j < division + 1; j++) lastVertices[j] -= 3 * offset;
-	generateFaceVertex(-v1, -v2, v0, division, m.position, m.connectivity, count, NULL, lastVertices);
+	generateFaceVertex(-v1, -v2, v0, division, m.position, m.connectivity, count, NULL, lastVertices, &lattice[latticeSize(division) * face++]);
 
 	lastVertices[0] = 2;
 	offset -= division + 1;
@@ -86,29 +115,175 @@ mesh mesh_icosphere(float r, unsigned int division) {
 	for (int i = 1; i < division + 1; i++) base[i] = 3 + division - i;
 	for (int j = 2; j < division + 1; j++) lastVertices[j] = lastVertices[j - 1] + division - j + 2;
 
-	generateFaceVertex(v1, -v2, -v0, division, m.position, m.connectivity, count, base, lastVertices);
+	generateFaceVertex(v1, -v2, -v0, division, m.position, m.connectivity, count, base, lastVertices, &lattice[latticeSize(division) * face++]);
 
 	for (int j = 1; j < division + 1; j++) lastVertices[j] += offset;
 	for (int i = 0; i < division + 1; i++) base[i] += 3 * (offset + division + 1);
 	base[0] -= upVertexCount;
 	lastVertices[0] += 3 * (offset + division + 1);
-	generateFaceVertex(-v2, -v1, -v0, division, m.position, m.connectivity, count, base, lastVertices);
+	generateFaceVertex(-v2, -v1, -v0, division, m.position, m.connectivity, count, base, lastVertices, &lattice[latticeSize(division) * face++]);
 	base[0] += upVertexCount;
 
 	for (int j = 1; j < division + 1; j++) lastVertices[j] += offset;
 	for (int i = 0; i < division + 1; i++) base[i] -= offset + division + 1;
 	lastVertices[0] -= offset + division + 1;
-	generateFaceVertex(-v1, v2, -v0, division, m.position, m.connectivity, count, base, lastVertices);
+	generateFaceVertex(-v1, v2, -v0, division, m.position, m.connectivity, count, base, lastVertices, &lattice[latticeSize(division) * face++]);
 	 
 	for (int j = 1; j < division + 1; j++) lastVertices[j] -= 3 * offset;
 	for (int i = 0; i < division + 1; i++) base[i] -= (offset + division + 1);
 	lastVertices[0] -= offset + division + 1;
-	generateFaceVertex(v2, v1, -v0, division, m.position, m.connectivity, count, base, lastVertices);
+	generateFaceVertex(v2, v1, -v0, division, m.position, m.connectivity, count, base, lastVertices, &lattice[latticeSize(division) * face++]);
 
 	assert_vcl(count == size, "Wrong vertex count creating the sphere");
 
-	m.fill_empty_field();
+	delete[] lastVertices;
+	delete[] base;
 
-	generatedIcospheres.push_back(std::pair<int, mesh>(division, m));
+	m.lattice = std::move(lattice);
 	return m;
-}
\ No newline at end of file
+}
+
+static buffer<uint3> lodConnectivity(icosphere_data const& data, unsigned int division, unsigned int step) {
+	assert_vcl((division + 1) % step == 0, "The LOD step must divide the number of segments of the icosphere");
+	int const segments = (division + 1) / step;
+	int const d = division;
+
+	// Same triangulation as the finest level, on the points of the lattice multiple of step
+	buffer<uint3> connectivity;
+	connectivity.data.reserve(8 * segments * segments);
+	for (int face = 0; face < 8; face++) {
+		int const* lattice = &data.lattice[latticeSize(d) * face];
+		auto vertex = [&](int i, int j) { return (unsigned int)lattice[latticeRow(j * step, d) + i * step]; };
+		for (int j = 0; j < segments; j++) {
+			for (int i = 0; i + j < segments; i++) {
+				connectivity.push_back({ vertex(i, j), vertex(i, j + 1), vertex(i + 1, j) });
+				if (i + j < segments - 1)
+					connectivity.push_back({ vertex(i + 1, j), vertex(i, j + 1), vertex(i + 1, j + 1) });
+			}
+		}
+	}
+	return connectivity;
+}
+
+mesh mesh_icosphere(float r, unsigned int division) {
+	TraceScope trace("mesh_icosphere");
+	icosphere_data data = generateIcosphere(division);
+	mesh m;
+	m.position = std::move(data.position);
+	m.connectivity = std::move(data.connectivity);
+	m.fill_empty_field();
+	return m;
+}
+
+size_t icosphere_vertex_count(unsigned int division) {
+	return 4 * size_t(division + 1) * (division + 1) + 2;
+}
+
+unsigned int icosphere_nested_division(unsigned int division, unsigned int step) {
+	unsigned int const segments = step * std::max(1u, (unsigned int)std::lround((division + 1) / (double)step));
+	return segments - 1;
+}
+
+unsigned int icosphere_lod_step(unsigned int division, unsigned int lodDivision) {
+	return std::max(1u, (unsigned int)std::lround((division + 1) / (double)(lodDivision + 1)));
+}
+
+buffer<uint3> icosphere_lod_connectivity(unsigned int division, unsigned int step) {
+	return lodConnectivity(generateIcosphere(division), division, step);
+}
+
+
+static gl_buffer allocateBuffer(GLenum target, size_t size) {
+	gl_buffer buffer = gl_buffer::create();
+	glBindBuffer(target, buffer.id()); opengl_check;
+	glBufferData(target, GLsizeiptr(size), nullptr, GL_STATIC_DRAW); opengl_check;
+	return buffer;
+}
+
+size_t IcosphereTopology::bufferBytes() const {
+	size_t bytes = directions.size() * sizeof(vec3);
+	for (IcosphereLevel const& level : levels)
+		bytes += level.connectivity.size() * sizeof(uint3);
+	return bytes;
+}
+
+void IcosphereTopology::upload() const {
+	size_t bytes = std::numeric_limits<size_t>::max();
+	uploadSome(bytes);
+}
+
+bool IcosphereTopology::uploadSome(size_t& bytes) const {
+	// The element array binding belongs to the vertex array
+	if (!directionBuffer) {
+		glBindVertexArray(0);
+		directionBuffer = allocateBuffer(GL_ARRAY_BUFFER, directions.size() * sizeof(vec3));
+		for (IcosphereLevel const& level : levels)
+			level.indexBuffer = allocateBuffer(GL_ELEMENT_ARRAY_BUFFER, level.connectivity.size() * sizeof(uint3));
+	}
+
+	// The directions then the index buffer of each level, uploadedBytes counting from the start of the directions
+	struct Region {
+		GLenum target;
+		GLuint buffer;
+		unsigned char const* data;
+		size_t size;
+	};
+	Region const regions[3] = {
+		{ GL_ARRAY_BUFFER, directionBuffer.id(), reinterpret_cast<unsigned char const*>(directions.data.data()), directions.size() * sizeof(vec3) },
+		{ GL_ELEMENT_ARRAY_BUFFER, levels[0].indexBuffer.id(), reinterpret_cast<unsigned char const*>(levels[0].connectivity.data.data()), levels[0].connectivity.size() * sizeof(uint3) },
+		{ GL_ELEMENT_ARRAY_BUFFER, levels[1].indexBuffer.id(), reinterpret_cast<unsigned char const*>(levels[1].connectivity.data.data()), levels[1].connectivity.size() * sizeof(uint3) }
+	};
+	size_t start = 0;
+	for (Region const& region : regions) {
+		size_t const end = start + region.size;
+		if (uploadedBytes < end && bytes > 0) {
+			size_t const offset = uploadedBytes - start;
+			size_t const count = std::min(end - uploadedBytes, bytes);
+			glBindVertexArray(0);
+			glBindBuffer(region.target, region.buffer); opengl_check;
+			glBufferSubData(region.target, GLintptr(offset), GLsizeiptr(count), region.data + offset); opengl_check;
+			glBindBuffer(region.target, 0);
+			uploadedBytes += count;
+			bytes -= count;
+		}
+		start = end;
+	}
+	return uploadedBytes == start;
+}
+
+std::shared_ptr<IcosphereTopology const> icosphere_topology(unsigned int division, unsigned int lodDivision, int trianglesPerCluster) {
+	unsigned int const step = icosphere_lod_step(division, lodDivision);
+	unsigned int const nestedDivision = icosphere_nested_division(division, step);
+
+	// Planets may be built from several threads, the topology is generated once
+	TraceScope trace("icosphere_topology", std::to_string(nestedDivision));
+	std::lock_guard<std::mutex> lock(topologiesMutex);
+	// The released topologies leave their entry behind, dropped here so the map only holds live ones
+	for (auto entry = topologies.begin(); entry != topologies.end();) {
+		if (entry->second.expired())
+			entry = topologies.erase(entry);
+		else
+			++entry;
+	}
+	std::weak_ptr<IcosphereTopology const>& cached = topologies[{ nestedDivision, step }];
+	if (std::shared_ptr<IcosphereTopology const> topology = cached.lock())
+		return topology;
+
+	icosphere_data data = generateIcosphere(nestedDivision);
+	std::shared_ptr<IcosphereTopology> topology = std::make_shared<IcosphereTopology>();
+	topology->division = nestedDivision;
+	topology->lodStep = step;
+	topology->levels[1].connectivity = lodConnectivity(data, nestedDivision, step);
+	topology->levels[0].connectivity = std::move(data.connectivity);
+	topology->directions = std::move(data.position);
+	for (IcosphereLevel& level : topology->levels)
+		level.clusters = partitionIntoClusters(level.connectivity, topology->directions, trianglesPerCluster);
+
+	cached = topology;
+	return topology;
+}
+
+size_t icosphere_cached_topologies() {
+	std::lock_guard<std::mutex> lock(topologiesMutex);
+	return topologies.size();
+}
@@ -1,4 +1,52 @@
 #pragma once
 #include "vcl/vcl.hpp"
+#include "mesh_clusters.hpp"
+#include "gl_object.hpp"
 
-vcl::mesh mesh_icosphere(float r, unsigned int division);
\ No newline at end of file
+#include <memory>
+
+// Planet meshes: division of their low resolution level, and size of their culling clusters
+#define LOW_RES_DIVISION 100
+#define TRIANGLES_PER_CLUSTER 1024
+
+vcl::mesh mesh_icosphere(float r, unsigned int division);
+// Vertices of mesh_icosphere, the triangles are twice as many minus 4
+size_t icosphere_vertex_count(unsigned int division);
+
+// Nested levels of detail: a coarser level uses one lattice point out of step along each edge,
+// so its vertices are a subset of the finer level and only the index buffer differs.
+// Step giving a coarser level close to lodDivision, and the division of the finest level rounded to nest it
+unsigned int icosphere_lod_step(unsigned int division, unsigned int lodDivision);
+unsigned int icosphere_nested_division(unsigned int division, unsigned int step);
+// Triangles of the coarser level, indexing the vertices of mesh_icosphere(r, division)
+vcl::buffer<vcl::uint3> icosphere_lod_connectivity(unsigned int division, unsigned int step);
+
+
+struct IcosphereLevel {
+    vcl::buffer<vcl::uint3> connectivity; // Sorted by cluster
+    MeshClusters clusters;                // Triangle ranges only, the bounds depend on the terrain
+    mutable gl_buffer indexBuffer;
+};
+
+// Unit sphere and index buffers shared by every planet of the same division, immutable once built.
+// The GPU buffers are uploaded once by the first drawable using them and released with the topology.
+struct IcosphereTopology {
+    unsigned int division = 0;
+    unsigned int lodStep = 1;
+    vcl::buffer<vcl::vec3> directions;
+    IcosphereLevel levels[2]; // Full resolution, then the nested low resolution
+
+    mutable gl_buffer directionBuffer;
+    mutable size_t uploadedBytes = 0;
+
+    // OpenGL thread only. uploadSome copies at most bytes, less the bytes it copied, so that a large topology is
+    // uploaded over several frames. True once the buffers are complete.
+    void upload() const;
+    bool uploadSome(size_t& bytes) const;
+    size_t bufferBytes() const; // Of the direction and index buffers
+};
+
+// Thread safe, the division is rounded with icosphere_nested_division
+std::shared_ptr<IcosphereTopology const> icosphere_topology(unsigned int division, unsigned int lodDivision, int trianglesPerCluster);
+// Divisions in the cache of icosphere_topology, the released ones are pruned by the next request
+size_t icosphere_cached_topologies();
@@ -6,11 +6,19 @@
 #include "vcl/vcl.hpp"
 #include "planet.hpp"
 #include "physics.hpp"
-#include "skybox.hpp"
+#include "starfield.hpp"
 #include "camera_fps.hpp"
 #include "player.hpp"
 #include "vegetation.hpp"
 #include "display.hpp"
+#include "opengl_extensions.hpp"
+#include "shader_variants.hpp"
+#include "program_cache.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "asset_manager.hpp"
+#include "solar_system.hpp"
+#include "gl_task_queue.hpp"
 
 using namespace vcl;
 
@@ -24,6 +32,7 @@ struct user_interaction_parameters {
 	vec2 mouse_prev;
 	timer_fps fps_record;
 	bool cursor_on_gui;
+	bool show_profiler = false; // F3, F4 writes the profile in profile.csv, F5 the startup trace in trace.json
 	keyboard_state_parameters keyboard_state;
 };
 user_interaction_parameters user;
@@ -34,7 +43,9 @@ void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, in
 void mouse_move_callback(GLFWwindow* window, double xpos, double ypos);
 void window_size_callback(GLFWwindow* window, int width, int height);
 
+void initialize_depth();
 void initialize_data();
+void release_scene();
 
 float current_width;
 float current_height;
@@ -44,7 +55,9 @@ int planet_index;
 int main(int, char* argv[])
 {
 	std::cout << "Run " << argv[0] << std::endl;
+	traceThreadName("Main");
 	GLFWwindow* window = create_window(SCR_WIDTH, SCR_HEIGHT);
+	initialize_depth();
 	window_size_callback(window, SCR_WIDTH, SCR_HEIGHT);
 	std::cout << opengl_info_display() << std::endl;
 
@@ -62,28 +75,47 @@ int main(int, char* argv[])
 
 	std::cout<<"Start animation loop ..."<<std::endl;
 	user.fps_record.start();
+	vec3 previousViewer = scene.camera.position();
 	glEnable(GL_DEPTH_TEST);
 	while (!glfwWindowShouldClose(window))
 	{
 		float deltaTime = user.fps_record.update();
-
-		// Camera 
-		#if CAMERA_TYPE
-			int3 direction = { user.keyboard_state.front, user.keyboard_state.right, user.keyboard_state.up };
-			scene.player.update_position(direction);
-		#else
-			scene.camera.center_of_rotation = scene.planets[planet_index].getPosition();
-			//scene.light = scene.camera.position();
-		#endif
-		
-		// Physics
-		PhysicsComponent::update(deltaTime);
-		for (int i = 0; i < scene.planets.size(); i++)
-			scene.planets[i].updateRotation(deltaTime);
+		profiler().beginFrame();
+
+		{
+			ProfileZone zone("Physics");
+			// Camera 
+			#if CAMERA_TYPE
+				int3 direction = { user.keyboard_state.front, user.keyboard_state.right, user.keyboard_state.up };
+				scene.player.update_position(direction);
+			#else
+				scene.camera.center_of_rotation = scene.planets[planet_index].getPosition();
+				//scene.light = scene.camera.position();
+			#endif
+			
+			// Physics
+			PhysicsComponent::update(deltaTime);
+			for (size_t i = 0; i < scene.planets.size(); i++)
+				scene.planets[i].updateRotation(deltaTime);
+		}
+		{
+			// Full resolution meshes of the planets the viewer approaches, built in the background and uploaded by slices
+			ProfileZone zone("Planet residency");
+			vec3 const viewer = scene.camera.position();
+			vec3 const velocity = deltaTime > 0.0f ? (viewer - previousViewer) / deltaTime : vec3(0.0f, 0.0f, 0.0f);
+			previousViewer = viewer;
+			Frustum const frustum = extractFrustum(scene.projection * scene.camera.matrix_view(), scene.depth.mode == DepthMode::ReverseZ);
+			Planet::updateResidency(scene.planets, viewer, velocity, frustum);
+		}
+		{
+			// Uploads and deferred work posted by the workers, within the budget of the frame
+			ProfileZone zone("GL tasks");
+			glTasks().drain();
+		}
 		
 		imgui_create_frame();
 		if(user.fps_record.event) {
-			std::string const title = "VCL Display - "+str(user.fps_record.fps)+" fps";
+			std::string const title = "VCL Display - "+str(user.fps_record.fps)+" fps - "+str(scene.culling.culled)+"/"+str(scene.culling.tested)+" planets culled";
 			glfwSetWindowTitle(window, title.c_str());
 		}
 
@@ -102,13 +134,22 @@ int main(int, char* argv[])
 #if !CAMERA_TYPE
 		display_interface(scene, &planet_index);
 		ImGui::End();
-		imgui_render_frame(window);
 #endif
+		// The interface is only drawn in edit mode, but the profiler can be opened in both
+		if (user.show_profiler)
+			displayProfiler(profiler(), &user.show_profiler);
+		if (!CAMERA_TYPE || user.show_profiler) {
+			ProfileZone zone("ImGui", true);
+			imgui_render_frame(window);
+		}
 
+		profiler().endFrame();
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
+	writeChromeTrace("trace.json");
+	release_scene();
 	vcl::imgui_cleanup();
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -117,16 +158,52 @@ int main(int, char* argv[])
 }
 
 
+// The GL objects are deleted while the context is still current, rather than by the destructor of the global
+// scene after glfwTerminate. The background builds finish first: they read the bakes mapped by the system pack.
+void release_scene()
+{
+	TraceScope trace("release_scene");
+	for (Planet& planet : scene.planets)
+		planet.waitBackgroundWork();
+	glTasks().clear();
+	scene.planets.clear();
+	scene.systemPack = MappedFile();
+	scene.starfield = Starfield();
+	scene.plant = Plant();
+	scene.meshArena = MeshArena();
+	Planet::releasePlanetRenderer();
+}
+
+// Reverse-Z needs the depth range [0, 1] of glClipControl, otherwise fall back to a logarithmic depth
+void initialize_depth()
+{
+	loadOpenGLExtensions();
+	if (glExtensions.clipControl) {
+		scene.depth.mode = DepthMode::ReverseZ;
+		glExtensions.ClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+	}
+	else
+		scene.depth.mode = DepthMode::Logarithmic;
+}
+
 void initialize_data()
 {
+	TraceScope trace("initialize_data");
+	// TEXTURES
+	// Decoded on worker threads while the shaders compile and the planets are built
+	assetManager().prefetch({ "assets/moon_normal_map1.png" });
+
 	// SHADERS
-	GLuint const shader_mesh = opengl_create_shader_program(opengl_shader_preset("mesh_vertex"), opengl_shader_preset("mesh_fragment"));
-	GLuint const shader_uniform_color = opengl_create_shader_program(opengl_shader_preset("single_color_vertex"), opengl_shader_preset("single_color_fragment"));
+	// Requested now and checked once the planets are built, the driver compiles them in the meantime
+	traceEvent("Startup until initialize_data", 0, traceNow());
+	programCache().initialize();
+	std::vector<std::string> defines;
+	if (scene.depth.mode == DepthMode::Logarithmic)
+		defines.push_back("LOGARITHMIC_DEPTH");
+	PendingProgram shader_mesh = programCache().request(shaderWithDefines(read_text_file("shaders/mesh/mesh.vert.glsl"), defines), opengl_shader_preset("mesh_fragment"));
+	PendingProgram shader_uniform_color = programCache().request(opengl_shader_preset("single_color_vertex"), opengl_shader_preset("single_color_fragment"));
 	GLuint const texture_white = opengl_texture_to_gpu(image_raw{1,1,image_color_type::rgba,{255,255,255,255}});
-	mesh_drawable::default_shader = shader_mesh;
 	mesh_drawable::default_texture = texture_white;
-	curve_drawable::default_shader = shader_uniform_color;
-	segments_drawable::default_shader = shader_uniform_color;	
 
 	// CAMERA
 	#if CAMERA_TYPE
@@ -138,70 +215,68 @@ void initialize_data()
 	#else
 	#endif
 
-	// SKYBOX
-	scene.skybox = Skybox("assets/cubemap.png");
+	// STARS
+	scene.starfield = Starfield(StarfieldSettings());
 
 	// PLANETS INITIALIZER
-    Planet::initPlanetRenderer(SCR_WIDTH, SCR_HEIGHT);
-	int nPlanets = 9;
-	scene.planets.resize(nPlanets);
-	// Sun
-	float sun_mass = (float)1e16;
-	scene.planets[0] = Planet("HeliosStar", sun_mass, { -2000, 50, 0 }, {0, 0, 0}, 50);
-	scene.planets[0].isSun = true;
-
-	// Other planets
-	scene.planets[1] = Planet("Vulkan", 0.13 / PhysicsComponent::G * 90000, &(scene.planets[0]), 1000.0f, rand_interval(0.0f, 2 * 3.14f), resolution);
-	scene.planets[1].waterGlow = true;
-
-	scene.planets[2] = Planet("Gwen", 0.1 / PhysicsComponent::G * 250000, &(scene.planets[0]), 2000.0f, 0.0f, resolution);
-	scene.planets[2].specularWater = false;
-
-	scene.planets[3] = Planet("Companion", 0.07 / PhysicsComponent::G * 22500, &(scene.planets[2]), 200.0f, 3.14f/2, resolution / 2);
-
-	scene.planets[4] = Planet("Oculus", 0.2 / PhysicsComponent::G * 1000000, &(scene.planets[0]), 3500.0f, rand_interval(0.0f, 2 * 3.14f), 50);
-	scene.planets[4].specularWater = false;
-	scene.planets[5] = Planet("Scylla", 0.07 / PhysicsComponent::G * 40000, &(scene.planets[4]), 300.0f, rand_interval(0.0f, 2 * 3.14f), resolution);
-
-	scene.planets[6] = Planet("AethedisPrime", 0.1 / PhysicsComponent::G * 90000, &(scene.planets[0]), 5000.0f, rand_interval(0.0f, 2 * 3.14f), resolution);
-	scene.planets[6].visual.shading.phong.specular = 0.3f;
-	scene.planets[6].visualLowRes.shading.phong.specular = 0.3f;
-
-	float dualMass = 0.07 / PhysicsComponent::G * 40000;
-	float separation = 130.0f;
-	float sunDistance = 7000.0f;
-	vcl::vec3 position1 = scene.planets[0].getPosition() + sunDistance * vcl::vec3(1.0f, 0.0f, 0.0f);
-	vcl::vec3 position2 = scene.planets[0].getPosition() + (sunDistance - separation) * vcl::vec3(1.0f, 0.0f, 0.0f);
-	vcl::vec3 relativeVelocity = std::sqrt(PhysicsComponent::G * dualMass / (2 * separation)) * vcl::vec3(0.0f, 1.0f, 0.0f);
-	vcl::vec3 velocity = std::sqrt(PhysicsComponent::G * sun_mass / sunDistance) * vcl::vec3(0.0f, 1.0f, 0.0f) + scene.planets[0].getSpeed();
-
-	scene.planets[7] = Planet("M458", dualMass, position1, relativeVelocity + velocity, resolution);
-	scene.planets[8] = Planet("EE", dualMass, position2, -relativeVelocity + velocity, resolution);
+    Planet::initPlanetRenderer(SCR_WIDTH, SCR_HEIGHT, scene.depth);
+	// Pack of the system written by the system_pack tool, or the scene and the planet files
+	std::vector<SystemPlanet> system;
+	scene.systemPack = MappedFile(solarSystemPackPath);
+	if (!parseSystemPack(scene.systemPack.data(), scene.systemPack.size(), system))
+		readSystemScene(solarSystemScenePath, resolution, system);
+	assert_vcl(!system.empty(), "Error : the solar system has no planet");
+	int nPlanets = int(system.size());
+	// Planets are built in place, the reserve keeps the parents valid
+	scene.planets.reserve(nPlanets);
+	for (SystemPlanet const& planet : system) {
+		int const parent = planet.orbit.parent;
+		scene.planets.emplace_back(planet, parent >= 0 && parent < int(scene.planets.size()) ? &scene.planets[parent] : nullptr);
+	}
 
-	planet_index = 2;
+	planet_index = std::min(2, nPlanets - 1);
+	for (int i = 0; i < nPlanets; i++) {
+		scene.planets[i].requestShaderVariants();
+	}
 
-	// Create the meshes of the planets in parallel
+	// Coarse meshes of the planets in parallel, so that the first frame does not wait for the full resolutions
 	std::vector<std::thread> threads(nPlanets);
 	for (int i = 0; i < nPlanets; i++) {
-		threads[i] = std::thread(&Planet::updatePlanetMesh, &scene.planets[i]);
+		threads[i] = std::thread(&Planet::initializePlanetMesh, &scene.planets[i]);
 	}
-	for (int i = 0; i < nPlanets; i++) {
-		threads[i].join();
+	{
+		TraceScope wait("Wait for the planet meshes");
+		for (int i = 0; i < nPlanets; i++) {
+			threads[i].join();
+		}
 	}
 	for (int i = 0; i < nPlanets; i++) {
 		scene.planets[i].updateVisual();
+		scene.planets[i].selectShaderVariants();
 	}
+	mesh_drawable::default_shader = programCache().finish(shader_mesh);
+	curve_drawable::default_shader = programCache().finish(shader_uniform_color);
+	segments_drawable::default_shader = curve_drawable::default_shader;
 
 	// Create the plants mesh and spawn parameters
-	createPlant(scene.plant);
+	scene.meshArena.initialize(1 << 16, 1 << 18);
+	createPlant(scene.plant, scene.meshArena);
 	scene.plantInfos = plantSpawn(5000, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 0.0f), 0.5);
+
+	AssetStats const assets = assetManager().stats();
+	std::cout << "Textures: " << assets.textureUploads << " uploaded for " << assets.textureRequests << " requests, "
+		<< assets.decodes << " PNG decoded in " << assets.decodeMilliseconds << " ms, "
+		<< assets.bakedLoads << " baked loaded in " << assets.bakedMilliseconds << " ms" << std::endl;
+	ProgramCacheStats const programs = programCache().stats();
+	std::cout << "Shaders: " << programs.hits << " programs loaded from the cache in " << programs.hitMilliseconds << " ms, "
+		<< programs.compiles << " compiled in " << programs.compileMilliseconds << " ms" << std::endl;
 }
 
 
 // CALLBACK FUNCTIONS
 void window_size_callback(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
-	buildFrustrsums(scene, width, height);
+	buildProjection(scene, width, height);
 	Planet::buildTextures(width, height);
 	current_width = width;
 	current_height = height;
@@ -272,4 +347,13 @@ void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, in
 	if (key == GLFW_KEY_E && action == GLFW_PRESS) {
 		scene.player.toggleJetpack();
 	}
+	if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+		user.show_profiler = !user.show_profiler;
+	}
+	if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+		profiler().writeCsv("profile.csv");
+	}
+	if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+		writeChromeTrace("trace.json");
+	}
 }
@@ -0,0 +1,111 @@
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const& path) {
+    HANDLE const handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(handle);
+        return;
+    }
+    HANDLE const view = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (view == nullptr) {
+        CloseHandle(handle);
+        return;
+    }
+    file = handle;
+    mapping = view;
+    bytes = static_cast<unsigned char const*>(MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0));
+    length = bytes != nullptr ? size_t(fileSize.QuadPart) : 0;
+}
+
+void MappedFile::close() {
+    if (bytes != nullptr)
+        UnmapViewOfFile(bytes);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (file != nullptr)
+        CloseHandle(file);
+    bytes = nullptr;
+    length = 0;
+    mapping = nullptr;
+    file = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(std::string const& path) {
+    int const descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return;
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        void* const view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (view != MAP_FAILED) {
+            bytes = static_cast<unsigned char const*>(view);
+            length = size_t(status.st_size);
+        }
+    }
+    // The mapping stays valid without the descriptor
+    ::close(descriptor);
+}
+
+void MappedFile::close() {
+    if (bytes != nullptr)
+        munmap(const_cast<unsigned char*>(bytes), length);
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#endif
+    }
+    return *this;
+}
+
+bool writeFileAtomically(std::string const& path, std::vector<unsigned char> const& data) {
+    std::string const temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<char const*>(data.data()), std::streamsize(data.size()));
+        if (!file)
+            return false;
+    }
+    std::remove(path.c_str()); // Windows does not replace an existing file
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
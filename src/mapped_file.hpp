@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only memory map of a whole file, unmapped with its owner.
+// The pages are read on demand by the system instead of being copied into a buffer.
+class MappedFile {
+public:
+    MappedFile() {}
+    explicit MappedFile(std::string const& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool valid() const { return bytes != nullptr; }
+    unsigned char const* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    void close();
+
+    unsigned char const* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+// Written next to its destination then renamed, so that a reader never maps a partial file
+bool writeFileAtomically(std::string const& path, std::vector<unsigned char> const& data);
@@ -0,0 +1,174 @@
+#include "mesh_clusters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace vcl;
+
+static float const halfPi = 1.57079633f;
+
+// Cell of a cube map, with an equal angle mapping to keep the cells of similar size
+static int cubeMapCell(vec3 const& direction, int gridSize) {
+    vec3 const a = { std::abs(direction.x), std::abs(direction.y), std::abs(direction.z) };
+    int face;
+    float u, v;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = direction.x > 0 ? 0 : 1;
+        u = direction.y / a.x;
+        v = direction.z / a.x;
+    }
+    else if (a.y >= a.z) {
+        face = direction.y > 0 ? 2 : 3;
+        u = direction.x / a.y;
+        v = direction.z / a.y;
+    }
+    else {
+        face = direction.z > 0 ? 4 : 5;
+        u = direction.x / a.z;
+        v = direction.y / a.z;
+    }
+    u = std::atan(u) / halfPi * 2.0f; // [-1, 1]
+    v = std::atan(v) / halfPi * 2.0f;
+    int const i = std::min(gridSize - 1, (int)((u * 0.5f + 0.5f) * gridSize));
+    int const j = std::min(gridSize - 1, (int)((v * 0.5f + 0.5f) * gridSize));
+    return (face * gridSize + j) * gridSize + i;
+}
+
+MeshClusters partitionIntoClusters(buffer<uint3>& connectivity, buffer<vec3> const& position, int trianglesPerCluster) {
+    size_t const triangleCount = connectivity.size();
+    int const gridSize = std::max(1, (int)std::lround(std::sqrt(triangleCount / (6.0 * trianglesPerCluster))));
+    int const cellCount = 6 * gridSize * gridSize;
+
+    // Counting sort of the triangles by cell, the order inside a cell is kept
+    std::vector<int> cells(triangleCount);
+    std::vector<unsigned int> cellStart(cellCount + 1, 0);
+    for (size_t k = 0; k < triangleCount; k++) {
+        uint3 const& face = connectivity[k];
+        cells[k] = cubeMapCell(position[face[0]] + position[face[1]] + position[face[2]], gridSize);
+        cellStart[cells[k] + 1]++;
+    }
+    for (int c = 0; c < cellCount; c++)
+        cellStart[c + 1] += cellStart[c];
+
+    buffer<uint3> sorted;
+    sorted.resize(triangleCount);
+    std::vector<unsigned int> next(cellStart.begin(), cellStart.end() - 1);
+    for (size_t k = 0; k < triangleCount; k++)
+        sorted[next[cells[k]]++] = connectivity[k];
+    connectivity = sorted;
+
+    MeshClusters result;
+    for (int c = 0; c < cellCount; c++) {
+        if (cellStart[c + 1] == cellStart[c])
+            continue;
+        MeshCluster cluster;
+        cluster.firstTriangle = cellStart[c];
+        cluster.triangleCount = cellStart[c + 1] - cellStart[c];
+        result.clusters.push_back(cluster);
+    }
+    return result;
+}
+
+void updateClusterBounds(MeshClusters& clusters, buffer<vec3> const& position, buffer<uint3> const& connectivity) {
+    float occluderRadius = std::numeric_limits<float>::max();
+    for (vec3 const& p : position)
+        occluderRadius = std::min(occluderRadius, norm(p));
+    clusters.occluderRadius = occluderRadius;
+
+    for (MeshCluster& cluster : clusters.clusters) {
+        unsigned int const end = cluster.firstTriangle + cluster.triangleCount;
+
+        // Sphere around the bounding box
+        vec3 low = position[connectivity[cluster.firstTriangle][0]];
+        vec3 high = low;
+        vec3 normalSum = { 0, 0, 0 };
+        for (unsigned int k = cluster.firstTriangle; k < end; k++) {
+            uint3 const& face = connectivity[k];
+            for (int i = 0; i < 3; i++) {
+                vec3 const& p = position[face[i]];
+                low = { std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z) };
+                high = { std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z) };
+            }
+            normalSum += cross(position[face[1]] - position[face[0]], position[face[2]] - position[face[0]]);
+        }
+        cluster.center = (low + high) / 2.0f;
+        float radius = 0.0f;
+        for (unsigned int k = cluster.firstTriangle; k < end; k++) {
+            for (int i = 0; i < 3; i++)
+                radius = std::max(radius, norm(position[connectivity[k][i]] - cluster.center));
+        }
+        cluster.radius = radius;
+
+        // Cone around the area weighted mean normal
+        float const sumLength = norm(normalSum);
+        if (sumLength < 1e-12f) {
+            cluster.coneAxis = { 0, 0, 1 };
+            cluster.coneAngle = 2 * halfPi;
+            continue;
+        }
+        cluster.coneAxis = normalSum / sumLength;
+        float minCos = 1.0f;
+        for (unsigned int k = cluster.firstTriangle; k < end; k++) {
+            uint3 const& face = connectivity[k];
+            vec3 const n = cross(position[face[1]] - position[face[0]], position[face[2]] - position[face[0]]);
+            float const length = norm(n);
+            if (length > 1e-12f)
+                minCos = std::min(minCos, dot(n, cluster.coneAxis) / length);
+        }
+        cluster.coneAngle = std::acos(std::max(-1.0f, std::min(1.0f, minCos)));
+    }
+}
+
+bool clusterBackFacing(MeshCluster const& cluster, vec3 const& eye) {
+    vec3 const toCluster = cluster.center - eye;
+    float const distance = norm(toCluster);
+    if (distance <= cluster.radius || cluster.coneAngle >= halfPi)
+        return false;
+
+    // Every view direction towards the sphere is within spread of the direction to its center
+    float const spread = std::asin(cluster.radius / distance);
+    float const limit = halfPi - cluster.coneAngle - spread;
+    if (limit <= 0.0f)
+        return false;
+    return dot(cluster.coneAxis, toCluster) / distance > std::cos(limit);
+}
+
+bool clusterBeyondHorizon(MeshCluster const& cluster, vec3 const& eye, float occluderRadius) {
+    float const eyeDistance = norm(eye);
+    float const centerDistance = norm(cluster.center);
+    if (eyeDistance <= occluderRadius || centerDistance <= cluster.radius || occluderRadius <= 0.0f)
+        return false;
+
+    // Inside the occluder
+    float const farthest = centerDistance + cluster.radius;
+    if (farthest <= occluderRadius)
+        return true;
+
+    // A point at distance d from the center is visible up to the angle acos(R / eye) + acos(R / d) from the eye
+    float const visibleAngle = std::acos(occluderRadius / eyeDistance) + std::acos(occluderRadius / farthest);
+    float const angle = std::acos(std::max(-1.0f, std::min(1.0f, dot(eye, cluster.center) / (eyeDistance * centerDistance))));
+    float const angularRadius = std::asin(cluster.radius / centerDistance);
+    return angle - angularRadius > visibleAngle;
+}
+
+unsigned int cullClusters(MeshClusters& clusters, vec3 const& eye) {
+    clusters.counts.clear();
+    clusters.offsets.clear();
+    unsigned int submitted = 0;
+    unsigned int rangeEnd = 0;
+    for (MeshCluster const& cluster : clusters.clusters) {
+        if (clusterBackFacing(cluster, eye) || clusterBeyondHorizon(cluster, eye, clusters.occluderRadius))
+            continue;
+
+        submitted += cluster.triangleCount;
+        if (!clusters.counts.empty() && rangeEnd == cluster.firstTriangle)
+            clusters.counts.back() += GLsizei(3 * cluster.triangleCount);
+        else {
+            clusters.counts.push_back(GLsizei(3 * cluster.triangleCount));
+            clusters.offsets.push_back(reinterpret_cast<const void*>(size_t(cluster.firstTriangle) * sizeof(uint3)));
+        }
+        rangeEnd = cluster.firstTriangle + cluster.triangleCount;
+    }
+    return submitted;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+#include <vector>
+
+// Spatially coherent group of consecutive triangles of a planet index buffer
+struct MeshCluster {
+    unsigned int firstTriangle = 0;
+    unsigned int triangleCount = 0;
+
+    // Bounds in the model space of the planet, centered on the origin
+    vcl::vec3 center;
+    float radius = 0.0f;
+    vcl::vec3 coneAxis;     // Mean direction of the face normals
+    float coneAngle = 0.0f; // Half angle of the cone containing every face normal
+};
+
+struct MeshClusters {
+    std::vector<MeshCluster> clusters;
+    float occluderRadius = 0.0f; // Radius of the sphere under the whole terrain, used for the horizon culling
+
+    // Arguments of glMultiDrawElements, filled by cullClusters
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+};
+
+// Reorder the triangles so that each cluster is contiguous in the index buffer.
+// Triangles are grouped by the cell of a cube map containing their direction from the origin.
+MeshClusters partitionIntoClusters(vcl::buffer<vcl::uint3>& connectivity, vcl::buffer<vcl::vec3> const& position, int trianglesPerCluster);
+
+// Bounding spheres and normal cones, to call again each time the positions change
+void updateClusterBounds(MeshClusters& clusters, vcl::buffer<vcl::vec3> const& position, vcl::buffer<vcl::uint3> const& connectivity);
+
+// Conservative tests, the eye is in the model space of the mesh
+bool clusterBackFacing(MeshCluster const& cluster, vcl::vec3 const& eye);
+bool clusterBeyondHorizon(MeshCluster const& cluster, vcl::vec3 const& eye, float occluderRadius);
+
+// Fill the draw arguments with the clusters that may be visible, consecutive clusters are merged.
+// Returns the number of submitted triangles.
+unsigned int cullClusters(MeshClusters& clusters, vcl::vec3 const& eye);
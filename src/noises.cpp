@@ -1,5 +1,7 @@
 #include "noises.hpp"
 
+#include <algorithm>
+
 bool displayPerlinNoiseGui(perlin_noise_parameters& parameters) {
 	bool update = false;
 	update |= ImGui::SliderFloat("Persistance", &parameters.persistency, 0.1f, 0.6f);
@@ -9,7 +11,7 @@ bool displayPerlinNoiseGui(perlin_noise_parameters& parameters) {
 	return update;
 }
 
-float ridgeNoise(vcl::vec3 const& p, perlin_noise_parameters& parameters, float sharpness) {
+float ridgeNoise(vcl::vec3 const& p, perlin_noise_parameters const& parameters, float sharpness) {
 	vcl::vec3 sample = vcl::vec3(p.x + parameters.center[0] + 1.0f, p.y + parameters.center[1] + 1.0f, p.z + parameters.center[2] + 1.0f);
 	float value = 0.0f;
 	float a = 1.0f; // current magnitude
@@ -26,7 +28,7 @@ float ridgeNoise(vcl::vec3 const& p, perlin_noise_parameters& parameters, float
 	return value;
 }
 
-float perlinNoise(vcl::vec3 const& p, perlin_noise_parameters& parameters) {
+float perlinNoise(vcl::vec3 const& p, perlin_noise_parameters const& parameters) {
 	vcl::vec3 sample = vcl::vec3(p.x + parameters.center[0] + 1.0f, p.y + parameters.center[1] + 1.0f, p.z + parameters.center[2] + 1.0f);
 	float value = 0.0f;
 	float a = 1.0f; // current magnitude
@@ -39,4 +41,56 @@ float perlinNoise(vcl::vec3 const& p, perlin_noise_parameters& parameters) {
 		a *= parameters.persistency;
 	}
 	return value;
-}
\ No newline at end of file
+}
+
+static void offsetSamples(vcl::vec3 const* points, vcl::vec3* samples, size_t count, perlin_noise_parameters const& parameters) {
+	for (size_t i = 0; i < count; i++)
+		samples[i] = vcl::vec3(points[i].x + parameters.center[0] + 1.0f, points[i].y + parameters.center[1] + 1.0f, points[i].z + parameters.center[2] + 1.0f);
+}
+
+// Points per block of the batched noises, small enough for the samples to stay in the L1 cache
+static size_t const noiseBlock = 256;
+
+void ridgeNoise(vcl::vec3 const* points, float* values, size_t count, perlin_noise_parameters const& parameters, float sharpness) {
+	vcl::vec3 samples[noiseBlock];
+	for (size_t first = 0; first < count; first += noiseBlock) {
+		size_t const size = std::min(noiseBlock, count - first);
+		offsetSamples(points + first, samples, size, parameters);
+		float* const blockValues = values + first;
+		std::fill(blockValues, blockValues + size, 0.0f);
+		float a = 1.0f;
+		float f = 1.0f;
+		for (int k = 0; k < parameters.octave; k++)
+		{
+			for (size_t i = 0; i < size; i++) {
+				const float n = static_cast<float>(snoise3(samples[i].x * f, samples[i].y * f, samples[i].z * f));
+				float v = 1 - std::abs(n);
+				v = std::pow(v, sharpness);
+				blockValues[i] += v * a;
+			}
+			f *= parameters.frequency_gain;
+			a *= parameters.persistency;
+		}
+	}
+}
+
+void perlinNoise(vcl::vec3 const* points, float* values, size_t count, perlin_noise_parameters const& parameters) {
+	vcl::vec3 samples[noiseBlock];
+	for (size_t first = 0; first < count; first += noiseBlock) {
+		size_t const size = std::min(noiseBlock, count - first);
+		offsetSamples(points + first, samples, size, parameters);
+		float* const blockValues = values + first;
+		std::fill(blockValues, blockValues + size, 0.0f);
+		float a = 1.0f;
+		float f = 1.0f;
+		for (int k = 0; k < parameters.octave; k++)
+		{
+			for (size_t i = 0; i < size; i++) {
+				const float n = static_cast<float>(snoise3(samples[i].x * f, samples[i].y * f, samples[i].z * f));
+				blockValues[i] += a * n;
+			}
+			f *= parameters.frequency_gain;
+			a *= parameters.persistency;
+		}
+	}
+}
@@ -14,6 +14,11 @@ struct perlin_noise_parameters
 
 bool displayPerlinNoiseGui(perlin_noise_parameters& parameters);
 
-float ridgeNoise(vcl::vec3 const& p, perlin_noise_parameters& parameters, float sharpness);
+float ridgeNoise(vcl::vec3 const& p, perlin_noise_parameters const& parameters, float sharpness);
 
-float perlinNoise(vcl::vec3 const& p, perlin_noise_parameters& parameters);
\ No newline at end of file
+float perlinNoise(vcl::vec3 const& p, perlin_noise_parameters const& parameters);
+
+// Same values for count points at once: each octave runs over all the points, so its frequency and amplitude
+// are computed once instead of once per point
+void ridgeNoise(vcl::vec3 const* points, float* values, size_t count, perlin_noise_parameters const& parameters, float sharpness);
+void perlinNoise(vcl::vec3 const* points, float* values, size_t count, perlin_noise_parameters const& parameters);
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "opengl_extensions.hpp"
+
+#include <iostream>
+
+OpenGLExtensions glExtensions;
+
+bool openglVersionAtLeast(int major, int minor) {
+    GLint currentMajor = 0, currentMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &currentMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &currentMinor);
+    return currentMajor > major || (currentMajor == major && currentMinor >= minor);
+}
+
+bool openglHasExtension(std::string const& name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        char const* extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension != nullptr && name == extension)
+            return true;
+    }
+    return false;
+}
+
+void loadOpenGLExtensions() {
+    if (openglVersionAtLeast(4, 5) || openglHasExtension("GL_ARB_clip_control")) {
+        glExtensions.ClipControl = (PFNGLCLIPCONTROLPROC)glfwGetProcAddress("glClipControl");
+        glExtensions.clipControl = glExtensions.ClipControl != nullptr;
+    }
+    std::cout << "Clip control " << (glExtensions.clipControl ? "available" : "not available") << std::endl;
+    glExtensions.textureCompressionS3TC = openglHasExtension("GL_EXT_texture_compression_s3tc");
+
+    if (openglVersionAtLeast(4, 1) || openglHasExtension("GL_ARB_get_program_binary")) {
+        glExtensions.GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+        glExtensions.ProgramBinary = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+        glExtensions.ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+        // Some drivers expose the entry points but no format to save
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        glExtensions.programBinary = glExtensions.GetProgramBinary != nullptr && glExtensions.ProgramBinary != nullptr && glExtensions.ProgramParameteri != nullptr && formats > 0;
+    }
+
+    if (openglHasExtension("GL_KHR_parallel_shader_compile"))
+        glExtensions.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    else if (openglHasExtension("GL_ARB_parallel_shader_compile"))
+        glExtensions.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    glExtensions.parallelShaderCompile = glExtensions.MaxShaderCompilerThreads != nullptr;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+// OpenGL entry points above the 3.3 core profile loaded by GLAD.
+// They are queried at runtime and only used when the driver exposes them.
+
+#ifndef GL_ZERO_TO_ONE
+#define GL_LOWER_LEFT 0x8CA1
+#define GL_NEGATIVE_ONE_TO_ONE 0x935E
+#define GL_ZERO_TO_ONE 0x935F
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP PFNGLCLIPCONTROLPROC)(GLenum origin, GLenum depth);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+struct OpenGLExtensions {
+    bool clipControl = false; // GL 4.5 or ARB_clip_control
+    PFNGLCLIPCONTROLPROC ClipControl = nullptr;
+    bool textureCompressionS3TC = false; // BC1 textures
+
+    bool programBinary = false; // GL 4.1 or ARB_get_program_binary, with at least one binary format
+    PFNGLGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYPROC ProgramBinary = nullptr;
+    PFNGLPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+
+    bool parallelShaderCompile = false; // KHR_parallel_shader_compile or its ARB version
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads = nullptr;
+};
+
+extern OpenGLExtensions glExtensions;
+
+// Requires a current context
+void loadOpenGLExtensions();
+bool openglVersionAtLeast(int major, int minor);
+bool openglHasExtension(std::string const& name);
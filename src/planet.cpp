@@ -2,252 +2,350 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <thread>
+#include <chrono>
 
 #include "planet.hpp"
 #include "icosphere.hpp"
 #include "vcl/vcl.hpp"
 #include "noises.hpp"
 #include "mesh_drawable_multitexture.hpp"
+#include "shader_variants.hpp"
+#include "trace.hpp"
+#include "planet_bake.hpp"
+#include "mapped_file.hpp"
+#include "planet_file.hpp"
+#include "gl_task_queue.hpp"
 
 #define N_THREADS 5
 
 using namespace vcl;
 
-// Helper functions
-static float smoothMax(float a, float b, float k) {
-    return std::log(std::exp(a * k) + std::exp(b * k)) / k;
-}
-
-static float blend(float noise, float blending) {
-    return std::atan(noise * blending) / pi + 0.5f;
-}
-
-static std::vector<size_t> importerLookupTable;
-static std::vector<char> importerMemberSizes;
-
-static bool little_endian;
-
-static void buildImporterLookupTable() {
-    importerLookupTable.resize(0);
-    importerLookupTable.push_back(offsetof(Planet, radius));
-    importerLookupTable.push_back(offsetof(Planet, rotateSpeed));
-    importerLookupTable.push_back(offsetof(Planet, flatLowColor));
-    importerLookupTable.push_back(offsetof(Planet, flatHighColor));
-    importerLookupTable.push_back(offsetof(Planet, steepColor));
-    importerLookupTable.push_back(offsetof(Planet, maxSlope));
-    importerLookupTable.push_back(offsetof(Planet, continentParameters));
-    importerLookupTable.push_back(offsetof(Planet, mountainsParameters));
-    importerLookupTable.push_back(offsetof(Planet, maskParameters));
-    importerLookupTable.push_back(offsetof(Planet, mountainSharpness));
-    importerLookupTable.push_back(offsetof(Planet, mountainsBlend));
-    importerLookupTable.push_back(offsetof(Planet, maskShift));
-    importerLookupTable.push_back(offsetof(Planet, oceanFloorDepth));
-    importerLookupTable.push_back(offsetof(Planet, oceanFloorSmoothing));
-    importerLookupTable.push_back(offsetof(Planet, oceanDepthMultiplier));
-    importerLookupTable.push_back(offsetof(Planet, waterLevel));
-    importerLookupTable.push_back(offsetof(Planet, waterColorSurface));
-    importerLookupTable.push_back(offsetof(Planet, waterColorDeep));
-    importerLookupTable.push_back(offsetof(Planet, depthMultiplier));
-    importerLookupTable.push_back(offsetof(Planet, waterBlendMultiplier));
-    importerLookupTable.push_back(offsetof(Planet, textureScale));
-    importerLookupTable.push_back(offsetof(Planet, textureSharpness));
-    importerLookupTable.push_back(offsetof(Planet, normalMapInfluence));
-    importerLookupTable.push_back(offsetof(Planet, hasAtmosphere));
-    importerLookupTable.push_back(offsetof(Planet, atmosphereHeight));
-    importerLookupTable.push_back(offsetof(Planet, densityFalloff));
-    importerLookupTable.push_back(offsetof(Planet, wavelengths));
-    importerLookupTable.push_back(offsetof(Planet, scatteringStrength));
-
-    importerMemberSizes.push_back(sizeof(Planet::radius));
-    importerMemberSizes.push_back(sizeof(Planet::rotateSpeed));
-    importerMemberSizes.push_back(sizeof(Planet::flatLowColor));
-    importerMemberSizes.push_back(sizeof(Planet::flatHighColor));
-    importerMemberSizes.push_back(sizeof(Planet::steepColor));
-    importerMemberSizes.push_back(sizeof(Planet::maxSlope));
-    importerMemberSizes.push_back(sizeof(Planet::continentParameters));
-    importerMemberSizes.push_back(sizeof(Planet::mountainsParameters));
-    importerMemberSizes.push_back(sizeof(Planet::maskParameters));
-    importerMemberSizes.push_back(sizeof(Planet::mountainSharpness));
-    importerMemberSizes.push_back(sizeof(Planet::mountainsBlend));
-    importerMemberSizes.push_back(sizeof(Planet::maskShift));
-    importerMemberSizes.push_back(sizeof(Planet::oceanFloorDepth));
-    importerMemberSizes.push_back(sizeof(Planet::oceanFloorSmoothing));
-    importerMemberSizes.push_back(sizeof(Planet::oceanDepthMultiplier));
-    importerMemberSizes.push_back(sizeof(Planet::waterLevel));
-    importerMemberSizes.push_back(sizeof(Planet::waterColorSurface));
-    importerMemberSizes.push_back(sizeof(Planet::waterColorDeep));
-    importerMemberSizes.push_back(sizeof(Planet::depthMultiplier));
-    importerMemberSizes.push_back(sizeof(Planet::waterBlendMultiplier));
-    importerMemberSizes.push_back(sizeof(Planet::textureScale));
-    importerMemberSizes.push_back(sizeof(Planet::textureSharpness));
-    importerMemberSizes.push_back(sizeof(Planet::normalMapInfluence));
-    importerMemberSizes.push_back(sizeof(Planet::hasAtmosphere));
-    importerMemberSizes.push_back(sizeof(Planet::atmosphereHeight));
-    importerMemberSizes.push_back(sizeof(Planet::densityFalloff));
-    importerMemberSizes.push_back(sizeof(Planet::wavelengths));
-    importerMemberSizes.push_back(sizeof(Planet::scatteringStrength));
-
-
-    // Check wether or not the system is little endian
-    union {
-        uint32_t i;
-        char c[4];
-    } bint = { 0x01020304 };
-    little_endian = (bint.c[0] != 1);
-}
-
 // Planet members declaration
 mesh_drawable_multitexture Planet::postProcessingQuad;
-GLuint Planet::shader = (GLuint)-1;
+ShaderVariants Planet::terrainShaders;
+ShaderVariants Planet::waterShaders;
 GLuint Planet::fbo;
 GLuint Planet::depth_buffer;
 GLuint Planet::intermediate_image;
-GLuint Planet::intermediate_image_bis;
-bool Planet::base_intermediate_image;
+GLuint Planet::presentShader;
+ScatteringPassPlan Planet::scatteringPlan;
+gl_framebuffer Planet::scatteringFbo;
+gl_texture Planet::scatteringImage;
+gl_texture Planet::scatteringDepth;
+unsigned int Planet::screenWidth;
+unsigned int Planet::screenHeight;
+unsigned int Planet::frameIndex = 0;
+std::string Planet::bakeDirectory = "bake";
+std::string Planet::cacheDirectory = "cache";
+static size_t const uploadSliceBytes = size_t(1) << 20; // Per call of the upload task, between two checks of the budget
+int Planet::coarseDivision = 50;
+ResidencySettings Planet::residencySettings;
+ResidencyStats Planet::residencyStats;
 int Planet::nScatteringPoints = 15;
 int Planet::nOpticalDepthPoints = 15;
-float Planet::nearPlane;
-float Planet::interPlane;
-float Planet::farPlane;
+ScatteringSettings Planet::scatteringSettings;
 
 vec3 Planet::getPlanetRadiusAt(const vec3& posOnUnitSphere) {
-    // Continent (simple perlin noise)
-    float const perlin_noise = perlinNoise(posOnUnitSphere, continentParameters);
-    
-    // Moutains
-    float moutainMask = blend(perlinNoise(posOnUnitSphere, maskParameters) + maskShift, mountainsBlend);
-    float const ridges = ridgeNoise(posOnUnitSphere, mountainsParameters, mountainSharpness) * moutainMask * mountainsBlend;
+    return terrainPosition(terrainParameters(), posOnUnitSphere);
+}
 
-    // Ocean bed
-    float oceanFloorShape = -oceanFloorDepth + perlin_noise * 0.15f;
-    float continentShape = smoothMax(perlin_noise, oceanFloorShape, oceanFloorSmoothing);
-    continentShape *= (continentShape < 0) ? 1 + oceanDepthMultiplier : 1;
 
-    vec3 newPosition = radius * posOnUnitSphere * (1 + (ridges + continentShape) * 0.03f);
-    return newPosition;
-}
 
+Planet::Planet(const char* name, float mass, vcl::vec3 position, vcl::vec3 velocity, int division) : name(name) {
+    TraceScope trace("Planet::Planet", name);
+    std::string path = "planets/" + std::string(name) + ".pbf";
+    importFromFile(path.c_str());
+    initialize(mass, position, velocity, division);
+}
 
+Planet::Planet(const char* name, float mass, Planet* parent, float distanceToParent, float phase, int division)
+    : Planet(name, mass, orbitPosition(parent, distanceToParent, phase), orbitVelocity(parent, distanceToParent, phase), division) {
+}
 
-Planet::Planet(char* name, float mass, vcl::vec3 position, vcl::vec3 velocity, int division) {
+Planet::Planet(SystemPlanet const& planet, Planet* parent)
+    : PlanetParameters(planet.parameters), name(planet.name), packedBake(planet.bake), packedBakeSize(planet.bakeSize) {
+    TraceScope trace("Planet::Planet", name);
+    PlanetOrbit const& orbit = planet.orbit;
+    float const mass = orbit.gravitationalParameter / PhysicsComponent::G;
+    if (parent == nullptr)
+        initialize(mass, orbit.position, orbit.velocity, orbit.division);
+    else {
+        float const phase = orbit.randomPhase ? rand_interval(0.0f, 2 * 3.14f) : orbit.phase;
+        initialize(mass, orbitPosition(parent, orbit.distance, phase), orbitVelocity(parent, orbit.distance, phase) + orbit.velocity, orbit.division);
+    }
+}
 
+void Planet::initialize(float mass, vcl::vec3 position, vcl::vec3 velocity, int division) {
     // Planet mesh
     //m = mesh_primitive_sphere();
-    m = mesh_icosphere(radius, division);
-    visual = mesh_drawable(m, shader);
+    // Coarse until the residency refines it, see updateResidency
+    fullDivision = division;
+    refined = division <= coarseDivision;
+    topology = icosphere_topology(std::min(division, coarseDivision), LOW_RES_DIVISION, TRIANGLES_PER_CLUSTER);
+    initializeSurface(surface, *topology);
     visual.shading.color = { 1.0f, 1.0f, 1.0f };
-    visual.shading.phong.specular = 0.0f;
+    visual.shading.phong.specular = specular;
     visual.shading.phong.ambient = 0.01f;
-
-    // Low res planet
-    mLowRes = mesh_icosphere(radius, 100);
-    visualLowRes = mesh_drawable(mLowRes, shader);
-    visualLowRes.shading.color = { 1.0f, 1.0f, 1.0f };
-    visualLowRes.shading.phong.specular = 0.0f;
-    visualLowRes.shading.phong.ambient = 0.01f;
-    
-    
-    std::string path = "planets/" + std::string(name) + ".pbf";
-    importFromFile(path.c_str());
-    //updatePlanetMesh();
+    visualLowRes.shading = visual.shading;
 
     // Texture
     //image_raw const im = image_load_png("assets/checker_texture.png");
-    image_raw const im = image_load_png("assets/moon_normal_map1.png");
-    GLuint const planetTexture = opengl_texture_to_gpu(im, GL_REPEAT, GL_REPEAT);
-    visual.texture = planetTexture;
-    visualLowRes.texture = planetTexture;
+    normalMap = assetManager().texture("assets/moon_normal_map1.png", GL_REPEAT, GL_REPEAT);
+    visual.texture = normalMap->id();
+    buildDrawables(planet_mesh_drawable(*topology, visual.shader));
 
     // Physics
     physics = PhysicsComponent::generatePhysicsComponent(mass, position, velocity);
 }
 
-Planet::Planet(char* name, float mass, Planet* parent, float distanceToParent, float phase, int division) {
-    vcl::vec3 position = parent->getPosition() + distanceToParent * vcl::vec3(std::cos(phase), std::sin(phase), 0.0f);
-    vcl::vec3 velocity = std::sqrt(PhysicsComponent::G * parent->physics->get_mass() / distanceToParent) * vcl::vec3(-std::sin(phase), std::cos(phase), 0.0f) + parent->getSpeed();
-    *this = Planet(name, mass, position, velocity, division);
+void Planet::buildDrawables(planet_mesh_drawable&& full) {
+    full.shader = visual.shader;
+    full.texture = visual.texture;
+    full.transform = visual.transform;
+    full.shading = visual.shading;
+    // The low res mesh uses a subset of the vertices of the full mesh
+    planet_mesh_drawable lowRes(full, *topology, 1);
+    lowRes.transform = visualLowRes.transform;
+    lowRes.shading = visualLowRes.shading;
+    visual = std::move(full);
+    visualLowRes = std::move(lowRes);
 }
 
+vcl::vec3 Planet::orbitPosition(Planet* parent, float distanceToParent, float phase) {
+    return parent->getPosition() + distanceToParent * vcl::vec3(std::cos(phase), std::sin(phase), 0.0f);
+}
 
+vcl::vec3 Planet::orbitVelocity(Planet* parent, float distanceToParent, float phase) {
+    return std::sqrt(PhysicsComponent::G * parent->physics->get_mass() / distanceToParent) * vcl::vec3(-std::sin(phase), std::cos(phase), 0.0f) + parent->getSpeed();
+}
 
-void Planet::updateFragmentMesh(vcl::uint2 division) {
-    for (int i = division.x; i < division.y; i++) {
-        // Position
-        const vec3 posOnUnitSphere = normalize(m.position[i]);
-        m.position[i] = getPlanetRadiusAt(posOnUnitSphere);
-        float height = norm(m.position[i]);
 
-        // Color
-        float stepSize = 0.02f;
-        vec3 direction;
-        if (std::abs(posOnUnitSphere.z) < 1.0f - 0.00001f)
-            direction = normalize(cross(posOnUnitSphere, vec3(0.0f, 0.0f, 1.0f)));
-        else
-            direction = normalize(cross(posOnUnitSphere, vec3((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX)));
 
-        float slopeEstimate = std::abs(norm(getPlanetRadiusAt(normalize(posOnUnitSphere + stepSize * direction))) - height) / stepSize;
-        direction = cross(posOnUnitSphere, direction);
-        slopeEstimate = std::max(slopeEstimate, std::abs(norm(getPlanetRadiusAt(normalize(posOnUnitSphere + stepSize * direction))) - height) / stepSize);
-        float blending = std::min(slopeEstimate / (maxSlope * radius), 1.0f);
-        m.color[i] = vec3(height / (2 * radius), blending, 0.0f);
+// Reads no member of the planet, so that the refinement runs on a worker thread while the planet is drawn
+static PlanetLevel buildPlanetLevel(std::string const& name, TerrainParameters const& terrain, unsigned char const* packedBake, size_t packedBakeSize, int division) {
+    TraceScope trace("buildPlanetLevel", name + " " + std::to_string(division));
+    PlanetLevel level;
+    level.topology = icosphere_topology(division, LOW_RES_DIVISION, TRIANGLES_PER_CLUSTER);
+    level.terrainKey = terrainBakeKey(terrain);
+    IcosphereTopology const& topology = *level.topology;
+    PlanetBake bake;
+    // The bake of the system pack first, then the bake directory and the runtime cache. A stale one falls back on the next.
+    bool loaded = packedBake != nullptr && parsePlanetBake(packedBake, packedBakeSize, topology, level.terrainKey, bake);
+    for (std::string const& directory : { Planet::bakeDirectory, Planet::cacheDirectory }) {
+        if (loaded || directory.empty())
+            continue;
+        MappedFile const file(planetBakePath(directory, name, topology.division));
+        loaded = file.valid() && parsePlanetBake(file.data(), file.size(), topology, level.terrainKey, bake);
+    }
+    if (loaded) {
+        level.surface = std::move(bake.surface);
+        level.vegetation = std::move(bake.anchors);
+        level.onDisk = true;
     }
+    else {
+        initializeSurface(level.surface, topology);
+        generateSurface(terrain, topology, level.surface, N_THREADS);
+    }
+    return level;
 }
 
+static PlanetLevel buildPackedPlanetLevel(std::string const& name, TerrainParameters const& terrain, unsigned char const* packedBake, size_t packedBakeSize, int division) {
+    PlanetLevel level = buildPlanetLevel(name, terrain, packedBake, packedBakeSize, division);
+    level.heightRange = planetHeightRange(level.surface.positions);
+    level.vertices = packPlanetVertices(level.surface.positions, level.surface.normals, level.surface.slopes, level.heightRange);
+    return level;
+}
 
+static void cachePlanetLevel(std::string const& name, std::shared_ptr<IcosphereTopology const> const& topology, PlanetBake const& bake, uint64_t terrainKey) {
+    TraceScope trace("cachePlanetLevel", name);
+    createBakeDirectory(Planet::cacheDirectory);
+    std::string const path = planetBakePath(Planet::cacheDirectory, name, topology->division);
+    if (!writeFileAtomically(path, serializePlanetBake(bake, *topology, terrainKey)))
+        std::cerr << "ERROR : failed to write the cache " << path << std::endl;
+}
 
-void Planet::updatePlanetMesh() {
-    continentParameters.octave = (int)continentParameters.octave;
-    mountainsParameters.octave = (int)mountainsParameters.octave;
-    maskParameters.octave = (int)maskParameters.octave;
-
-    int size = (int)m.position.size();
-    int divisionSize = size / N_THREADS;
-    std::vector<std::thread> threads(N_THREADS);
-    int index = 0;
-    for (int i = 0; i < N_THREADS; i++) {
-        vcl::uint2 division;
-        division.x = index;
-        division.y = (i == N_THREADS-1 ? size : index + divisionSize);
-        index = division.y;
-        threads[i] = std::thread(&Planet::updateFragmentMesh, this, division);
+void Planet::initializePlanetMesh() {
+    PlanetLevel level = buildPlanetLevel(name, terrainParameters(), packedBake, packedBakeSize, std::min(fullDivision, coarseDivision));
+    surface = std::move(level.surface);
+    vegetation = std::move(level.vegetation);
+    surfaceOnDisk = level.onDisk;
+}
+
+void Planet::setLevel(PlanetLevel&& level) {
+    topology = std::move(level.topology);
+    surface = std::move(level.surface);
+    vegetation = std::move(level.vegetation);
+    surfaceOnDisk = level.onDisk;
+    buildDrawables(planet_mesh_drawable(*topology, visual.shader));
+    updateVisual();
+}
+
+Residency Planet::residency() const {
+    if (refined)
+        return Residency::Full;
+    return refinement.valid() || uploading.topology ? Residency::Loading : Residency::Coarse;
+}
+
+// The topologies are shared by the planets of the same division, each one counts its share
+static PlanetMemory topologyShare(std::shared_ptr<IcosphereTopology const> const& topology) {
+    PlanetMemory memory;
+    if (!topology)
+        return memory;
+    size_t const users = size_t(std::max(1L, long(topology.use_count())));
+    memory.cpu = topologyBytes(*topology) / users;
+    memory.gpu = topology->bufferBytes() / users;
+    return memory;
+}
+
+PlanetMemory Planet::memory() const {
+    PlanetMemory memory = topologyShare(topology);
+    memory.cpu += surfaceBytes(surface) + vegetation.size() * sizeof(vec3);
+    memory.gpu += topology->directions.size() * sizeof(PlanetVertex);
+    PlanetMemory const coarse = topologyShare(coarseLevel.topology);
+    memory.cpu += coarse.cpu + surfaceBytes(coarseLevel.surface) + coarseLevel.vegetation.size() * sizeof(vec3);
+    return memory;
+}
+
+PlanetMemory Planet::fullMemory() const {
+    PlanetMemory memory;
+    if (fullDivision <= coarseDivision)
+        return memory;
+    unsigned int const step = icosphere_lod_step(fullDivision, LOW_RES_DIVISION);
+    size_t const vertices = icosphere_vertex_count(icosphere_nested_division(fullDivision, step));
+    size_t const triangles = 2 * vertices - 4;
+    // The whole topology, another planet of the same division may release it first
+    size_t const topologyBytes = vertices * sizeof(vec3) + (triangles + triangles / (step * step)) * sizeof(uint3);
+    memory.cpu = vertices * (2 * sizeof(vec3) + sizeof(float)) + topologyBytes;
+    memory.gpu = vertices * sizeof(PlanetVertex) + topologyBytes;
+    return memory;
+}
+
+void Planet::refine() {
+    if (refined || refinement.valid())
+        return;
+    refinement = std::async(std::launch::async, buildPackedPlanetLevel, name, terrainParameters(), packedBake, packedBakeSize, fullDivision);
+}
+
+void Planet::finishRefinement(int priority) {
+    if (!refinement.valid() || refinement.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    uploading = refinement.get();
+    uploadedVertices = 0;
+    // Copied to the GPU by slices within the budget of the frames. The planets live as long as the queue is drained.
+    glTasks().post([this]() {
+        size_t bytes = uploadSliceBytes;
+        return uploadSome(bytes) ? size_t(0) : uploadBacklog();
+    }, priority, uploadBacklog());
+}
+
+size_t Planet::uploadBacklog() const {
+    if (!uploading.topology)
+        return 0;
+    size_t const topologyBytes = uploading.topology->bufferBytes();
+    return topologyBytes - std::min(topologyBytes, uploading.topology->uploadedBytes) + (uploading.vertices.size() - uploadedVertices) * sizeof(PlanetVertex);
+}
+
+bool Planet::uploadSome(size_t& bytes) {
+    if (!uploading.topology)
+        return true;
+    if (!uploading.topology->uploadSome(bytes))
+        return false;
+    if (!uploadingVisual.vao)
+        uploadingVisual = planet_mesh_drawable(*uploading.topology, visual.shader);
+    size_t const count = std::min(uploading.vertices.size() - uploadedVertices, bytes / sizeof(PlanetVertex));
+    uploadingVisual.uploadVertices(uploading.vertices.data() + uploadedVertices, uploadedVertices, count);
+    uploadedVertices += count;
+    bytes -= count * sizeof(PlanetVertex);
+    if (uploadedVertices < uploading.vertices.size())
+        return false;
+
+    // Edited in the interface meanwhile, refined again from the new parameters if still needed
+    if (uploading.terrainKey == terrainBakeKey(terrainParameters())) {
+        TraceScope trace("Refine planet", name);
+        coarseLevel.topology = topology;
+        coarseLevel.surface = std::move(surface);
+        coarseLevel.vegetation = std::move(vegetation);
+        coarseLevel.terrainKey = uploading.terrainKey;
+        coarseLevel.onDisk = surfaceOnDisk;
+        topology = std::move(uploading.topology);
+        surface = std::move(uploading.surface);
+        vegetation = std::move(uploading.vegetation);
+        surfaceOnDisk = uploading.onDisk;
+        uploadingVisual.heightRange = uploading.heightRange;
+        buildDrawables(std::move(uploadingVisual));
+        refined = true;
+    }
+    uploading = PlanetLevel();
+    uploadingVisual = planet_mesh_drawable();
+    return true;
+}
+
+void Planet::evictDetail() {
+    if (!refined || !coarseLevel.topology)
+        return;
+    TraceScope trace("Evict planet", name);
+    uint64_t const key = terrainBakeKey(terrainParameters());
+    // Loading a generated surface back is faster than generating it again. Waits for the previous write, if any.
+    if (!surfaceOnDisk && !cacheDirectory.empty()) {
+        PlanetBake bake;
+        bake.surface = std::move(surface);
+        bake.anchors = std::move(vegetation);
+        caching = std::async(std::launch::async, cachePlanetLevel, name, topology, std::move(bake), key);
     }
-    for (int i = 0; i < N_THREADS; i++) {
-        threads[i].join();
+    // Edited while refined, the coarse level is cheap to generate again
+    if (coarseLevel.terrainKey != key)
+        coarseLevel = buildPlanetLevel(name, terrainParameters(), packedBake, packedBakeSize, std::min(fullDivision, coarseDivision));
+    setLevel(std::move(coarseLevel));
+    coarseLevel = PlanetLevel();
+    refined = false;
+}
+
+void Planet::waitBackgroundWork() {
+    if (refinement.valid())
+        refinement.wait();
+    if (caching.valid())
+        caching.wait();
+}
+
+void Planet::updateResidency(std::vector<Planet>& planets, vcl::vec3 const& viewer, vcl::vec3 const& velocity, Frustum const& frustum) {
+    std::vector<ResidencyRequest> requests(planets.size());
+    std::vector<float> distances(planets.size());
+    for (size_t i = 0; i < planets.size(); i++) {
+        Planet& planet = planets[i];
+        requests[i].center = planet.getPosition();
+        requests[i].radius = planet.radius;
+        requests[i].visible = sphereInFrustum(frustum, requests[i].center, planet.getBoundingRadius());
+        requests[i].state = planet.residency();
+        requests[i].memory = planet.memory();
+        requests[i].fullMemory = planet.fullMemory();
+        distances[i] = prefetchDistance(viewer, velocity, requests[i].center, requests[i].radius, residencySettings.prefetchTime);
     }
-    m.compute_normal();
-
-    for (int i = 0; i < mLowRes.position.size(); i++) {
-        // Position
-        const vec3 posOnUnitSphere = normalize(mLowRes.position[i]);
-        mLowRes.position[i] = getPlanetRadiusAt(posOnUnitSphere);
-        float height = norm(mLowRes.position[i]);
-
-        // Color
-        float stepSize = 0.02f;
-        vec3 direction;
-        if (std::abs(posOnUnitSphere.z) < 1.0f - 0.00001f)
-            direction = normalize(cross(posOnUnitSphere, vec3(0.0f, 0.0f, 1.0f)));
-        else
-            direction = normalize(cross(posOnUnitSphere, vec3((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX)));
-
-        float slopeEstimate = std::abs(norm(getPlanetRadiusAt(normalize(posOnUnitSphere + stepSize * direction))) - height) / stepSize;
-        direction = cross(posOnUnitSphere, direction);
-        slopeEstimate = std::max(slopeEstimate, std::abs(norm(getPlanetRadiusAt(normalize(posOnUnitSphere + stepSize * direction))) - height) / stepSize);
-        float blending = std::min(slopeEstimate / (maxSlope * radius), 1.0f);
-        mLowRes.color[i] = vec3(height / (2 * radius), blending, 0.0f);
+
+    // The built planets are uploaded by the GL task queue, the first in the order of refinement first
+    std::vector<size_t> const order = refinementOrder(requests, viewer, distances);
+    for (size_t rank = 0; rank < order.size(); rank++)
+        planets[order[rank]].finishRefinement(int(order.size() - rank));
+
+    std::vector<ResidencyAction> const actions = planResidency(requests, viewer, velocity, residencySettings);
+    for (size_t i = 0; i < planets.size(); i++) {
+        if (actions[i] == ResidencyAction::Refine)
+            planets[i].refine();
+        else if (actions[i] == ResidencyAction::Evict)
+            planets[i].evictDetail();
     }
-    mLowRes.compute_normal();
+    residencyStats = summarizeResidency(requests, residencySettings);
 }
 
-void Planet::updateVisual() {
-    visual.update_position(m.position);
-    visual.update_normal(m.normal);
-    visual.update_color(m.color);
+void Planet::updatePlanetMesh() {
+    TraceScope trace("updatePlanetMesh");
+    generateSurface(terrainParameters(), *topology, surface, N_THREADS);
+    surfaceOnDisk = false;
+}
 
-    visualLowRes.update_position(mLowRes.position);
-    visualLowRes.update_normal(mLowRes.normal);
-    visualLowRes.update_color(mLowRes.color);
+void Planet::updateVisual() {
+    TraceScope trace("updateVisual");
+    visual.update(surface.positions, surface.normals, surface.slopes);
+    visualLowRes.heightRange = visual.heightRange; // Shares the vertex buffer of visual
 }
 
 vcl::vec3 Planet::getPosition() {
@@ -258,7 +356,12 @@ vcl::vec3 Planet::getSpeed() {
     return physics->get_speed();
 }
 
+float Planet::getBoundingRadius() {
+    return radius * (hasAtmosphere ? std::max(atmosphereHeight, 1.3f) : 1.3f);
+}
+
 void Planet::setCustomUniforms() {
+    GLuint const shader = visual.shader;
     glUseProgram(shader);
     opengl_uniform(shader, "textureScale", textureScale);
     opengl_uniform(shader, "textureSharpness", textureSharpness);
@@ -266,10 +369,37 @@ void Planet::setCustomUniforms() {
     opengl_uniform(shader, "steepColor", steepColor);
     opengl_uniform(shader, "flatLowColor", flatLowColor);
     opengl_uniform(shader, "flatHighColor", flatHighColor);
-    opengl_uniform(shader, "isSun", isSun);
+    opengl_uniform(shader, "planetRadius", radius);
     
 }
 
+unsigned int Planet::shaderFeatures() const {
+    unsigned int features = 0;
+    if (isSun)
+        features |= SunFeature;
+    if (waterGlow)
+        features |= WaterGlowFeature;
+    if (specularWater)
+        features |= SpecularWaterFeature;
+    if (hasAtmosphere)
+        features |= AtmosphereFeature;
+    return features;
+}
+
+void Planet::requestShaderVariants() const {
+    unsigned int const features = shaderFeatures();
+    terrainShaders.request(features & SunFeature);
+    waterShaders.request(features);
+}
+
+void Planet::selectShaderVariants() {
+    unsigned int const features = shaderFeatures();
+    // The terrain only depends on the sun feature, the other bits would compile identical programs
+    visual.shader = terrainShaders.program(features & SunFeature);
+    visualLowRes.shader = visual.shader;
+    waterShader = waterShaders.program(features);
+}
+
 void Planet::updateRotation(float deltaTime) {
     vcl::rotation rot({ 0.0f, 0.0f, 1.0f }, deltaTime * rotateSpeed);
     visual.transform.rotate = rot * visual.transform.rotate;
@@ -277,64 +407,29 @@ void Planet::updateRotation(float deltaTime) {
 }
 
 void Planet::exportToFile(const char* path) {
-    if (!importerLookupTable.size())
-        buildImporterLookupTable();
-
-    std::ofstream file(path, std::ofstream::binary);
-    if (!file.is_open()) {
-        std::cerr << "ERROR : failed to open file at path " << path << std::endl;
-        return;
-    }
     std::cout << "Writing to file " << path << std::endl;
-    
-    char buffer[512];
-    int idx = 0;
-    for (int i = 0; i < importerLookupTable.size(); i++) {
-        char size = importerMemberSizes[i];
-        buffer[idx++] = size;
-        for (int j = 0; j < size; j++)
-            buffer[idx++] = *((char*)this + importerLookupTable[i] + j);
-    }
-    file.write(buffer, idx);
-    file.close();
+    if (!writePlanetFile(path, *this))
+        std::cerr << "ERROR : failed to write file at path " << path << std::endl;
 }
 
 void Planet::importFromFile(const char* path) {
-    if (!importerLookupTable.size())
-        buildImporterLookupTable();
-
-    std::ifstream file(path, std::ifstream::binary);
-    if (!file.is_open()) {
+    TraceScope trace("importFromFile", path);
+    if (!readPlanetFile(path, *this))
         std::cerr << "ERROR : failed to read file at path " << path << std::endl;
-        return;
-    }
-    file.seekg(0, file.end);
-    int fileSize = file.tellg();
-    file.seekg(0, file.beg);
-    char* buffer = new char[fileSize];
-    file.read(buffer, fileSize);
-   
-    int idx = 0;
-    int i = 0;
-    while (idx < fileSize) {
-        char size = buffer[idx++];
-        for (int j = 0; j < size; j++) {
-            if (little_endian)
-                *((char*)this + importerLookupTable[i] + j) = buffer[idx++];
-            else
-                std::cerr << "ERROR: BIG_ENDIAN NOT SUPPORTED\n";
-        }
-            
-        i++;
-    }
 }
 
 
 // STATIC FUNCTIONS
 
-void Planet::initPlanetRenderer(const unsigned int width, const unsigned int height) {
-    // Planet shader
-    shader = opengl_create_shader_program(read_text_file(("shaders/planet/planet.vert.glsl")), read_text_file("shaders/planet/planet.frag.glsl"));
+void Planet::initPlanetRenderer(const unsigned int width, const unsigned int height, DepthSettings const& depth) {
+    // Planet shaders, the terrain writes its own depth when the depth buffer is logarithmic.
+    // The variants are compiled when the planets select them.
+    std::vector<std::string> const features = { "SUN", "WATER_GLOW", "SPECULAR_WATER", "ATMOSPHERE" };
+    std::vector<std::string> defines;
+    if (depth.mode == DepthMode::Logarithmic)
+        defines.push_back("LOGARITHMIC_DEPTH");
+    terrainShaders = ShaderVariants("shaders/planet/planet.vert.glsl", "shaders/planet/planet.frag.glsl", features, defines);
+    waterShaders = ShaderVariants("shaders/planet/water.vert.glsl", "shaders/planet/water.frag.glsl", features);
 
     // Fbo
     buildFbo(width, height);
@@ -344,19 +439,37 @@ void Planet::initPlanetRenderer(const unsigned int width, const unsigned int hei
     postProcessingQuad.texture = intermediate_image;
     postProcessingQuad.texture_2 = depth_buffer;
 
-    GLuint const shader_screen_render = opengl_create_shader_program(read_text_file("shaders/planet/water.vert.glsl"), read_text_file("shaders/planet/water.frag.glsl"));
-    postProcessingQuad.shader = shader_screen_render;
+    presentShader = programCache().create(read_text_file("shaders/planet/water.vert.glsl"), read_text_file("shaders/planet/present.frag.glsl"));
     buildTextures(width, height);
 }
 
+void Planet::releasePlanetRenderer() {
+    scatteringFbo.reset();
+    scatteringImage.reset();
+    scatteringDepth.reset();
+}
+
 void Planet::buildFbo(const unsigned int width, const unsigned int height) {
     glGenFramebuffers(1, &fbo);
     glGenTextures(1, &depth_buffer);
     glGenTextures(1, &intermediate_image);
-    glGenTextures(1, &intermediate_image_bis);
+
+    scatteringFbo = gl_framebuffer::create();
+    scatteringImage = gl_texture::create();
+    scatteringDepth = gl_texture::create();
 
     buildTextures(width, height);
 
+    // Scattering target: inscattered light in the first attachment, view distance in the second
+    glBindFramebuffer(GL_FRAMEBUFFER, scatteringFbo.id());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scatteringImage.id(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, scatteringDepth.id(), 0);
+    GLenum const drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    opengl_check;
+
+    assert_vcl(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Error : Scattering framebuffer is not complete");
+
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, intermediate_image, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_buffer, 0);
@@ -376,51 +489,177 @@ void Planet::buildTextures(const unsigned int width, const unsigned int height)
 
     opengl_check;
 
-    // Texture color buffer
-    glBindTexture(GL_TEXTURE_2D, intermediate_image_bis);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    // Texture depth buffer
+    glBindTexture(GL_TEXTURE_2D, depth_buffer);
+    // Floating point depth: reverse-Z keeps its precision up to the farthest planet
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     opengl_check;
 
-    // Texture depth buffer
-    glBindTexture(GL_TEXTURE_2D, depth_buffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    screenWidth = width;
+    screenHeight = height;
+    buildScatteringTextures(scatteringResolution(width, scatteringSettings.quality), scatteringResolution(height, scatteringSettings.quality));
+}
 
+void Planet::buildScatteringTextures(const unsigned int width, const unsigned int height) {
+    scatteringPlan.width = width;
+    scatteringPlan.height = height;
+    if (!scatteringFbo)
+        return;
+
+    // The water pass fetches the texels itself for the bilateral upsampling
+    glBindTexture(GL_TEXTURE_2D, scatteringImage.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glBindTexture(GL_TEXTURE_2D, scatteringDepth.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
     opengl_check;
 }
 
-void Planet::startPlanetRendering() {
+void Planet::startPlanetRendering(DepthSettings const& depth) {
+    // Once per frame: choose how the scattering is evaluated
+    ScatteringPassPlan const plan = planScatteringPass(scatteringSettings, screenWidth, screenHeight, nScatteringPoints, frameIndex++);
+    if (plan.width != scatteringPlan.width || plan.height != scatteringPlan.height)
+        buildScatteringTextures(plan.width, plan.height);
+    scatteringPlan = plan;
+
+    // A single depth buffer for the whole scene, from the near plane to infinity
     glEnable(GL_DEPTH_TEST);
+    glDepthFunc(depth.mode == DepthMode::ReverseZ ? GL_GREATER : GL_LESS);
+    glClearDepth(depth.mode == DepthMode::ReverseZ ? 0.0 : 1.0);
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, intermediate_image, 0);
-    base_intermediate_image = true;
     glClear(GL_DEPTH_BUFFER_BIT);
 }
 
-void Planet::switchIntermediateTexture() {
-    if (base_intermediate_image) {
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, intermediate_image_bis, 0);
-        postProcessingQuad.texture = intermediate_image;
-    }
-    else {
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, intermediate_image, 0);
-        postProcessingQuad.texture = intermediate_image_bis;
-    }
-    base_intermediate_image = !base_intermediate_image;
-    //glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-    //glClear(GL_COLOR_BUFFER_BIT);
+void Planet::startWaterRendering() {
+    glDisable(GL_DEPTH_TEST);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, depth_buffer);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Every planet is blended in place over the image: color = source.rgb + color * source.a
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE);
+    glEnable(GL_SCISSOR_TEST);
 }
 
-void Planet::renderFinalPlanet() {
+void Planet::endWaterRendering() {
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_BLEND);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Planet::renderFinalImage() {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    if (base_intermediate_image)
-        postProcessingQuad.texture = intermediate_image;
-    else
-        postProcessingQuad.texture = intermediate_image_bis;
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(presentShader);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, intermediate_image);
+    opengl_uniform(presentShader, "image_texture", 0);
+    drawPostProcessingQuad();
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Planet::drawPostProcessingQuad() {
+    glBindVertexArray(postProcessingQuad.vao); opengl_check;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, postProcessingQuad.vbo.at("index")); opengl_check;
+    glDrawElements(GL_TRIANGLES, GLsizei(postProcessingQuad.number_triangles * 3), GL_UNSIGNED_INT, nullptr); opengl_check;
+    glBindVertexArray(0);
+}
+
+void Planet::renderScattering(mat4 const& view, mat4 const& projection, ScreenRect const& rect) {
+    GLuint const program = waterShader;
+    GLuint target = scatteringImage.id();
+    float weight = 0.0f;
+    ScreenRect const scatteringRect = downscaledRect(rect, scatteringPlan.divisor, scatteringPlan.width, scatteringPlan.height);
+
+    if (scatteringPlan.temporal) {
+        ScatteringHistory& history = scatteringHistory;
+        if (history.width != scatteringPlan.width || history.height != scatteringPlan.height) {
+            if (!history.images[0]) {
+                history.images[0] = gl_texture::create();
+                history.images[1] = gl_texture::create();
+            }
+            for (int i = 0; i < 2; i++) {
+                glBindTexture(GL_TEXTURE_2D, history.images[i].id());
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, scatteringPlan.width, scatteringPlan.height, 0, GL_RGBA, GL_FLOAT, NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+            history.width = scatteringPlan.width;
+            history.height = scatteringPlan.height;
+            history.valid = false;
+            opengl_check;
+        }
+
+        // The planet moved since the last frame: reproject relatively to its center
+        vec3 const position = getPosition();
+        if (history.valid) {
+            mat4 offset = mat4::identity();
+            offset(0, 3) = history.previousPosition.x - position.x;
+            offset(1, 3) = history.previousPosition.y - position.y;
+            offset(2, 3) = history.previousPosition.z - position.z;
+            opengl_uniform(program, "reprojection", history.previousViewProjection * offset * inverse(view));
+            opengl_uniform(program, "historyBounds", history.previousBounds);
+            weight = scatteringPlan.historyWeight;
+        }
+
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, history.images[history.current].id());
+        opengl_uniform(program, "scatteringHistory", 3);
+
+        history.current = 1 - history.current;
+        target = history.images[history.current].id();
+        history.previousViewProjection = projection * view;
+        history.previousPosition = position;
+        history.valid = scatteringRect.visible;
+        history.previousBounds = vec4((float)scatteringRect.x / scatteringPlan.width, (float)scatteringRect.y / scatteringPlan.height,
+            (float)(scatteringRect.x + scatteringRect.width) / scatteringPlan.width, (float)(scatteringRect.y + scatteringRect.height) / scatteringPlan.height);
+    }
+
+    opengl_uniform(program, "passMode", 1);
+    opengl_uniform(program, "historyWeight", weight);
+    opengl_uniform(program, "scatteringJitter", scatteringPlan.jitter);
+    opengl_uniform(program, "nScatteringPoints", scatteringPlan.sampleCount);
+
+    // The scattering target is not blended, it is overwritten inside the rectangle of the planet
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, scatteringFbo.id());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    glViewport(0, 0, scatteringPlan.width, scatteringPlan.height);
+    glScissor(scatteringRect.x, scatteringRect.y, scatteringRect.width, scatteringRect.height);
+    drawPostProcessingQuad();
+
+    // Back to the water pass, which upsamples the scattering
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, screenWidth, screenHeight);
+    glEnable(GL_BLEND);
+    opengl_uniform(program, "historyWeight", 0.0f);
+    opengl_uniform(program, "scatteringJitter", 0.0f);
+    opengl_uniform(program, "nScatteringPoints", nScatteringPoints);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, target);
+    opengl_uniform(program, "scatteringImage", 2);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, scatteringDepth.id());
+    opengl_uniform(program, "scatteringDepth", 4);
+    glActiveTexture(GL_TEXTURE0);
+    opengl_check;
 }
 
 static char planet_name[30];
@@ -501,10 +740,15 @@ void Planet::displayInterface() {
 
         
         if (ImGui::TreeNode("Atmosphere")) {
-            ImGui::Checkbox("Atmosphere", &hasAtmosphere);
+            if (ImGui::Checkbox("Atmosphere", &hasAtmosphere))
+                selectShaderVariants();
             ImGui::SliderFloat("Atmosphere radius", &atmosphereHeight, 1.0f, 3.0f);
             ImGui::SliderFloat("Density falloff", &densityFalloff, 0.0f, 10.0f);
             ImGui::SliderInt("Scattering points", &Planet::nScatteringPoints, 0, 20);
+            int quality = (int)std::log2((int)Planet::scatteringSettings.quality);
+            if (ImGui::Combo("Scattering resolution", &quality, "Full\0Half\0Quarter\0"))
+                Planet::scatteringSettings.quality = (ScatteringQuality)(1 << quality);
+            ImGui::Checkbox("Temporal accumulation", &Planet::scatteringSettings.temporal);
             ImGui::SliderInt("Optical depth points", &Planet::nOpticalDepthPoints, 0, 20);
 
             ImGui::SliderFloat3("Wave lengths", wavelengths, 400, 800);
@@ -2,10 +2,49 @@
 
 #include "vcl/vcl.hpp"
 #include "noises.hpp"
+#include "terrain.hpp"
+#include "planet_parameters.hpp"
+#include "system_pack.hpp"
 #include "mesh_drawable_multitexture.hpp"
+#include "planet_mesh_drawable.hpp"
 #include "physics.hpp"
+#include "scattering.hpp"
+#include "screen_rect.hpp"
+#include "depth.hpp"
+#include "mesh_clusters.hpp"
+#include "icosphere.hpp"
+#include "planet_surface.hpp"
+#include "culling.hpp"
+#include "asset_manager.hpp"
+#include "shader_variants.hpp"
+#include "profiler.hpp"
+#include "residency.hpp"
+
+#include <future>
+
+// Features of the planet shaders, compiled into their variants instead of branching on uniforms
+enum PlanetShaderFeature : unsigned int {
+    SunFeature = 1 << 0,
+    WaterGlowFeature = 1 << 1,
+    SpecularWaterFeature = 1 << 2,
+    AtmosphereFeature = 1 << 3
+};
+
+// Surface of a planet at one division, loaded or generated on any thread
+struct PlanetLevel {
+    std::shared_ptr<IcosphereTopology const> topology;
+    PlanetSurface surface;
+    std::vector<vcl::vec3> vegetation;
+    uint64_t terrainKey = 0; // Of the parameters it was built from
+    bool onDisk = false;     // Loaded from a bake, so it can be loaded again instead of generated
+
+    // Packed off the main thread for the uploads of the refinements
+    std::vector<PlanetVertex> vertices;
+    vcl::vec2 heightRange = { 1.0f, 1.0f };
+};
 
-class Planet {
+// The parameters of the planet file are public members, edited by the interface
+class Planet : public PlanetParameters {
 
 private:
 
@@ -13,115 +52,134 @@ private:
     PhysicsComponent* physics = nullptr;
 
     // Rendering
-    vcl::mesh m;
-    vcl::mesh mLowRes;
+    // Only the terrain is stored per planet, the sphere and its triangles are shared
+    std::string name; // Of its .pbf and of its bakes
+    std::shared_ptr<IcosphereTopology const> topology;
+    PlanetSurface surface;
+    std::vector<vcl::vec3> vegetation; // Baked anchors of the plants, in the model space
+    unsigned char const* packedBake = nullptr; // Bake of the system pack, which outlives the planet
+    size_t packedBakeSize = 0;
+    AssetManager::Texture normalMap;   // Shared by every planet
+
+    // Every planet starts with a coarse mesh, the full division is built in the background when the residency asks
+    // for it and released when the viewer leaves. The coarse level is kept meanwhile to fall back on.
+    int fullDivision = 200;
+    bool refined = false;
+    bool surfaceOnDisk = false;
+    std::future<PlanetLevel> refinement;
+    PlanetLevel uploading;             // Built, copied to the GPU over several frames
+    planet_mesh_drawable uploadingVisual;
+    size_t uploadedVertices = 0;
+    PlanetLevel coarseLevel;
+    std::future<void> caching; // Writes an evicted full resolution to cacheDirectory
 
 public:
-    vcl::mesh_drawable visual;
-    vcl::mesh_drawable visualLowRes;
+    planet_mesh_drawable visual;
+    planet_mesh_drawable visualLowRes;
 
 private:
-    static GLuint shader;
+    static ShaderVariants terrainShaders;
+    static ShaderVariants waterShaders;
+    GLuint waterShader = 0; // Variant selected for the features of this planet
 
     // Post processing
     static mesh_drawable_multitexture postProcessingQuad;
     static GLuint fbo;                // Frame buffer for multi-pass render
     static GLuint depth_buffer;       // Depth buffer used when rendered in the frame buffer
-    static GLuint intermediate_image; // Texture of the rendered color image
-    static GLuint intermediate_image_bis;
-    static bool base_intermediate_image;
+    static GLuint intermediate_image; // Texture of the rendered color image, the water passes blend over it
+    static GLuint presentShader;      // Copies the final image to the screen
+
+    // Atmosphere scattering
+    static ScatteringPassPlan scatteringPlan;
+    static gl_framebuffer scatteringFbo;
+    static gl_texture scatteringImage; // Inscattered light and transmittance at the scattering resolution
+    static gl_texture scatteringDepth; // View distance at which the scattering was evaluated
+    static unsigned int screenWidth;
+    static unsigned int screenHeight;
+    static unsigned int frameIndex;
+    ScatteringHistory scatteringHistory;
 
 public:
-	float radius = 1.0f;
-	float rotateSpeed = 0.0f;
-
-    // Colors
-    vcl::vec3 flatLowColor = { 1.0f, 1.0f, 1.0f };
-    vcl::vec3 flatHighColor = { 0.8f, 1.0f, 1.0f };
-    vcl::vec3 steepColor = { 0.4f, 0.2f, 0.0f };
-    float maxSlope = 0.3f;
-
-	// Continent
-	perlin_noise_parameters continentParameters;
-
-	// Mountains
-	perlin_noise_parameters mountainsParameters;
-	perlin_noise_parameters maskParameters;
-
-	float mountainSharpness = 1.0f;
-	float mountainsBlend = 1.0f;
-	float maskShift = 0.0f;
-
-	// Oceans
-	float oceanFloorDepth = 0.5f;
-	float oceanFloorSmoothing = 1.0f;
-	float oceanDepthMultiplier = 2.0f;
-
-    // Water
-    float waterLevel = 1.0f;
-    vcl::vec4 waterColorSurface = { 0.0f, 0.2f, 1.0f, 1.0f};
-    vcl::vec4 waterColorDeep = { 0.0f, 0.0f, 0.0f, 1.0f };
-    float depthMultiplier = 6.0f;
-    float waterBlendMultiplier = 60.0f;
-
-	// Texture
-	float textureScale = 1.0f;
-	float textureSharpness = 5.0f;
-	float normalMapInfluence = 0.2f;
-
-    // Atmosphere
-    bool hasAtmosphere = false;
-    float atmosphereHeight = 3.0f;
-    float densityFalloff = 3.0f;
-
-    float wavelengths[3] = { 700, 530, 440 };
-    float scatteringStrength = 1.0f;
+    static std::string bakeDirectory; // Written by planet_bake, "bake" by default
+    static std::string cacheDirectory; // Full resolutions generated at runtime, written when they are evicted
+    static int coarseDivision;        // Of the mesh every planet starts with
+    static ResidencySettings residencySettings;
+    static ResidencyStats residencyStats; // Of the last updateResidency
 
     static int nScatteringPoints;
     static int nOpticalDepthPoints;
-
-    // Misc
-    bool isSun = false;
-    bool waterGlow = false;
-    bool specularWater = true;
-
-    static float nearPlane;
-    static float interPlane;
-    static float farPlane;
+    static ScatteringSettings scatteringSettings;
 
     // Constructors
+    // Move-only: the planet owns its GPU resources, so planets are built in place
     Planet() {}
-    Planet(char* name, float mass, vcl::vec3 position, vcl::vec3 velocity = {0, 0, 0}, int division=200);
-    Planet(char* name, float mass, Planet* parent, float distanceToParent, float phase, int division = 200);
+    Planet(const char* name, float mass, vcl::vec3 position, vcl::vec3 velocity = {0, 0, 0}, int division=200);
+    Planet(const char* name, float mass, Planet* parent, float distanceToParent, float phase, int division = 200);
+    // From a system pack, the parent being the planet of index planet.orbit.parent
+    Planet(SystemPlanet const& planet, Planet* parent);
+    Planet(Planet const&) = delete;
+    Planet& operator=(Planet const&) = delete;
+    Planet(Planet&&) = default;
+    Planet& operator=(Planet&&) = default;
 
     // Getters
     vcl::vec3 getPosition();
     vcl::vec3 getSpeed();
+    float getBoundingRadius(); // Radius of the sphere containing the terrain and the atmosphere
 
     // Update functions
     vcl::vec3 getPlanetRadiusAt(const vcl::vec3& posOnUnitSphere);
-    void updateFragmentMesh(vcl::uint2 division);
+    std::vector<vcl::vec3> const& vegetationAnchors() const { return vegetation; } // Empty without bake
+    void initializePlanetMesh(); // Coarse mesh, from the bakes when they are up to date
+    // Refines, uploads and evicts the planets for the viewer moving at velocity, on the main thread once per frame
+    // Waits for the build and the cache write in flight, they read the bake of the system pack
+    void waitBackgroundWork();
+    static void updateResidency(std::vector<Planet>& planets, vcl::vec3 const& viewer, vcl::vec3 const& velocity, Frustum const& frustum);
+    Residency residency() const;
+    PlanetMemory memory() const;
+    PlanetMemory fullMemory() const; // Estimated before the first refinement
+    void refine();
+    void evictDetail();
 	void updatePlanetMesh();
     void updateVisual();
 	void updateRotation(float deltaTime);
 
     // Rendering
     void displayInterface();
+    unsigned int shaderFeatures() const;
+    // The planet has no program before the first selection. Requesting the variants beforehand lets them
+    // compile while the rest of the startup runs.
+    void requestShaderVariants() const;
+    void selectShaderVariants(); // To call again when a feature changes
     
     void setCustomUniforms();
-    template <typename SCENE> void renderPlanet(SCENE const& scene, bool lowRes=false);
-    template <typename SCENE> void renderWater(SCENE const& scene);
+    template <typename SCENE> void renderPlanet(SCENE const& scene, bool lowRes=false, CullingStats* stats=nullptr);
+    template <typename SCENE> void renderWater(SCENE const& scene, ScreenRect const& rect);
 
     // Post processing
-    static void initPlanetRenderer(const unsigned int width, const unsigned int height);
+    static void initPlanetRenderer(const unsigned int width, const unsigned int height, DepthSettings const& depth);
+    static void releasePlanetRenderer(); // While the context is still current
     static void buildTextures(const unsigned int width, const unsigned int height);
-    static void startPlanetRendering();
-    static void switchIntermediateTexture();
-    static void renderFinalPlanet();
-    template <typename SCENE> static void startWaterRendering(SCENE const& scene, bool nearPlanets);
+    static void startPlanetRendering(DepthSettings const& depth);
+    static void startWaterRendering();
+    template <typename SCENE> static void setWaterFrameUniforms(GLuint program, SCENE const& scene);
+    static void endWaterRendering();
+    static void renderFinalImage();
 
 private:
+    template <typename SCENE> static void drawClusters(planet_mesh_drawable const& drawable, MeshClusters const& clusters, SCENE const& scene);
     static void buildFbo(const unsigned int width, const unsigned int height);
+    static void buildScatteringTextures(const unsigned int width, const unsigned int height);
+    void renderScattering(vcl::mat4 const& view, vcl::mat4 const& projection, ScreenRect const& rect);
+    static void drawPostProcessingQuad();
+    static vcl::vec3 orbitPosition(Planet* parent, float distanceToParent, float phase);
+    static vcl::vec3 orbitVelocity(Planet* parent, float distanceToParent, float phase);
+    void initialize(float mass, vcl::vec3 position, vcl::vec3 velocity, int division);
+    void buildDrawables(planet_mesh_drawable&& full); // For the current topology, full drawing its vertices
+    void finishRefinement(int priority); // Posts the upload of a built refinement to the GL task queue
+    bool uploadSome(size_t& bytes); // True once the refinement is complete, see IcosphereTopology::uploadSome
+    size_t uploadBacklog() const;
+    void setLevel(PlanetLevel&& level);
 
 public:
 
@@ -132,68 +190,96 @@ public:
 };
 
 template <typename SCENE>
-void Planet::renderPlanet(SCENE const& scene, bool lowRes) {
+void Planet::renderPlanet(SCENE const& scene, bool lowRes, CullingStats* stats) {
     setCustomUniforms();
     visual.transform.translate = physics->get_position();
     visualLowRes.transform.translate = physics->get_position();
-    if (!lowRes)
-        vcl::draw(visual, scene);
-    else
-        vcl::draw(visualLowRes, scene);
+
+    planet_mesh_drawable const& drawable = lowRes ? visualLowRes : visual;
+    MeshClusters& meshClusters = lowRes ? surface.clustersLowRes : surface.clusters;
+
+    // Clusters are culled in the model space of the planet
+    vcl::vec3 const eye = vcl::inverse(drawable.transform.rotate) * (scene.camera.position() - drawable.transform.translate);
+    unsigned int const submitted = cullClusters(meshClusters, eye);
+    if (stats != nullptr) {
+        stats->submittedTriangles += submitted;
+        stats->totalTriangles += drawable.number_triangles;
+    }
+    drawClusters(drawable, meshClusters, scene);
+}
+
+// Same as vcl::draw, with one glMultiDrawElements over the visible clusters of the compact mesh
+template <typename SCENE>
+void Planet::drawClusters(planet_mesh_drawable const& drawable, MeshClusters const& clusters, SCENE const& scene) {
+    if (clusters.counts.empty())
+        return;
+
+    glUseProgram(drawable.shader); opengl_check;
+    opengl_uniform(drawable.shader, scene);
+    vcl::opengl_uniform(drawable.shader, drawable.shading);
+    vcl::opengl_uniform(drawable.shader, "model", drawable.transform.matrix());
+    glUniform2f(glGetUniformLocation(drawable.shader, "heightRange"), drawable.heightRange.x, drawable.heightRange.y); opengl_check;
+
+    glActiveTexture(GL_TEXTURE0); opengl_check;
+    glBindTexture(GL_TEXTURE_2D, drawable.texture); opengl_check;
+    vcl::opengl_uniform(drawable.shader, "image_texture", 0); opengl_check;
+
+    glBindVertexArray(drawable.vao.id()); opengl_check;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, drawable.indexBuffer); opengl_check;
+    glMultiDrawElements(GL_TRIANGLES, clusters.counts.data(), GL_UNSIGNED_INT, clusters.offsets.data(), GLsizei(clusters.counts.size())); opengl_check;
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 template <typename SCENE>
-void Planet::renderWater(SCENE const& scene) {
+void Planet::renderWater(SCENE const& scene, ScreenRect const& rect) {
     vcl::vec4 center = vcl::vec4(visual.transform.translate, 1.0f);
     visual.transform.translate = physics->get_position();
-    vcl::opengl_uniform(postProcessingQuad.shader, "worldPlanetCenter", center);
-    vcl::opengl_uniform(postProcessingQuad.shader, "oceanLevel", waterLevel * radius);
-    vcl::opengl_uniform(postProcessingQuad.shader, "depthMultiplier", depthMultiplier);
-    vcl::opengl_uniform(postProcessingQuad.shader, "waterBlendMultiplier", waterBlendMultiplier);
-    vcl::opengl_uniform(postProcessingQuad.shader, "waterColorDeep", waterColorDeep);
-    vcl::opengl_uniform(postProcessingQuad.shader, "waterColorSurface", waterColorSurface);
-    vcl::opengl_uniform(postProcessingQuad.shader, "lightSource", scene.light);
-    vcl::opengl_uniform(postProcessingQuad.shader, "hasAtmosphere", hasAtmosphere);
+    glUseProgram(waterShader);
+    setWaterFrameUniforms(waterShader, scene);
+    vcl::opengl_uniform(waterShader, "worldPlanetCenter", center);
+    vcl::opengl_uniform(waterShader, "oceanLevel", waterLevel * radius);
+    vcl::opengl_uniform(waterShader, "depthMultiplier", depthMultiplier);
+    vcl::opengl_uniform(waterShader, "waterBlendMultiplier", waterBlendMultiplier);
+    vcl::opengl_uniform(waterShader, "waterColorDeep", waterColorDeep);
+    vcl::opengl_uniform(waterShader, "waterColorSurface", waterColorSurface);
+    vcl::opengl_uniform(waterShader, "lightSource", scene.light);
     if (hasAtmosphere) {
-        vcl::opengl_uniform(postProcessingQuad.shader, "planetRadius", radius);
-        vcl::opengl_uniform(postProcessingQuad.shader, "atmosphereHeight", atmosphereHeight * radius);
-        vcl::opengl_uniform(postProcessingQuad.shader, "densityFalloff", densityFalloff);
+        vcl::opengl_uniform(waterShader, "planetRadius", radius);
+        vcl::opengl_uniform(waterShader, "atmosphereHeight", atmosphereHeight * radius);
+        vcl::opengl_uniform(waterShader, "densityFalloff", densityFalloff);
 
         vcl::vec3 scatteringCoeffs;
         scatteringCoeffs.x = std::pow(50 / wavelengths[0], 4) * scatteringStrength;
         scatteringCoeffs.y = std::pow(50 / wavelengths[1], 4) * scatteringStrength;
         scatteringCoeffs.z = std::pow(50 / wavelengths[2], 4) * scatteringStrength;
-        vcl::opengl_uniform(postProcessingQuad.shader, "scatteringCoeffs", scatteringCoeffs);
+        vcl::opengl_uniform(waterShader, "scatteringCoeffs", scatteringCoeffs);
     }
-    vcl::opengl_uniform(postProcessingQuad.shader, "isSun", isSun);
-    vcl::opengl_uniform(postProcessingQuad.shader, "waterGlow", waterGlow);
-    vcl::opengl_uniform(postProcessingQuad.shader, "specularWater", specularWater);
-    
-    draw(postProcessingQuad, scene);
-}
-
-template <typename SCENE>
-void Planet::startWaterRendering(SCENE const& scene, bool nearPlanets) {
-    glDisable(GL_DEPTH_TEST);
-
-    glUseProgram(postProcessingQuad.shader);
 
-    // Matrices
-    vcl::opengl_uniform(postProcessingQuad.shader, "viewMatrix", scene.camera.matrix_view());
-    vcl::opengl_uniform(postProcessingQuad.shader, "perspectiveInverse", inverse(scene.projection));
-    
-    if (nearPlanets) {
-        vcl::opengl_uniform(postProcessingQuad.shader, "near", nearPlane);
-        vcl::opengl_uniform(postProcessingQuad.shader, "far", interPlane);
+    bool const separateScattering = hasAtmosphere && scatteringPlan.separatePass;
+    if (separateScattering) {
+        ProfileZone zone("Scattering", true);
+        renderScattering(scene.camera.matrix_view(), scene.projection, rect);
     }
-    else {
-        vcl::opengl_uniform(postProcessingQuad.shader, "near", interPlane);
-        vcl::opengl_uniform(postProcessingQuad.shader, "far", farPlane);
-    }
-    vcl::opengl_uniform(postProcessingQuad.shader, "nScatteringPoints", nScatteringPoints);
-    vcl::opengl_uniform(postProcessingQuad.shader, "nOpticalDepthPoints", nOpticalDepthPoints);
+    ProfileZone zone("Water and atmosphere", true);
+    vcl::opengl_uniform(waterShader, "passMode", separateScattering ? 2 : 0);
 
-    
+    // Only the pixels covered by the planet and its atmosphere are shaded
+    glScissor(rect.x, rect.y, rect.width, rect.height);
+    drawPostProcessingQuad();
+}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+// Same for every planet, but each water variant is a separate program
+template <typename SCENE>
+void Planet::setWaterFrameUniforms(GLuint program, SCENE const& scene) {
+    vcl::opengl_uniform(program, "viewMatrix", scene.camera.matrix_view());
+    vcl::opengl_uniform(program, "perspectiveInverse", inverse(scene.projection));
+    vcl::opengl_uniform(program, "near", scene.depth.nearPlane);
+    vcl::opengl_uniform(program, "far", scene.depth.farPlane);
+    vcl::opengl_uniform(program, "logarithmicDepth", scene.depth.mode == DepthMode::Logarithmic);
+    vcl::opengl_uniform(program, "nScatteringPoints", nScatteringPoints);
+    vcl::opengl_uniform(program, "nOpticalDepthPoints", nOpticalDepthPoints);
+    vcl::opengl_uniform(program, "image_texture_2", 1);
 }
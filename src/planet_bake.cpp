@@ -0,0 +1,182 @@
+#include "planet_bake.hpp"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static char const planetBakeMagic[4] = { 'P', 'B', 'A', 'K' };
+static uint32_t const planetBakeVersion = 1;
+static uint32_t const maxHeightfieldSize = 1u << 14; // Largest width or height accepted by the parser
+
+static size_t alignOffset(size_t offset) {
+    return (offset + 15) & ~size_t(15);
+}
+
+// FNV-1a over the bytes of each value, the structures are hashed field by field to skip their padding
+static void hashBytes(uint64_t& hash, void const* data, size_t size) {
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+static void hashNoise(uint64_t& hash, perlin_noise_parameters const& parameters) {
+    hashBytes(hash, &parameters.persistency, sizeof(parameters.persistency));
+    hashBytes(hash, &parameters.frequency_gain, sizeof(parameters.frequency_gain));
+    hashBytes(hash, &parameters.octave, sizeof(parameters.octave));
+    hashBytes(hash, parameters.center, sizeof(parameters.center));
+}
+
+uint64_t terrainBakeKey(TerrainParameters const& terrain) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hashBytes(hash, &terrain.radius, sizeof(float));
+    hashNoise(hash, terrain.continentParameters);
+    hashNoise(hash, terrain.mountainsParameters);
+    hashNoise(hash, terrain.maskParameters);
+    float const values[] = { terrain.mountainSharpness, terrain.mountainsBlend, terrain.maskShift, terrain.oceanFloorDepth,
+        terrain.oceanFloorSmoothing, terrain.oceanDepthMultiplier, terrain.maxSlope };
+    hashBytes(hash, values, sizeof(values));
+    return hash;
+}
+
+std::string planetBakePath(std::string const& directory, std::string const& planet, unsigned int division) {
+    return directory + "/" + planet + "_" + std::to_string(division) + ".pbake";
+}
+
+void createBakeDirectory(std::string const& directory) {
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+static BakedCluster bakeCluster(MeshCluster const& cluster) {
+    BakedCluster baked = {
+        { cluster.center.x, cluster.center.y, cluster.center.z }, cluster.radius,
+        { cluster.coneAxis.x, cluster.coneAxis.y, cluster.coneAxis.z }, cluster.coneAngle
+    };
+    return baked;
+}
+
+static void unbakeCluster(BakedCluster const& baked, MeshCluster& cluster) {
+    cluster.center = { baked.center[0], baked.center[1], baked.center[2] };
+    cluster.radius = baked.radius;
+    cluster.coneAxis = { baked.coneAxis[0], baked.coneAxis[1], baked.coneAxis[2] };
+    cluster.coneAngle = baked.coneAngle;
+}
+
+// Sizes of the sections after the header, in the order of the file
+static void sectionSizes(PlanetBakeHeader const& header, size_t sizes[7]) {
+    sizes[0] = size_t(header.vertexCount) * sizeof(vcl::vec3);
+    sizes[1] = size_t(header.vertexCount) * sizeof(vcl::vec3);
+    sizes[2] = size_t(header.vertexCount) * sizeof(float);
+    sizes[3] = size_t(header.clusterCounts[0]) * sizeof(BakedCluster);
+    sizes[4] = size_t(header.clusterCounts[1]) * sizeof(BakedCluster);
+    sizes[5] = size_t(header.heightfieldWidth) * header.heightfieldHeight * sizeof(float);
+    sizes[6] = size_t(header.anchorCount) * sizeof(vcl::vec3);
+}
+
+std::vector<unsigned char> serializePlanetBake(PlanetBake const& bake, IcosphereTopology const& topology, uint64_t terrainKey) {
+    PlanetSurface const& surface = bake.surface;
+    PlanetBakeHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, planetBakeMagic, 4);
+    header.version = planetBakeVersion;
+    header.terrainKey = terrainKey;
+    header.division = topology.division;
+    header.vertexCount = uint32_t(surface.positions.size());
+    header.clusterCounts[0] = uint32_t(surface.clusters.clusters.size());
+    header.clusterCounts[1] = uint32_t(surface.clustersLowRes.clusters.size());
+    header.occluderRadii[0] = surface.clusters.occluderRadius;
+    header.occluderRadii[1] = surface.clustersLowRes.occluderRadius;
+    if (!bake.heightfield.empty()) {
+        header.heightfieldWidth = bake.heightfieldWidth;
+        header.heightfieldHeight = bake.heightfieldHeight;
+    }
+    header.anchorCount = uint32_t(bake.anchors.size());
+    header.anchorRequest = bake.anchorRequest;
+
+    std::vector<BakedCluster> clusters[2];
+    for (MeshCluster const& cluster : surface.clusters.clusters)
+        clusters[0].push_back(bakeCluster(cluster));
+    for (MeshCluster const& cluster : surface.clustersLowRes.clusters)
+        clusters[1].push_back(bakeCluster(cluster));
+
+    void const* const sections[7] = { surface.positions.data.data(), surface.normals.data.data(), surface.slopes.data.data(),
+        clusters[0].data(), clusters[1].data(), bake.heightfield.data(), bake.anchors.data() };
+    size_t sizes[7];
+    sectionSizes(header, sizes);
+
+    size_t offset = alignOffset(sizeof(header));
+    size_t total = offset;
+    for (size_t const size : sizes)
+        total = alignOffset(total + size);
+    std::vector<unsigned char> data(total, 0);
+    std::memcpy(data.data(), &header, sizeof(header));
+    for (int i = 0; i < 7; i++) {
+        if (sizes[i] > 0)
+            std::memcpy(data.data() + offset, sections[i], sizes[i]);
+        offset = alignOffset(offset + sizes[i]);
+    }
+    return data;
+}
+
+bool parsePlanetBake(unsigned char const* data, size_t size, IcosphereTopology const& topology, uint64_t terrainKey, PlanetBake& bake) {
+    if (data == nullptr || size < sizeof(PlanetBakeHeader))
+        return false;
+    PlanetBakeHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, planetBakeMagic, 4) != 0 || header.version != planetBakeVersion || header.terrainKey != terrainKey)
+        return false;
+    if (header.division != topology.division || header.vertexCount != topology.directions.size()
+        || header.clusterCounts[0] != topology.levels[0].clusters.clusters.size()
+        || header.clusterCounts[1] != topology.levels[1].clusters.clusters.size())
+        return false;
+    // Bounded so that the section sizes cannot overflow
+    if (header.heightfieldWidth > maxHeightfieldSize || header.heightfieldHeight > maxHeightfieldSize)
+        return false;
+
+    size_t sizes[7];
+    sectionSizes(header, sizes);
+    size_t offsets[7];
+    size_t offset = alignOffset(sizeof(header));
+    for (int i = 0; i < 7; i++) {
+        if (offset > size || sizes[i] > size - offset)
+            return false;
+        offsets[i] = offset;
+        offset = alignOffset(offset + sizes[i]);
+    }
+
+    PlanetSurface& surface = bake.surface;
+    initializeSurface(surface, topology);
+    std::memcpy(surface.positions.data.data(), data + offsets[0], sizes[0]);
+    std::memcpy(surface.normals.data.data(), data + offsets[1], sizes[1]);
+    std::memcpy(surface.slopes.data.data(), data + offsets[2], sizes[2]);
+
+    MeshClusters* const levels[2] = { &surface.clusters, &surface.clustersLowRes };
+    for (int level = 0; level < 2; level++) {
+        levels[level]->occluderRadius = header.occluderRadii[level];
+        for (size_t i = 0; i < header.clusterCounts[level]; i++) {
+            BakedCluster baked;
+            std::memcpy(&baked, data + offsets[3 + level] + i * sizeof(BakedCluster), sizeof(baked));
+            unbakeCluster(baked, levels[level]->clusters[i]);
+        }
+    }
+
+    bake.heightfieldWidth = header.heightfieldWidth;
+    bake.heightfieldHeight = header.heightfieldHeight;
+    bake.heightfield.resize(size_t(header.heightfieldWidth) * header.heightfieldHeight);
+    if (sizes[5] > 0)
+        std::memcpy(bake.heightfield.data(), data + offsets[5], sizes[5]);
+    bake.anchors.resize(header.anchorCount);
+    bake.anchorRequest = header.anchorRequest;
+    if (sizes[6] > 0)
+        std::memcpy(bake.anchors.data(), data + offsets[6], sizes[6]);
+    return true;
+}
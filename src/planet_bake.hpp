@@ -0,0 +1,57 @@
+#pragma once
+
+#include "planet_surface.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baked planet: the surface generated offline by planet_bake for one .pbf and one division.
+// The viewer loads it instead of generating the surface when the terrain and the division still match.
+// Layout: PlanetBakeHeader, then the sections aligned on 16 bytes: positions, normals, slopes, the cluster
+// bounds of both levels, then the optional heightfield and vegetation anchors.
+
+struct PlanetBakeHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t terrainKey;       // terrainBakeKey of the parameters it was generated with
+    uint32_t division;         // Of the topology, after icosphere_nested_division
+    uint32_t vertexCount;
+    uint32_t clusterCounts[2]; // Full and low resolution levels
+    float occluderRadii[2];
+    uint32_t heightfieldWidth; // 0 without heightfield
+    uint32_t heightfieldHeight;
+    uint32_t anchorCount;
+    uint32_t anchorRequest;    // Anchors asked for, anchorCount is lower when the surface is too steep
+};
+
+// Bounds of a cluster, its triangle range comes from the topology
+struct BakedCluster {
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneAngle;
+};
+
+struct PlanetBake {
+    PlanetSurface surface;
+    unsigned int heightfieldWidth = 0;
+    unsigned int heightfieldHeight = 0;
+    std::vector<float> heightfield; // See surfaceHeightfield
+    std::vector<vcl::vec3> anchors; // See vegetationAnchors
+    unsigned int anchorRequest = 0; // Count passed to vegetationAnchors, so that a new count is baked again
+};
+
+// Changes with any parameter the surface depends on
+uint64_t terrainBakeKey(TerrainParameters const& terrain);
+
+// bake/Name_division.pbake, the division being the one of the topology
+std::string planetBakePath(std::string const& directory, std::string const& planet, unsigned int division);
+
+void createBakeDirectory(std::string const& directory); // Nothing when it exists
+
+std::vector<unsigned char> serializePlanetBake(PlanetBake const& bake, IcosphereTopology const& topology, uint64_t terrainKey);
+
+// False when the data is not a bake of the current version for this topology and terrain key.
+// The surface is initialized from the topology, then its buffers and bounds are replaced by the baked ones.
+bool parsePlanetBake(unsigned char const* data, size_t size, IcosphereTopology const& topology, uint64_t terrainKey, PlanetBake& bake);
@@ -0,0 +1,270 @@
+#include "planet_file.hpp"
+#include "system_pack.hpp"
+#include "mapped_file.hpp"
+
+#include <cstring>
+
+TerrainParameters PlanetParameters::terrainParameters() const {
+    TerrainParameters terrain;
+    terrain.radius = radius;
+    terrain.continentParameters = continentParameters;
+    terrain.mountainsParameters = mountainsParameters;
+    terrain.maskParameters = maskParameters;
+    terrain.mountainSharpness = mountainSharpness;
+    terrain.mountainsBlend = mountainsBlend;
+    terrain.maskShift = maskShift;
+    terrain.oceanFloorDepth = oceanFloorDepth;
+    terrain.oceanFloorSmoothing = oceanFloorSmoothing;
+    terrain.oceanDepthMultiplier = oceanDepthMultiplier;
+    terrain.maxSlope = maxSlope;
+    return terrain;
+}
+
+
+// Scalars are written one by one, so the files are the same whatever the byte order of the machine
+
+static void appendUint32(std::vector<unsigned char>& data, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        data.push_back((unsigned char)(value >> (8 * i)));
+}
+
+static uint32_t readUint32(unsigned char const* data) {
+    return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+}
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+void appendField(std::vector<unsigned char>& data, uint16_t id, void const* value, uint16_t size) {
+    data.push_back((unsigned char)(id & 0xff));
+    data.push_back((unsigned char)(id >> 8));
+    data.push_back((unsigned char)(size & 0xff));
+    data.push_back((unsigned char)(size >> 8));
+    unsigned char const* bytes = static_cast<unsigned char const*>(value);
+    data.insert(data.end(), bytes, bytes + size);
+    while (data.size() % 4 != 0)
+        data.push_back(0);
+}
+
+void appendFloats(std::vector<unsigned char>& data, uint16_t id, float const* values, int count) {
+    std::vector<unsigned char> value;
+    for (int i = 0; i < count; i++)
+        appendUint32(value, floatBits(values[i]));
+    appendField(data, id, value.data(), uint16_t(value.size()));
+}
+
+void appendInt(std::vector<unsigned char>& data, uint16_t id, int32_t value) {
+    std::vector<unsigned char> bytes;
+    appendUint32(bytes, uint32_t(value));
+    appendField(data, id, bytes.data(), 4);
+}
+
+void appendBool(std::vector<unsigned char>& data, uint16_t id, bool value) {
+    unsigned char const byte = value ? 1 : 0;
+    appendField(data, id, &byte, 1);
+}
+
+bool decodeFloats(unsigned char const* value, uint16_t size, float* values, int count) {
+    if (size != 4 * count)
+        return false;
+    for (int i = 0; i < count; i++)
+        values[i] = bitsFloat(readUint32(value + 4 * i));
+    return true;
+}
+
+bool decodeInt(unsigned char const* value, uint16_t size, int32_t& result) {
+    if (size != 4)
+        return false;
+    result = int32_t(readUint32(value));
+    return true;
+}
+
+bool decodeBool(unsigned char const* value, uint16_t size, bool& result) {
+    if (size != 1)
+        return false;
+    result = value[0] != 0;
+    return true;
+}
+
+
+// Noise parameters: persistency, frequency gain, octave count and center, 24 bytes as in the first files
+static void appendNoise(std::vector<unsigned char>& data, uint16_t id, perlin_noise_parameters const& noise) {
+    std::vector<unsigned char> value;
+    appendUint32(value, floatBits(noise.persistency));
+    appendUint32(value, floatBits(noise.frequency_gain));
+    appendUint32(value, uint32_t(noise.octave));
+    for (float const coordinate : noise.center)
+        appendUint32(value, floatBits(coordinate));
+    appendField(data, id, value.data(), uint16_t(value.size()));
+}
+
+static bool decodeNoise(unsigned char const* value, uint16_t size, perlin_noise_parameters& noise) {
+    if (size != 24)
+        return false;
+    noise.persistency = bitsFloat(readUint32(value));
+    noise.frequency_gain = bitsFloat(readUint32(value + 4));
+    noise.octave = int32_t(readUint32(value + 8));
+    for (int i = 0; i < 3; i++)
+        noise.center[i] = bitsFloat(readUint32(value + 12 + 4 * i));
+    return true;
+}
+
+// Calls the visitor with the id, the name and the member of every field
+template <typename P, typename V>
+static void visitPlanetFields(P& p, V& visit) {
+    visit(RadiusField, "radius", p.radius);
+    visit(RotateSpeedField, "rotateSpeed", p.rotateSpeed);
+    visit(FlatLowColorField, "flatLowColor", p.flatLowColor);
+    visit(FlatHighColorField, "flatHighColor", p.flatHighColor);
+    visit(SteepColorField, "steepColor", p.steepColor);
+    visit(MaxSlopeField, "maxSlope", p.maxSlope);
+    visit(ContinentField, "continentParameters", p.continentParameters);
+    visit(MountainsField, "mountainsParameters", p.mountainsParameters);
+    visit(MaskField, "maskParameters", p.maskParameters);
+    visit(MountainSharpnessField, "mountainSharpness", p.mountainSharpness);
+    visit(MountainsBlendField, "mountainsBlend", p.mountainsBlend);
+    visit(MaskShiftField, "maskShift", p.maskShift);
+    visit(OceanFloorDepthField, "oceanFloorDepth", p.oceanFloorDepth);
+    visit(OceanFloorSmoothingField, "oceanFloorSmoothing", p.oceanFloorSmoothing);
+    visit(OceanDepthMultiplierField, "oceanDepthMultiplier", p.oceanDepthMultiplier);
+    visit(WaterLevelField, "waterLevel", p.waterLevel);
+    visit(WaterColorSurfaceField, "waterColorSurface", p.waterColorSurface);
+    visit(WaterColorDeepField, "waterColorDeep", p.waterColorDeep);
+    visit(DepthMultiplierField, "depthMultiplier", p.depthMultiplier);
+    visit(WaterBlendMultiplierField, "waterBlendMultiplier", p.waterBlendMultiplier);
+    visit(TextureScaleField, "textureScale", p.textureScale);
+    visit(TextureSharpnessField, "textureSharpness", p.textureSharpness);
+    visit(NormalMapInfluenceField, "normalMapInfluence", p.normalMapInfluence);
+    visit(HasAtmosphereField, "hasAtmosphere", p.hasAtmosphere);
+    visit(AtmosphereHeightField, "atmosphereHeight", p.atmosphereHeight);
+    visit(DensityFalloffField, "densityFalloff", p.densityFalloff);
+    visit(WavelengthsField, "wavelengths", p.wavelengths);
+    visit(ScatteringStrengthField, "scatteringStrength", p.scatteringStrength);
+    visit(IsSunField, "isSun", p.isSun);
+    visit(WaterGlowField, "waterGlow", p.waterGlow);
+    visit(SpecularWaterField, "specularWater", p.specularWater);
+    visit(SpecularField, "specular", p.specular);
+}
+
+struct FieldWriter {
+    std::vector<unsigned char>& data;
+
+    void operator()(uint16_t id, char const*, float const& value) { appendFloats(data, id, &value, 1); }
+    void operator()(uint16_t id, char const*, vcl::vec3 const& value) { float const v[3] = { value.x, value.y, value.z }; appendFloats(data, id, v, 3); }
+    void operator()(uint16_t id, char const*, vcl::vec4 const& value) { float const v[4] = { value.x, value.y, value.z, value.w }; appendFloats(data, id, v, 4); }
+    void operator()(uint16_t id, char const*, float const (&value)[3]) { appendFloats(data, id, value, 3); }
+    void operator()(uint16_t id, char const*, bool const& value) { appendBool(data, id, value); }
+    void operator()(uint16_t id, char const*, perlin_noise_parameters const& value) { appendNoise(data, id, value); }
+};
+
+// Decodes the value of one field when the id matches
+struct FieldReader {
+    uint16_t id;
+    unsigned char const* value;
+    uint16_t size;
+
+    void operator()(uint16_t field, char const*, float& v) { if (field == id) decodeFloats(value, size, &v, 1); }
+    void operator()(uint16_t field, char const*, vcl::vec3& v) {
+        float f[3];
+        if (field == id && decodeFloats(value, size, f, 3))
+            v = { f[0], f[1], f[2] };
+    }
+    void operator()(uint16_t field, char const*, vcl::vec4& v) {
+        float f[4];
+        if (field == id && decodeFloats(value, size, f, 4))
+            v = { f[0], f[1], f[2], f[3] };
+    }
+    void operator()(uint16_t field, char const*, float (&v)[3]) { if (field == id) decodeFloats(value, size, v, 3); }
+    void operator()(uint16_t field, char const*, bool& v) { if (field == id) decodeBool(value, size, v); }
+    void operator()(uint16_t field, char const*, perlin_noise_parameters& v) { if (field == id) decodeNoise(value, size, v); }
+};
+
+struct FieldNamer {
+    uint16_t id;
+    char const* name;
+
+    template <typename T>
+    void operator()(uint16_t field, char const* fieldName, T const&) {
+        if (field == id)
+            name = fieldName;
+    }
+};
+
+void writePlanetFields(PlanetParameters const& parameters, std::vector<unsigned char>& data) {
+    FieldWriter writer = { data };
+    visitPlanetFields(parameters, writer);
+}
+
+bool readPlanetFields(unsigned char const* data, size_t size, PlanetParameters& parameters) {
+    return forEachField(data, size, [&parameters](uint16_t id, unsigned char const* value, uint16_t length) {
+        FieldReader reader = { id, value, length };
+        visitPlanetFields(parameters, reader);
+    });
+}
+
+char const* planetFieldName(uint16_t id) {
+    PlanetParameters parameters;
+    FieldNamer namer = { id, nullptr };
+    visitPlanetFields(parameters, namer);
+    return namer.name;
+}
+
+bool readLegacyPlanetFields(unsigned char const* data, size_t size, PlanetParameters& parameters) {
+    size_t offset = 0;
+    for (uint16_t id = RadiusField; offset < size; id++) {
+        uint16_t const length = data[offset++];
+        if (offset + length > size)
+            return false;
+        // Only the first fields existed, the later ids were never written in this layout
+        if (id <= ScatteringStrengthField) {
+            FieldReader reader = { id, data + offset, length };
+            visitPlanetFields(parameters, reader);
+        }
+        offset += length;
+    }
+    return true;
+}
+
+bool readPlanetFile(std::string const& path, PlanetParameters& parameters) {
+    MappedFile const file(path);
+    if (!file.valid())
+        return false;
+    std::vector<SystemPlanet> planets;
+    if (isSystemPack(file.data(), file.size())) {
+        if (!parseSystemPack(file.data(), file.size(), planets) || planets.size() != 1)
+            return false;
+        parameters = planets[0].parameters;
+        return true;
+    }
+    return readLegacyPlanetFields(file.data(), file.size(), parameters);
+}
+
+bool writePlanetFile(std::string const& path, PlanetParameters const& parameters) {
+    SystemPlanet planet;
+    planet.name = planetNameFromPath(path);
+    planet.parameters = parameters;
+    planet.hasOrbit = false;
+    return writeFileAtomically(path, writeSystemPack({ planet }));
+}
+
+bool readTerrainParameters(std::string const& path, TerrainParameters& terrain) {
+    PlanetParameters parameters;
+    if (!readPlanetFile(path, parameters))
+        return false;
+    terrain = parameters.terrainParameters();
+    return true;
+}
+
+std::string planetNameFromPath(std::string const& path) {
+    std::string const name = path.substr(path.find_last_of("/\\") + 1); // npos + 1 is 0
+    return name.substr(0, name.find_last_of('.'));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "planet_parameters.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tagged planet fields. A field is stored as { uint16 id, uint16 size } followed by its value padded to 4 bytes,
+// every scalar in little endian. Readers skip the ids they do not know and keep the default value of the fields
+// that are missing, so files written by older and newer versions load.
+//
+// The ids are stable: a field is never renumbered, a removed field keeps its id reserved. Ids 1 to 28 follow
+// the order of the untagged .pbf files of the first versions, which importFromFile still reads.
+
+enum PlanetFieldId : uint16_t {
+    RadiusField = 1,
+    RotateSpeedField = 2,
+    FlatLowColorField = 3,
+    FlatHighColorField = 4,
+    SteepColorField = 5,
+    MaxSlopeField = 6,
+    ContinentField = 7,
+    MountainsField = 8,
+    MaskField = 9,
+    MountainSharpnessField = 10,
+    MountainsBlendField = 11,
+    MaskShiftField = 12,
+    OceanFloorDepthField = 13,
+    OceanFloorSmoothingField = 14,
+    OceanDepthMultiplierField = 15,
+    WaterLevelField = 16,
+    WaterColorSurfaceField = 17,
+    WaterColorDeepField = 18,
+    DepthMultiplierField = 19,
+    WaterBlendMultiplierField = 20,
+    TextureScaleField = 21,
+    TextureSharpnessField = 22,
+    NormalMapInfluenceField = 23,
+    HasAtmosphereField = 24,
+    AtmosphereHeightField = 25,
+    DensityFalloffField = 26,
+    WavelengthsField = 27,
+    ScatteringStrengthField = 28,
+    IsSunField = 29,
+    WaterGlowField = 30,
+    SpecularWaterField = 31,
+    SpecularField = 32
+};
+
+// Appends the fields of the parameters
+void writePlanetFields(PlanetParameters const& parameters, std::vector<unsigned char>& data);
+// Reads a sequence of fields into the parameters. False when a field overflows the data.
+bool readPlanetFields(unsigned char const* data, size_t size, PlanetParameters& parameters);
+// Name of a field in the source, nullptr for an unknown id
+char const* planetFieldName(uint16_t id);
+
+// Same fields in the sequential layout of the first .pbf files: { uint8 size, value } in the order of the ids
+bool readLegacyPlanetFields(unsigned char const* data, size_t size, PlanetParameters& parameters);
+
+// Planet file: the system pack header followed by the fields of a single planet, see system_pack.hpp.
+// The legacy untagged files are recognized and read as well.
+bool readPlanetFile(std::string const& path, PlanetParameters& parameters);
+bool writePlanetFile(std::string const& path, PlanetParameters const& parameters);
+
+// Terrain fields of a planet file, the tools only need these
+bool readTerrainParameters(std::string const& path, TerrainParameters& terrain);
+
+// File name without its directory nor extension: the name of the planet in packs, bakes and benchmark results
+std::string planetNameFromPath(std::string const& path);
+
+
+// Generic field encoding, also used by the other chunks of the system pack
+
+void appendField(std::vector<unsigned char>& data, uint16_t id, void const* value, uint16_t size);
+void appendFloats(std::vector<unsigned char>& data, uint16_t id, float const* values, int count);
+void appendInt(std::vector<unsigned char>& data, uint16_t id, int32_t value);
+void appendBool(std::vector<unsigned char>& data, uint16_t id, bool value);
+
+// Iterates over the fields of data, calling read(id, value, size) for each. False when a field overflows the data.
+template <typename F>
+bool forEachField(unsigned char const* data, size_t size, F const& read) {
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+        uint16_t const id = uint16_t(data[offset] | data[offset + 1] << 8);
+        uint16_t const length = uint16_t(data[offset + 2] | data[offset + 3] << 8);
+        offset += 4;
+        if (offset + length > size)
+            return false;
+        read(id, data + offset, length);
+        offset += (length + 3) & ~3u;
+    }
+    return offset >= size;
+}
+
+// Little endian scalars of a field value, the value is left unchanged when the size does not match
+bool decodeFloats(unsigned char const* value, uint16_t size, float* values, int count);
+bool decodeInt(unsigned char const* value, uint16_t size, int32_t& result);
+bool decodeBool(unsigned char const* value, uint16_t size, bool& result);
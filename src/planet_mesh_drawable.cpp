@@ -0,0 +1,138 @@
+#include "planet_mesh_drawable.hpp"
+#include "icosphere.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace vcl;
+
+static float signNotZero(float x) {
+    return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+vec2 octahedralEncode(vec3 const& n) {
+    float const l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    vec2 e = { n.x / l1, n.y / l1 };
+    if (n.z < 0.0f)
+        e = { (1.0f - std::abs(e.y)) * signNotZero(e.x), (1.0f - std::abs(e.x)) * signNotZero(e.y) };
+    return e;
+}
+
+vec3 octahedralDecode(vec2 const& e) {
+    vec3 n = { e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y) };
+    float const t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+vec2 planetHeightRange(buffer<vec3> const& position) {
+    vec2 range = { std::numeric_limits<float>::max(), 0.0f };
+    for (vec3 const& p : position) {
+        float const height = norm(p);
+        range.x = std::min(range.x, height);
+        range.y = std::max(range.y, height);
+    }
+    return range;
+}
+
+static uint16_t quantizeUnsigned16(float x) {
+    return (uint16_t)std::lround(std::min(1.0f, std::max(0.0f, x)) * 65535.0f);
+}
+
+static int16_t quantizeSigned16(float x) {
+    return (int16_t)std::lround(std::min(1.0f, std::max(-1.0f, x)) * 32767.0f);
+}
+
+PlanetVertex packPlanetVertex(vec3 const& position, vec3 const& normal, float slope, vec2 const& heightRange) {
+    PlanetVertex vertex;
+    float const extent = heightRange.y - heightRange.x;
+    vertex.height = quantizeUnsigned16(extent > 0.0f ? (norm(position) - heightRange.x) / extent : 0.0f);
+    vertex.slope = (uint8_t)std::lround(std::min(1.0f, std::max(0.0f, slope)) * 255.0f);
+    vertex.padding = 0;
+    vec2 const e = octahedralEncode(normal);
+    vertex.normal[0] = quantizeSigned16(e.x);
+    vertex.normal[1] = quantizeSigned16(e.y);
+    return vertex;
+}
+
+float unpackHeight(PlanetVertex const& vertex, vec2 const& heightRange) {
+    return heightRange.x + vertex.height / 65535.0f * (heightRange.y - heightRange.x);
+}
+
+
+static void bindPlanetVertexAttributes(GLuint directions, GLuint vertices, GLuint indices) {
+    opengl_set_vertex_attribute(directions, 0, 3, GL_FLOAT);
+
+    GLsizei const stride = sizeof(PlanetVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, vertices); opengl_check;
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(PlanetVertex, normal))); opengl_check;
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(PlanetVertex, height))); opengl_check;
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 1, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(PlanetVertex, slope))); opengl_check;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Stored in the vertex array
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices); opengl_check;
+}
+
+planet_mesh_drawable::planet_mesh_drawable(IcosphereTopology const& topology, GLuint shader_arg) {
+    shader = shader_arg;
+    texture = vcl::mesh_drawable::default_texture;
+    number_triangles = static_cast<GLuint>(topology.levels[0].connectivity.size());
+
+    topology.upload();
+    directions = topology.directionBuffer.id();
+    indexBuffer = topology.levels[0].indexBuffer.id();
+
+    vertices = gl_buffer::create();
+    vertexBuffer = vertices.id();
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer); opengl_check;
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(topology.directions.size() * sizeof(PlanetVertex)), nullptr, GL_DYNAMIC_DRAW); opengl_check;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    vao = gl_vertex_array::create();
+    glBindVertexArray(vao.id()); opengl_check;
+    bindPlanetVertexAttributes(directions, vertexBuffer, indexBuffer);
+    glBindVertexArray(0); opengl_check;
+}
+
+planet_mesh_drawable::planet_mesh_drawable(planet_mesh_drawable const& finest, IcosphereTopology const& topology, int level) {
+    shader = finest.shader;
+    texture = finest.texture;
+    vertexBuffer = finest.vertexBuffer;
+    directions = finest.directions;
+    heightRange = finest.heightRange;
+    number_triangles = static_cast<GLuint>(topology.levels[level].connectivity.size());
+
+    topology.upload();
+    indexBuffer = topology.levels[level].indexBuffer.id();
+
+    vao = gl_vertex_array::create();
+    glBindVertexArray(vao.id()); opengl_check;
+    bindPlanetVertexAttributes(directions, vertexBuffer, indexBuffer);
+    glBindVertexArray(0); opengl_check;
+}
+
+std::vector<PlanetVertex> packPlanetVertices(buffer<vec3> const& position, buffer<vec3> const& normal, buffer<float> const& slope, vec2 const& heightRange) {
+    std::vector<PlanetVertex> packed(position.size());
+    for (size_t i = 0; i < packed.size(); i++)
+        packed[i] = packPlanetVertex(position[i], normal[i], slope[i], heightRange);
+    return packed;
+}
+
+void planet_mesh_drawable::update(buffer<vec3> const& position, buffer<vec3> const& normal, buffer<float> const& slope) {
+    heightRange = planetHeightRange(position);
+    std::vector<PlanetVertex> const packed = packPlanetVertices(position, normal, slope, heightRange);
+    uploadVertices(packed.data(), 0, packed.size());
+}
+
+void planet_mesh_drawable::uploadVertices(PlanetVertex const* packed, size_t first, size_t count) {
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer); opengl_check;
+    glBufferSubData(GL_ARRAY_BUFFER, GLintptr(first * sizeof(PlanetVertex)), GLsizeiptr(count * sizeof(PlanetVertex)), packed); opengl_check;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
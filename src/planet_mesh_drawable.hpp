@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "gl_object.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Compact vertex of a planet mesh, interleaved in a single buffer.
+// The position is the unit sphere direction, shared by every planet of the same division, scaled by the height.
+struct PlanetVertex {
+    uint16_t height;   // Distance to the center, normalized in the height range of the planet
+    uint8_t slope;     // Blending between the flat and the steep colors
+    uint8_t padding;   // Keeps the normal aligned on 4 bytes
+    int16_t normal[2]; // Octahedral encoded normal
+};
+static_assert(sizeof(PlanetVertex) == 8, "PlanetVertex must stay packed");
+
+vcl::vec2 octahedralEncode(vcl::vec3 const& n);
+vcl::vec3 octahedralDecode(vcl::vec2 const& e); // Same as octahedralDecode in shaders/planet/planet.vert.glsl
+
+// Smallest and largest distance to the center, the range of the 16 bit height
+vcl::vec2 planetHeightRange(vcl::buffer<vcl::vec3> const& position);
+PlanetVertex packPlanetVertex(vcl::vec3 const& position, vcl::vec3 const& normal, float slope, vcl::vec2 const& heightRange);
+// Every vertex, needs no OpenGL so that the planets are packed on the thread building them
+std::vector<PlanetVertex> packPlanetVertices(vcl::buffer<vcl::vec3> const& position, vcl::buffer<vcl::vec3> const& normal, vcl::buffer<float> const& slope, vcl::vec2 const& heightRange);
+float unpackHeight(PlanetVertex const& vertex, vcl::vec2 const& heightRange);
+
+
+struct IcosphereTopology;
+
+// Planet mesh on the GPU with the PlanetVertex layout instead of the four float buffers of vcl::mesh_drawable.
+// Move-only: it owns its vertex array and the vertex buffer of the planet. The directions and the index buffer
+// belong to the shared topology, and a coarser level of detail reuses the vertex buffer of the finest one.
+struct planet_mesh_drawable {
+
+	planet_mesh_drawable() {}
+	planet_mesh_drawable(IcosphereTopology const& topology, GLuint shader);
+	// Other level of the topology drawing the vertices of finest
+	planet_mesh_drawable(planet_mesh_drawable const& finest, IcosphereTopology const& topology, int level);
+
+	gl_vertex_array vao;
+	gl_buffer vertices; // Empty for a coarser level
+	GLuint vertexBuffer = 0;
+	GLuint directions = 0;
+	GLuint indexBuffer = 0;
+	GLuint number_triangles = 0;
+	vcl::vec2 heightRange = { 1.0f, 1.0f };
+
+	GLuint shader = 0;
+	GLuint texture = 0;
+	vcl::affine_rts transform;
+	vcl::shading_parameters_phong shading;
+
+	// Pack and upload the displaced terrain
+	void update(vcl::buffer<vcl::vec3> const& position, vcl::buffer<vcl::vec3> const& normal, vcl::buffer<float> const& slope);
+	// Part of the vertices, packed in the height range of the drawable
+	void uploadVertices(PlanetVertex const* packed, size_t first, size_t count);
+};
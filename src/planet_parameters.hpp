@@ -0,0 +1,62 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "noises.hpp"
+#include "terrain.hpp"
+
+// Everything a planet file describes: the shape of the terrain and the look of the planet.
+// Needs no OpenGL, so the tools read and write planets without building them.
+struct PlanetParameters {
+	float radius = 1.0f;
+	float rotateSpeed = 0.0f;
+
+    // Colors
+    vcl::vec3 flatLowColor = { 1.0f, 1.0f, 1.0f };
+    vcl::vec3 flatHighColor = { 0.8f, 1.0f, 1.0f };
+    vcl::vec3 steepColor = { 0.4f, 0.2f, 0.0f };
+    float maxSlope = 0.3f;
+
+	// Continent
+	perlin_noise_parameters continentParameters;
+
+	// Mountains
+	perlin_noise_parameters mountainsParameters;
+	perlin_noise_parameters maskParameters;
+
+	float mountainSharpness = 1.0f;
+	float mountainsBlend = 1.0f;
+	float maskShift = 0.0f;
+
+	// Oceans
+	float oceanFloorDepth = 0.5f;
+	float oceanFloorSmoothing = 1.0f;
+	float oceanDepthMultiplier = 2.0f;
+
+    // Water
+    float waterLevel = 1.0f;
+    vcl::vec4 waterColorSurface = { 0.0f, 0.2f, 1.0f, 1.0f};
+    vcl::vec4 waterColorDeep = { 0.0f, 0.0f, 0.0f, 1.0f };
+    float depthMultiplier = 6.0f;
+    float waterBlendMultiplier = 60.0f;
+
+	// Texture
+	float textureScale = 1.0f;
+	float textureSharpness = 5.0f;
+	float normalMapInfluence = 0.2f;
+
+    // Atmosphere
+    bool hasAtmosphere = false;
+    float atmosphereHeight = 3.0f;
+    float densityFalloff = 3.0f;
+
+    float wavelengths[3] = { 700, 530, 440 };
+    float scatteringStrength = 1.0f;
+
+    // Misc
+    bool isSun = false;
+    bool waterGlow = false;
+    bool specularWater = true;
+    float specular = 0.0f; // Of the terrain
+
+    TerrainParameters terrainParameters() const; // Copy of the members shaping the surface
+};
@@ -0,0 +1,110 @@
+#include "planet_surface.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace vcl;
+
+void initializeSurface(PlanetSurface& surface, IcosphereTopology const& topology) {
+    surface.positions = topology.directions;
+    surface.normals = topology.directions;
+    surface.slopes.resize(topology.directions.size());
+    surface.clusters = topology.levels[0].clusters;
+    surface.clustersLowRes = topology.levels[1].clusters;
+}
+
+static size_t clustersBytes(MeshClusters const& clusters) {
+    return clusters.clusters.capacity() * sizeof(MeshCluster) + clusters.counts.capacity() * sizeof(GLsizei)
+        + clusters.offsets.capacity() * sizeof(void const*);
+}
+
+size_t surfaceBytes(PlanetSurface const& surface) {
+    return surface.positions.size() * sizeof(vec3) + surface.normals.size() * sizeof(vec3) + surface.slopes.size() * sizeof(float)
+        + clustersBytes(surface.clusters) + clustersBytes(surface.clustersLowRes);
+}
+
+size_t topologyBytes(IcosphereTopology const& topology) {
+    size_t bytes = topology.directions.size() * sizeof(vec3);
+    for (IcosphereLevel const& level : topology.levels)
+        bytes += level.connectivity.size() * sizeof(uint3) + clustersBytes(level.clusters);
+    return bytes;
+}
+
+void displaceSurface(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, size_t first, size_t last) {
+    for (size_t i = first; i < last; i++)
+        surface.positions[i] = terrainPosition(terrain, topology.directions[i]);
+}
+
+void colorSurfaceSlopes(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, size_t first, size_t last) {
+    for (size_t i = first; i < last; i++)
+        surface.slopes[i] = terrainSlope(terrain, topology.directions[i], norm(surface.positions[i]));
+}
+
+void computeSurfaceNormals(IcosphereTopology const& topology, PlanetSurface& surface) {
+    TraceScope trace("normal_per_vertex");
+    normal_per_vertex(surface.positions, topology.levels[0].connectivity, surface.normals);
+}
+
+void updateSurfaceBounds(IcosphereTopology const& topology, PlanetSurface& surface) {
+    TraceScope trace("updateClusterBounds");
+    updateClusterBounds(surface.clusters, surface.positions, topology.levels[0].connectivity);
+    updateClusterBounds(surface.clustersLowRes, surface.positions, topology.levels[1].connectivity);
+}
+
+void generateSurface(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, unsigned int threads) {
+    size_t const size = topology.directions.size();
+    threads = std::max(1u, threads);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++) {
+        size_t const first = size * t / threads;
+        size_t const last = size * (t + 1) / threads;
+        workers.push_back(std::thread([&, first, last]() {
+            TraceScope trace("updateFragmentMesh");
+            displaceSurface(terrain, topology, surface, first, last);
+            colorSurfaceSlopes(terrain, topology, surface, first, last);
+        }));
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+
+    computeSurfaceNormals(topology, surface);
+    updateSurfaceBounds(topology, surface);
+}
+
+std::vector<vec3> vegetationAnchors(TerrainParameters const& terrain, size_t count, float maxSteepness, uint32_t seed) {
+    // Same generator as the benchmarks, so that an anchor only depends on the seed and its index
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ seed;
+    auto const random = [&state]() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return float(state >> 40) / float(1 << 24);
+    };
+
+    std::vector<vec3> anchors;
+    anchors.reserve(count);
+    for (size_t attempt = 0; attempt < 16 * count && anchors.size() < count; attempt++) {
+        float const z = 2.0f * random() - 1.0f;
+        float const angle = 2.0f * pi * random();
+        float const r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        vec3 const direction = { r * std::cos(angle), r * std::sin(angle), z };
+        vec3 const position = terrainPosition(terrain, direction);
+        if (terrainSlope(terrain, direction, norm(position)) <= maxSteepness)
+            anchors.push_back(position);
+    }
+    return anchors;
+}
+
+std::vector<float> surfaceHeightfield(TerrainParameters const& terrain, unsigned int width, unsigned int height) {
+    std::vector<float> heights(size_t(width) * height);
+    for (unsigned int row = 0; row < height; row++) {
+        // Texel centers, the poles are never sampled exactly
+        float const latitude = pi * (0.5f - (row + 0.5f) / height);
+        for (unsigned int column = 0; column < width; column++) {
+            float const longitude = 2.0f * pi * (column + 0.5f) / width;
+            vec3 const direction = { std::cos(latitude) * std::cos(longitude), std::cos(latitude) * std::sin(longitude), std::sin(latitude) };
+            heights[size_t(row) * width + column] = norm(terrainPosition(terrain, direction));
+        }
+    }
+    return heights;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "terrain.hpp"
+#include "icosphere.hpp"
+#include "mesh_clusters.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Generated part of a planet mesh: its terrain over the sphere of a shared topology.
+// Needs no OpenGL context, so the viewer and the planet_bake tool build it the same way.
+struct PlanetSurface {
+    vcl::buffer<vcl::vec3> positions;
+    vcl::buffer<vcl::vec3> normals;
+    vcl::buffer<float> slopes; // Blending between the flat and the steep colors
+    MeshClusters clusters;     // Only the clusters facing the camera and above the horizon are drawn
+    MeshClusters clustersLowRes;
+};
+
+// Buffers sized for the topology: the unit sphere, with the clusters of both levels
+void initializeSurface(PlanetSurface& surface, IcosphereTopology const& topology);
+
+// Bytes of the buffers in memory, the topology being shared by the planets of the same division
+size_t surfaceBytes(PlanetSurface const& surface);
+size_t topologyBytes(IcosphereTopology const& topology);
+
+// Stages of the generation. The first two cover the vertices [first, last) so that they can be split between threads.
+void displaceSurface(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, size_t first, size_t last);
+void colorSurfaceSlopes(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, size_t first, size_t last);
+void computeSurfaceNormals(IcosphereTopology const& topology, PlanetSurface& surface);
+void updateSurfaceBounds(IcosphereTopology const& topology, PlanetSurface& surface);
+
+// Every stage, the displacement and the slopes split between threads
+void generateSurface(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, unsigned int threads);
+
+// Points of the surface flat enough for the plants, spread over the sphere from the seed.
+// Fewer than count when most of the surface is too steep.
+std::vector<vcl::vec3> vegetationAnchors(TerrainParameters const& terrain, size_t count, float maxSteepness, uint32_t seed);
+
+// Radius of the surface on a latitude-longitude grid, row 0 at the north pole (+z)
+std::vector<float> surfaceHeightfield(TerrainParameters const& terrain, unsigned int width, unsigned int height);
@@ -0,0 +1,233 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Past this many frames in flight the oldest results are dropped instead of waited for
+static size_t const maxPendingFrames = 8;
+
+RollingSamples::RollingSamples(size_t capacity_arg) : capacity(std::max<size_t>(capacity_arg, 1)) {
+    samples.reserve(capacity);
+}
+
+void RollingSamples::add(float value) {
+    if (samples.size() < capacity) {
+        samples.push_back(value);
+        return;
+    }
+    samples[next] = value;
+    next = (next + 1) % capacity;
+}
+
+float RollingSamples::last() const {
+    if (samples.empty())
+        return 0.0f;
+    if (samples.size() < capacity)
+        return samples.back();
+    return samples[(next + capacity - 1) % capacity];
+}
+
+float RollingSamples::minimum() const {
+    if (samples.empty())
+        return 0.0f;
+    return *std::min_element(samples.begin(), samples.end());
+}
+
+float RollingSamples::average() const {
+    if (samples.empty())
+        return 0.0f;
+    float sum = 0.0f;
+    for (float const sample : samples)
+        sum += sample;
+    return sum / float(samples.size());
+}
+
+float RollingSamples::percentile(float fraction) const {
+    if (samples.empty())
+        return 0.0f;
+    std::vector<float> sorted = samples;
+    size_t const rank = size_t(std::ceil(std::min(std::max(fraction, 0.0f), 1.0f) * float(sorted.size())));
+    size_t const index = rank == 0 ? 0 : rank - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+
+std::string profileCsv(std::vector<ZoneStats> const& zones) {
+    std::ostringstream csv;
+    csv << "zone,cpu_samples,cpu_min_ms,cpu_avg_ms,cpu_p99_ms,gpu_samples,gpu_min_ms,gpu_avg_ms,gpu_p99_ms\n";
+    for (ZoneStats const& zone : zones) {
+        csv << zone.name << ',' << zone.cpuSamples << ',' << zone.cpuMinimum << ',' << zone.cpuAverage << ',' << zone.cpuP99 << ','
+            << zone.gpuSamples << ',' << zone.gpuMinimum << ',' << zone.gpuAverage << ',' << zone.gpuP99 << '\n';
+    }
+    return csv.str();
+}
+
+
+size_t FrameProfiler::zone(char const* name) {
+    for (size_t i = 0; i < zones.size(); i++)
+        if (zones[i].name == name)
+            return i;
+    zones.push_back(Zone());
+    zones.back().name = name;
+    return zones.size() - 1;
+}
+
+void FrameProfiler::beginFrame() {
+    frameStart = std::chrono::steady_clock::now();
+
+    // The queries of a frame end in order, the last one being available means they all are
+    while (!pendingFrames.empty()) {
+        std::vector<Query> const& queries = pendingFrames.front();
+        if (!queries.empty() && pendingFrames.size() <= maxPendingFrames) {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(queries.back().id, GL_QUERY_RESULT_AVAILABLE, &available); opengl_check;
+            if (available == GL_FALSE)
+                break;
+            collect(queries);
+        }
+        for (Query const& query : queries)
+            freeQueries.push_back(query.id);
+        pendingFrames.pop_front();
+    }
+}
+
+void FrameProfiler::collect(std::vector<Query> const& queries) {
+    std::vector<float> frameGpu(zones.size(), -1.0f);
+    for (Query const& query : queries) {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &nanoseconds); opengl_check;
+        float& total = frameGpu[query.zone];
+        total = std::max(total, 0.0f) + float(nanoseconds) * 1e-6f;
+    }
+    for (size_t i = 0; i < zones.size(); i++)
+        if (frameGpu[i] >= 0.0f)
+            zones[i].gpu.add(frameGpu[i]);
+}
+
+void FrameProfiler::endFrame() {
+    std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - frameStart;
+    addCpuTime(zone("Frame"), duration.count());
+    for (Zone& zone : zones) {
+        if (!zone.entered)
+            continue;
+        zone.cpu.add(zone.frameCpu);
+        zone.frameCpu = 0.0f;
+        zone.entered = false;
+    }
+    pendingFrames.push_back(std::move(frameQueries));
+    frameQueries.clear();
+}
+
+bool FrameProfiler::beginQuery(size_t zone) {
+    if (queryOpen)
+        return false;
+    GLuint id = 0;
+    if (freeQueries.empty())
+        glGenQueries(1, &id);
+    else {
+        id = freeQueries.back();
+        freeQueries.pop_back();
+    }
+    glBeginQuery(GL_TIME_ELAPSED, id); opengl_check;
+    frameQueries.push_back({ zone, id });
+    queryOpen = true;
+    return true;
+}
+
+void FrameProfiler::endQuery() {
+    glEndQuery(GL_TIME_ELAPSED); opengl_check;
+    queryOpen = false;
+}
+
+void FrameProfiler::addCpuTime(size_t zone, float milliseconds) {
+    zones[zone].frameCpu += milliseconds;
+    zones[zone].entered = true;
+}
+
+std::vector<ZoneStats> FrameProfiler::stats() const {
+    std::vector<ZoneStats> result;
+    for (Zone const& zone : zones) {
+        ZoneStats stats;
+        stats.name = zone.name;
+        stats.cpuSamples = zone.cpu.size();
+        stats.cpuMinimum = zone.cpu.minimum();
+        stats.cpuAverage = zone.cpu.average();
+        stats.cpuP99 = zone.cpu.percentile(0.99f);
+        stats.gpuSamples = zone.gpu.size();
+        stats.gpuMinimum = zone.gpu.minimum();
+        stats.gpuAverage = zone.gpu.average();
+        stats.gpuP99 = zone.gpu.percentile(0.99f);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+bool FrameProfiler::writeCsv(std::string const& path) const {
+    std::ofstream file(path);
+    file << profileCsv(stats());
+    if (!file) {
+        std::cerr << "Cannot write the profile in " << path << std::endl;
+        return false;
+    }
+    std::cout << "Profile written in " << path << std::endl;
+    return true;
+}
+
+FrameProfiler& profiler() {
+    static FrameProfiler instance;
+    return instance;
+}
+
+
+ProfileZone::ProfileZone(char const* name, bool gpu) {
+    zone = profiler().zone(name);
+    query = gpu && profiler().beginQuery(zone);
+    start = std::chrono::steady_clock::now();
+}
+
+ProfileZone::~ProfileZone() {
+    std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    if (query)
+        profiler().endQuery();
+    profiler().addCpuTime(zone, duration.count());
+}
+
+
+void displayProfiler(FrameProfiler& profiler, bool* open) {
+    if (!ImGui::Begin("Profiler", open, ImGuiWindowFlags_AlwaysAutoResize)) {
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("Milliseconds over the last frames, the GPU times are a few frames late");
+    ImGui::Columns(7, "zones");
+    char const* const headers[] = { "Zone", "CPU avg", "CPU min", "CPU p99", "GPU avg", "GPU min", "GPU p99" };
+    for (char const* header : headers) {
+        ImGui::Text("%s", header);
+        ImGui::NextColumn();
+    }
+    ImGui::Separator();
+    for (ZoneStats const& zone : profiler.stats()) {
+        ImGui::Text("%s", zone.name.c_str()); ImGui::NextColumn();
+        ImGui::Text("%.3f", zone.cpuAverage); ImGui::NextColumn();
+        ImGui::Text("%.3f", zone.cpuMinimum); ImGui::NextColumn();
+        ImGui::Text("%.3f", zone.cpuP99); ImGui::NextColumn();
+        if (zone.gpuSamples == 0) {
+            for (int i = 0; i < 3; i++) {
+                ImGui::TextDisabled("-");
+                ImGui::NextColumn();
+            }
+            continue;
+        }
+        ImGui::Text("%.3f", zone.gpuAverage); ImGui::NextColumn();
+        ImGui::Text("%.3f", zone.gpuMinimum); ImGui::NextColumn();
+        ImGui::Text("%.3f", zone.gpuP99); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    if (ImGui::Button("Export CSV"))
+        profiler.writeCsv("profile.csv");
+    ImGui::End();
+}
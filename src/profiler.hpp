@@ -0,0 +1,107 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Last samples of a measure, in milliseconds
+class RollingSamples {
+public:
+    explicit RollingSamples(size_t capacity = 240);
+
+    void add(float value);
+    size_t size() const { return samples.size(); }
+    float last() const;
+    float minimum() const;
+    float average() const;
+    float percentile(float fraction) const; // Nearest rank, fraction in [0, 1]
+
+private:
+    std::vector<float> samples;
+    size_t capacity;
+    size_t next = 0; // Oldest sample once the window is full
+};
+
+struct ZoneStats {
+    std::string name;
+    size_t cpuSamples = 0;
+    float cpuMinimum = 0.0f;
+    float cpuAverage = 0.0f;
+    float cpuP99 = 0.0f;
+    size_t gpuSamples = 0; // 0 for the CPU only zones
+    float gpuMinimum = 0.0f;
+    float gpuAverage = 0.0f;
+    float gpuP99 = 0.0f;
+};
+
+// One line per zone, times in milliseconds
+std::string profileCsv(std::vector<ZoneStats> const& zones);
+
+// Time per frame of named zones, on the CPU and optionally on the GPU.
+// A zone entered several times in a frame, as the terrain of each planet, gets the sum. A frame where it is not
+// entered adds no sample. The GPU times come from GL_TIME_ELAPSED queries read back when they are available,
+// usually two or three frames late, so the profiler never waits for the GPU. The queries are never deleted,
+// the profiler of profiler() lives as long as the context.
+// Every function must be called on the thread of the OpenGL context.
+class FrameProfiler {
+public:
+    FrameProfiler() {}
+    FrameProfiler(FrameProfiler const&) = delete;
+    FrameProfiler& operator=(FrameProfiler const&) = delete;
+
+    void beginFrame(); // Collects the GPU results that are ready
+    void endFrame();
+
+    size_t zone(char const* name);
+    // GL_TIME_ELAPSED queries cannot nest: a GPU zone inside another one only gets its CPU time
+    bool beginQuery(size_t zone);
+    void endQuery();
+    void addCpuTime(size_t zone, float milliseconds);
+
+    std::vector<ZoneStats> stats() const;
+    bool writeCsv(std::string const& path) const;
+
+private:
+    struct Zone {
+        std::string name;
+        RollingSamples cpu;
+        RollingSamples gpu;
+        float frameCpu = 0.0f;
+        bool entered = false;
+    };
+    struct Query {
+        size_t zone;
+        GLuint id;
+    };
+
+    void collect(std::vector<Query> const& queries);
+
+    std::vector<Zone> zones;
+    std::vector<Query> frameQueries;
+    std::deque<std::vector<Query>> pendingFrames;
+    std::vector<GLuint> freeQueries;
+    bool queryOpen = false;
+    std::chrono::steady_clock::time_point frameStart;
+};
+
+FrameProfiler& profiler();
+
+// Scoped zone of profiler()
+class ProfileZone {
+public:
+    explicit ProfileZone(char const* name, bool gpu = false);
+    ~ProfileZone();
+    ProfileZone(ProfileZone const&) = delete;
+    ProfileZone& operator=(ProfileZone const&) = delete;
+
+private:
+    size_t zone;
+    bool query;
+    std::chrono::steady_clock::time_point start;
+};
+
+// ImGui window with the statistics of every zone and the CSV export
+void displayProfiler(FrameProfiler& profiler, bool* open);
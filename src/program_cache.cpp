@@ -0,0 +1,234 @@
+#include "program_cache.hpp"
+#include "mapped_file.hpp"
+#include "opengl_extensions.hpp"
+#include "trace.hpp"
+#include "gl_task_queue.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static char const programBinaryMagic[4] = { 'P', 'B', 'I', 'N' };
+static uint32_t const programBinaryVersion = 1;
+
+// FNV-1a, the strings are separated so that moving text from one source to the other changes the key
+static uint64_t hashString(uint64_t hash, std::string const& text) {
+    for (unsigned char const c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+    return hash;
+}
+
+uint64_t programCacheKey(std::string const& vertexSource, std::string const& fragmentSource, std::string const& driver) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hashString(hash, vertexSource);
+    hash = hashString(hash, fragmentSource);
+    return hashString(hash, driver);
+}
+
+std::string programCachePath(std::string const& directory, uint64_t key) {
+    char name[17];
+    for (int i = 0; i < 16; i++)
+        name[i] = "0123456789abcdef"[(key >> (60 - 4 * i)) & 0xf];
+    name[16] = '\0';
+    return directory + "/" + name + ".bin";
+}
+
+std::vector<unsigned char> packProgramBinary(uint64_t key, GLenum format, std::vector<unsigned char> const& binary) {
+    ProgramBinaryHeader header;
+    std::memcpy(header.magic, programBinaryMagic, 4);
+    header.version = programBinaryVersion;
+    header.key = key;
+    header.format = format;
+    header.size = uint32_t(binary.size());
+
+    std::vector<unsigned char> data(sizeof(header) + binary.size());
+    std::memcpy(data.data(), &header, sizeof(header));
+    if (!binary.empty())
+        std::memcpy(data.data() + sizeof(header), binary.data(), binary.size());
+    return data;
+}
+
+bool unpackProgramBinary(unsigned char const* data, size_t size, uint64_t key, GLenum& format, std::vector<unsigned char>& binary) {
+    if (size < sizeof(ProgramBinaryHeader))
+        return false;
+    ProgramBinaryHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, programBinaryMagic, 4) != 0 || header.version != programBinaryVersion)
+        return false;
+    if (header.key != key || header.size == 0 || header.size > size - sizeof(header))
+        return false;
+    format = header.format;
+    binary.assign(data + sizeof(header), data + sizeof(header) + header.size);
+    return true;
+}
+
+
+static void printShaderLog(GLuint shader) {
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    if (length <= 1)
+        return;
+    std::vector<GLchar> log(size_t(length) + 1);
+    glGetShaderInfoLog(shader, length, &length, log.data());
+    std::cout << "[Info from shader compilation]" << std::endl << log.data() << std::endl;
+}
+
+static GLuint compileShader(std::string const& source, GLenum type) {
+    GLuint const shader = glCreateShader(type); opengl_check;
+    char const* const text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader); opengl_check;
+    return shader;
+}
+
+ProgramCache::ProgramCache(std::string const& directory_arg)
+    : directory(directory_arg) {
+}
+
+void ProgramCache::initialize() {
+    auto const glString = [](GLenum name) {
+        char const* const text = reinterpret_cast<char const*>(glGetString(name));
+        return std::string(text != nullptr ? text : "");
+    };
+    driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+    binaries = glExtensions.programBinary;
+    if (glExtensions.parallelShaderCompile)
+        glExtensions.MaxShaderCompilerThreads(0xFFFFFFFF); // As many as the driver wants
+    std::cout << "Program binaries " << (binaries ? "available" : "not available")
+        << ", parallel shader compile " << (glExtensions.parallelShaderCompile ? "available" : "not available") << std::endl;
+}
+
+PendingProgram ProgramCache::request(std::string const& vertexSource, std::string const& fragmentSource) {
+    TraceScope trace("ProgramCache::request");
+    auto const start = std::chrono::steady_clock::now();
+    PendingProgram pending;
+    pending.key = programCacheKey(vertexSource, fragmentSource, driver);
+    pending.program = loadBinary(pending.key);
+    if (pending.program != 0) {
+        std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+        counters.hits++;
+        counters.hitMilliseconds += duration.count();
+        return pending;
+    }
+
+    // No status query here, it would wait for the driver
+    pending.vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
+    pending.fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
+    pending.program = glCreateProgram(); opengl_check;
+    glAttachShader(pending.program, pending.vertexShader);
+    glAttachShader(pending.program, pending.fragmentShader);
+    if (binaries)
+        glExtensions.ProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(pending.program); opengl_check;
+
+    std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    counters.compileMilliseconds += duration.count();
+    return pending;
+}
+
+GLuint ProgramCache::finish(PendingProgram& pending) {
+    GLuint const program = pending.program;
+    if (pending.vertexShader == 0)
+        return program; // Cache hit, already checked by loadBinary
+
+    TraceScope trace("ProgramCache::finish");
+    auto const start = std::chrono::steady_clock::now();
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        printShaderLog(pending.vertexShader);
+        printShaderLog(pending.fragmentShader);
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<GLchar> log(size_t(length) + 1);
+        glGetProgramInfoLog(program, length, &length, log.data());
+        std::cout << "[Info from shader Link]" << std::endl << log.data() << std::endl;
+        std::cout << "Failed to link shader program" << std::endl;
+        abort();
+    }
+    glDetachShader(program, pending.vertexShader);
+    glDetachShader(program, pending.fragmentShader);
+    glDeleteShader(pending.vertexShader);
+    glDeleteShader(pending.fragmentShader);
+    pending.vertexShader = pending.fragmentShader = 0;
+    // Only useful to the next runs, saved in a later frame rather than during the startup
+    uint64_t const key = pending.key;
+    if (binaries)
+        glTasks().post([this, program, key]() {
+            if (glIsProgram(program))
+                storeBinary(program, key);
+            return size_t(0);
+        });
+
+    std::chrono::duration<float, std::milli> const duration = std::chrono::steady_clock::now() - start;
+    counters.compiles++;
+    counters.compileMilliseconds += duration.count();
+    return program;
+}
+
+GLuint ProgramCache::create(std::string const& vertexSource, std::string const& fragmentSource) {
+    PendingProgram pending = request(vertexSource, fragmentSource);
+    return finish(pending);
+}
+
+GLuint ProgramCache::loadBinary(uint64_t key) const {
+    if (!binaries)
+        return 0;
+    MappedFile const file(programCachePath(directory, key));
+    GLenum format = 0;
+    std::vector<unsigned char> binary;
+    if (!file.valid() || !unpackProgramBinary(file.data(), file.size(), key, format, binary))
+        return 0;
+
+    GLuint const program = glCreateProgram(); opengl_check;
+    glExtensions.ProgramBinary(program, format, binary.data(), GLsizei(binary.size()));
+    // Rejected after a driver update keeping the same version string, compiled again and overwritten
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE) {
+        glGetError(); // An invalid format may raise an error
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::storeBinary(GLuint program, uint64_t key) const {
+    if (!binaries)
+        return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<unsigned char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    glExtensions.GetProgramBinary(program, length, &length, &format, binary.data()); opengl_check;
+    binary.resize(static_cast<size_t>(length));
+
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+    std::vector<unsigned char> const data = packProgramBinary(key, format, binary);
+    std::ofstream file(programCachePath(directory, key), std::ios::binary);
+    file.write(reinterpret_cast<char const*>(data.data()), std::streamsize(data.size()));
+    if (!file)
+        std::cerr << "Cannot write the program binary in " << directory << std::endl;
+}
+
+ProgramCache& programCache() {
+    static ProgramCache cache;
+    return cache;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked programs saved with glGetProgramBinary and reloaded with glProgramBinary on the next runs.
+// A binary is only valid for the driver that produced it, so the key hashes the sources and the driver string.
+// Layout of a file: ProgramBinaryHeader then the binary.
+
+struct ProgramBinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;      // Checked on load, a file name collision gives a miss
+    uint32_t format;   // Driver specific, passed back to glProgramBinary
+    uint32_t size;
+};
+
+uint64_t programCacheKey(std::string const& vertexSource, std::string const& fragmentSource, std::string const& driver);
+std::string programCachePath(std::string const& directory, uint64_t key);
+
+std::vector<unsigned char> packProgramBinary(uint64_t key, GLenum format, std::vector<unsigned char> const& binary);
+// False when the data is not a binary of the current version for this key
+bool unpackProgramBinary(unsigned char const* data, size_t size, uint64_t key, GLenum& format, std::vector<unsigned char>& binary);
+
+struct ProgramCacheStats {
+    int hits = 0;
+    int compiles = 0;
+    float hitMilliseconds = 0.0f;     // Loading the binaries
+    float compileMilliseconds = 0.0f; // Main thread time in the compiles, links and waits for the driver
+};
+
+// Program requested but not checked yet
+struct PendingProgram {
+    GLuint program = 0;
+    GLuint vertexShader = 0; // 0 when loaded from a binary
+    GLuint fragmentShader = 0;
+    uint64_t key = 0;
+};
+
+// With KHR_parallel_shader_compile the driver compiles and links on its own threads: request() returns
+// right away and only finish() waits, so the startup work between the two overlaps the compilation.
+// Without it the compile may still be deferred by the driver until the status is queried in finish().
+// The binaries of the compiled programs are saved in the next frames by the GL task queue.
+// Every function must be called on the thread of the OpenGL context.
+class ProgramCache {
+public:
+    explicit ProgramCache(std::string const& directory = "shader_cache");
+
+    // After loadOpenGLExtensions, reads the driver string and starts the compiler threads
+    void initialize();
+
+    PendingProgram request(std::string const& vertexSource, std::string const& fragmentSource);
+    // Aborts on a compile or link error, as vcl::opengl_create_shader_program
+    GLuint finish(PendingProgram& pending);
+    GLuint create(std::string const& vertexSource, std::string const& fragmentSource);
+
+    ProgramCacheStats stats() const { return counters; }
+
+private:
+    GLuint loadBinary(uint64_t key) const;
+    void storeBinary(GLuint program, uint64_t key) const;
+
+    std::string directory;
+    std::string driver;
+    bool binaries = false;
+    ProgramCacheStats counters;
+};
+
+ProgramCache& programCache();
@@ -0,0 +1,98 @@
+#include "residency.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+using namespace vcl;
+
+float prefetchDistance(vec3 const& viewer, vec3 const& velocity, vec3 const& center, float radius, float time) {
+    vec3 const toCenter = center - viewer;
+    float const speed2 = dot(velocity, velocity);
+    // Time of the closest approach, within the horizon
+    float const t = speed2 > 0.0f ? std::min(std::max(dot(toCenter, velocity) / speed2, 0.0f), time) : 0.0f;
+    return std::max(norm(toCenter - t * velocity) - radius, 0.0f);
+}
+
+static std::vector<size_t> sortedIndices(std::vector<float> const& keys) {
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    return order;
+}
+
+std::vector<size_t> refinementOrder(std::vector<ResidencyRequest> const& planets, vec3 const& viewer, std::vector<float> const& distances) {
+    std::vector<size_t> const nearest = sortedIndices(distances);
+    // Negated apparent size of the visible planets, then the distance of the others past every visible one
+    std::vector<float> keys(planets.size());
+    for (size_t i = 0; i < planets.size(); i++) {
+        float const toCenter = std::max(norm(planets[i].center - viewer), planets[i].radius);
+        keys[i] = planets[i].visible ? -planets[i].radius / toCenter : distances[i];
+    }
+    if (!nearest.empty())
+        keys[nearest[0]] = -std::numeric_limits<float>::infinity();
+    return sortedIndices(keys);
+}
+
+std::vector<ResidencyAction> planResidency(std::vector<ResidencyRequest> const& planets, vec3 const& viewer, vec3 const& velocity, ResidencySettings const& settings) {
+    std::vector<ResidencyAction> actions(planets.size(), ResidencyAction::Keep);
+    std::vector<float> distances(planets.size());
+    for (size_t i = 0; i < planets.size(); i++)
+        distances[i] = prefetchDistance(viewer, velocity, planets[i].center, planets[i].radius, settings.prefetchTime);
+    std::vector<size_t> farthest = sortedIndices(distances);
+    std::reverse(farthest.begin(), farthest.end());
+
+    // Memory once the loads in flight complete
+    size_t memory = 0;
+    int loads = 0;
+    for (ResidencyRequest const& planet : planets) {
+        memory += planet.memory.total() + (planet.state == Residency::Loading ? planet.fullMemory.total() : 0);
+        loads += planet.state == Residency::Loading ? 1 : 0;
+    }
+
+    // The planets left behind, then the farthest ones while over budget
+    for (size_t i : farthest) {
+        if (planets[i].state != Residency::Full)
+            continue;
+        if (distances[i] > settings.evictDistance || memory > settings.budget) {
+            actions[i] = ResidencyAction::Evict;
+            memory -= std::min(memory, planets[i].fullMemory.total());
+        }
+    }
+
+    // By priority, taking the memory of the planets farther than the refined one when needed
+    for (size_t i : refinementOrder(planets, viewer, distances)) {
+        if (loads >= settings.maxLoads)
+            break;
+        if (planets[i].state != Residency::Coarse || distances[i] > settings.refineDistance)
+            continue;
+        size_t const needed = planets[i].fullMemory.total();
+        for (size_t j : farthest) {
+            if (memory + needed <= settings.budget || distances[j] <= distances[i])
+                break;
+            if (planets[j].state == Residency::Full && actions[j] == ResidencyAction::Keep) {
+                actions[j] = ResidencyAction::Evict;
+                memory -= std::min(memory, planets[j].fullMemory.total());
+            }
+        }
+        // Waits for the viewer to leave another planet
+        if (memory + needed > settings.budget)
+            continue;
+        actions[i] = ResidencyAction::Refine;
+        memory += needed;
+        loads++;
+    }
+    return actions;
+}
+
+ResidencyStats summarizeResidency(std::vector<ResidencyRequest> const& planets, ResidencySettings const& settings) {
+    ResidencyStats stats;
+    stats.budget = settings.budget;
+    for (ResidencyRequest const& planet : planets) {
+        stats.memory.cpu += planet.memory.cpu;
+        stats.memory.gpu += planet.memory.gpu;
+        stats.full += planet.state == Residency::Full ? 1 : 0;
+        stats.loading += planet.state == Residency::Loading ? 1 : 0;
+    }
+    return stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Memory of the planets. The coarse meshes stay resident, the full resolution ones are brought in when the viewer
+// approaches and released when it leaves or a nearer planet needs the memory. They are built one at a time, the
+// planet under the viewer first, then the visible planets from the largest on screen.
+
+struct PlanetMemory {
+    size_t cpu = 0;
+    size_t gpu = 0;
+
+    size_t total() const { return cpu + gpu; }
+};
+
+struct ResidencySettings {
+    size_t budget = size_t(1) << 30; // Bytes of every planet mesh, CPU and GPU
+    float refineDistance = 1500.0f;  // To the surface, under which the full resolution is built
+    float evictDistance = 3000.0f;   // Beyond which it is released, larger to avoid reloading back and forth
+    float prefetchTime = 3.0f;       // Seconds of travel at the viewer velocity looked ahead
+    int maxLoads = 1;                // Built at the same time, fewer loads show the first planets sooner
+};
+
+enum class Residency { Coarse, Loading, Full }; // Loading until built and uploaded
+
+struct ResidencyRequest {
+    vcl::vec3 center;
+    float radius = 0.0f;
+    bool visible = true; // In the frustum
+    Residency state = Residency::Coarse;
+    PlanetMemory memory;      // Resident now
+    PlanetMemory fullMemory;  // Added by the full resolution once loaded
+};
+
+enum class ResidencyAction { Keep, Refine, Evict };
+
+struct ResidencyStats {
+    PlanetMemory memory;
+    size_t budget = 0;
+    int full = 0;
+    int loading = 0;
+};
+
+// Smallest distance to the surface of the sphere over the next time seconds, moving in a straight line
+float prefetchDistance(vcl::vec3 const& viewer, vcl::vec3 const& velocity, vcl::vec3 const& center, float radius, float time);
+
+// Order in which the planets are refined: the nearest one, then the visible ones by decreasing apparent size,
+// then the others by distance
+std::vector<size_t> refinementOrder(std::vector<ResidencyRequest> const& planets, vcl::vec3 const& viewer, std::vector<float> const& distances);
+
+// Action of each planet. A planet being loaded is never evicted, its memory counts as if it were resident.
+std::vector<ResidencyAction> planResidency(std::vector<ResidencyRequest> const& planets, vcl::vec3 const& viewer, vcl::vec3 const& velocity, ResidencySettings const& settings);
+
+ResidencyStats summarizeResidency(std::vector<ResidencyRequest> const& planets, ResidencySettings const& settings);
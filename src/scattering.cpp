@@ -0,0 +1,27 @@
+#include "scattering.hpp"
+
+#include <algorithm>
+
+unsigned int scatteringResolution(unsigned int fullSize, ScatteringQuality quality) {
+    unsigned int divisor = static_cast<unsigned int>(quality);
+    return std::max(1u, (fullSize + divisor - 1) / divisor);
+}
+
+ScatteringPassPlan planScatteringPass(ScatteringSettings const& settings, unsigned int width, unsigned int height, int nScatteringPoints, unsigned int frameIndex) {
+    ScatteringPassPlan plan;
+    plan.width = scatteringResolution(width, settings.quality);
+    plan.height = scatteringResolution(height, settings.quality);
+    plan.divisor = static_cast<unsigned int>(settings.quality);
+    plan.temporal = settings.temporal && settings.temporalFrames > 1;
+    plan.separatePass = plan.temporal || settings.quality != ScatteringQuality::Full;
+    plan.sampleCount = nScatteringPoints;
+
+    if (plan.temporal) {
+        // Each frame takes a jittered subset of the samples, the history holds the others
+        int frames = settings.temporalFrames;
+        plan.sampleCount = std::max(2, (nScatteringPoints + frames - 1) / frames);
+        plan.jitter = ((frameIndex % frames) + 0.5f) / frames;
+        plan.historyWeight = 1.0f - 1.0f / frames;
+    }
+    return plan;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "gl_object.hpp"
+
+// Resolution at which the atmosphere scattering is evaluated, as a divisor of the screen size
+enum class ScatteringQuality {
+    Full = 1,
+    Half = 2,
+    Quarter = 4
+};
+
+struct ScatteringSettings {
+    ScatteringQuality quality = ScatteringQuality::Full;
+    bool temporal = false;  // Amortize the ray-march samples across several frames
+    int temporalFrames = 4; // Number of frames over which the samples are spread
+};
+
+// What the post processing has to do this frame to evaluate the scattering.
+// Only depends on the settings, so it can be computed and checked without a GPU.
+struct ScatteringPassPlan {
+    unsigned int width = 0;     // Resolution of the scattering target
+    unsigned int height = 0;
+    unsigned int divisor = 1;   // Screen size over scattering size
+    bool separatePass = false;  // Scattering runs in its own pass and is upsampled in the water pass
+    bool temporal = false;      // The history of the previous frames is blended in
+
+    int sampleCount = 0;        // Ray-march samples taken this frame
+    float jitter = 0.0f;        // Offset of the first sample, in fraction of a step
+    float historyWeight = 0.0f; // Weight of the reprojected history in the blend
+};
+
+unsigned int scatteringResolution(unsigned int fullSize, ScatteringQuality quality);
+ScatteringPassPlan planScatteringPass(ScatteringSettings const& settings, unsigned int width, unsigned int height, int nScatteringPoints, unsigned int frameIndex);
+
+// Per planet state of the temporal accumulation
+struct ScatteringHistory {
+    gl_texture images[2];
+    int current = 0;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    bool valid = false;
+
+    vcl::mat4 previousViewProjection;
+    vcl::vec3 previousPosition;
+    vcl::vec4 previousBounds; // Texture coordinates of the region written last frame
+};
@@ -0,0 +1,77 @@
+#include "screen_rect.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Slopes x/depth of the two lines from the camera tangent to the circle (c, depth) of radius r
+static void tangentSlopes(float c, float depth, float radius, float& minSlope, float& maxSlope) {
+    float const t = std::sqrt(c * c + depth * depth - radius * radius);
+    float const denominator = depth * depth - radius * radius;
+    minSlope = (c * depth - radius * t) / denominator;
+    maxSlope = (c * depth + radius * t) / denominator;
+}
+
+static ScreenRect fullScreen(unsigned int width, unsigned int height) {
+    ScreenRect rect;
+    rect.width = width;
+    rect.height = height;
+    rect.visible = true;
+    return rect;
+}
+
+ScreenRect projectedSphereRect(vcl::vec3 const& center, float radius, vcl::mat4 const& projection, float nearPlane, unsigned int width, unsigned int height) {
+    float const depth = -center.z;
+
+    // Entirely behind the near plane
+    if (depth + radius < nearPlane)
+        return ScreenRect();
+    // Crossing the near plane, or the camera is inside
+    if (depth - radius < nearPlane)
+        return fullScreen(width, height);
+
+    float minX, maxX, minY, maxY;
+    tangentSlopes(center.x, depth, radius, minX, maxX);
+    tangentSlopes(center.y, depth, radius, minY, maxY);
+
+    // Normalized device coordinates to pixels
+    float const x0 = (projection(0, 0) * minX + 1.0f) * 0.5f * width;
+    float const x1 = (projection(0, 0) * maxX + 1.0f) * 0.5f * width;
+    float const y0 = (projection(1, 1) * minY + 1.0f) * 0.5f * height;
+    float const y1 = (projection(1, 1) * maxY + 1.0f) * 0.5f * height;
+
+    ScreenRect rect;
+    if (x1 - x0 < 1.0f && y1 - y0 < 1.0f)
+        return rect;
+
+    int const left = std::max(0, (int)std::floor(x0));
+    int const right = std::min((int)width, (int)std::ceil(x1));
+    int const bottom = std::max(0, (int)std::floor(y0));
+    int const top = std::min((int)height, (int)std::ceil(y1));
+    if (right <= left || top <= bottom)
+        return rect;
+
+    rect.x = left;
+    rect.y = bottom;
+    rect.width = right - left;
+    rect.height = top - bottom;
+    rect.visible = true;
+    return rect;
+}
+
+ScreenRect downscaledRect(ScreenRect const& rect, unsigned int divisor, unsigned int width, unsigned int height) {
+    ScreenRect scaled;
+    if (!rect.visible)
+        return scaled;
+
+    int const left = std::max(0, rect.x / (int)divisor - 1);
+    int const bottom = std::max(0, rect.y / (int)divisor - 1);
+    int const right = std::min((int)width, (rect.x + rect.width + (int)divisor - 1) / (int)divisor + 1);
+    int const top = std::min((int)height, (rect.y + rect.height + (int)divisor - 1) / (int)divisor + 1);
+
+    scaled.x = left;
+    scaled.y = bottom;
+    scaled.width = right - left;
+    scaled.height = top - bottom;
+    scaled.visible = scaled.width > 0 && scaled.height > 0;
+    return scaled;
+}
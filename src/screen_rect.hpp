@@ -0,0 +1,20 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+// Pixel rectangle covered by an object on the screen
+struct ScreenRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    bool visible = false;
+};
+
+// Bounding rectangle of a sphere given in camera space (the camera looks towards -z).
+// The rectangle is clamped to the screen. Spheres behind the near plane, outside the screen
+// or covering less than a pixel are not visible. A sphere crossing the near plane covers the whole screen.
+ScreenRect projectedSphereRect(vcl::vec3 const& center, float radius, vcl::mat4 const& projection, float nearPlane, unsigned int width, unsigned int height);
+
+// Same rectangle in a target downscaled by divisor, grown by one texel for the bilinear footprint
+ScreenRect downscaledRect(ScreenRect const& rect, unsigned int divisor, unsigned int width, unsigned int height);
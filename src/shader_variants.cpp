@@ -0,0 +1,60 @@
+#include "shader_variants.hpp"
+
+std::string shaderWithDefines(std::string const& source, std::vector<std::string> const& defines) {
+    if (defines.empty())
+        return source;
+
+    std::string header;
+    for (std::string const& define : defines)
+        header += "#define " + define + "\n";
+
+    // #version must stay the first directive
+    size_t const version = source.find("#version");
+    if (version == std::string::npos)
+        return header + source;
+    size_t const lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos)
+        return source + "\n" + header;
+    return source.substr(0, lineEnd + 1) + header + source.substr(lineEnd + 1);
+}
+
+std::vector<std::string> definesForFeatures(std::vector<std::string> const& features, unsigned int mask) {
+    std::vector<std::string> defines;
+    for (size_t i = 0; i < features.size(); i++)
+        if (mask & (1u << i))
+            defines.push_back(features[i]);
+    return defines;
+}
+
+ShaderVariants::ShaderVariants(std::string const& vertexPath, std::string const& fragmentPath, std::vector<std::string> const& features_arg, std::vector<std::string> const& commonDefines_arg)
+    : vertexSource(vcl::read_text_file(vertexPath)), fragmentSource(vcl::read_text_file(fragmentPath)), features(features_arg), commonDefines(commonDefines_arg) {
+}
+
+// Bits without a feature would only duplicate a variant
+unsigned int ShaderVariants::validMask(unsigned int mask) const {
+    return mask & ((1u << features.size()) - 1);
+}
+
+void ShaderVariants::request(unsigned int mask) {
+    mask = validMask(mask);
+    if (programs.count(mask) != 0 || pending.count(mask) != 0)
+        return;
+
+    std::vector<std::string> defines = commonDefines;
+    for (std::string const& define : definesForFeatures(features, mask))
+        defines.push_back(define);
+    pending[mask] = programCache().request(shaderWithDefines(vertexSource, defines), shaderWithDefines(fragmentSource, defines));
+}
+
+GLuint ShaderVariants::program(unsigned int mask) {
+    mask = validMask(mask);
+    auto const cached = programs.find(mask);
+    if (cached != programs.end())
+        return cached->second;
+
+    request(mask);
+    GLuint const program = programCache().finish(pending[mask]);
+    pending.erase(mask);
+    programs[mask] = program;
+    return program;
+}
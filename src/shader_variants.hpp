@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "program_cache.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Insert "#define NAME" lines right after the #version directive of a shader source
+std::string shaderWithDefines(std::string const& source, std::vector<std::string> const& defines);
+
+// Bit i of a feature mask enables the define features[i]
+std::vector<std::string> definesForFeatures(std::vector<std::string> const& features, unsigned int mask);
+
+// Programs built from one pair of shader files with the features switched by #define instead of uniform branches.
+// Each variant is compiled the first time it is requested, then cached by its feature mask.
+// The programs go through programCache(), so the variants of the previous runs are loaded as binaries.
+// Every function but the constructor must be called on the thread of the OpenGL context.
+class ShaderVariants {
+public:
+    ShaderVariants() {}
+    // The common defines are added to every variant
+    ShaderVariants(std::string const& vertexPath, std::string const& fragmentPath, std::vector<std::string> const& features, std::vector<std::string> const& commonDefines = {});
+
+    // Start compiling a variant that will be needed, without waiting for it
+    void request(unsigned int mask);
+    GLuint program(unsigned int mask);
+    size_t compiledCount() const { return programs.size(); }
+
+private:
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::vector<std::string> features;
+    std::vector<std::string> commonDefines;
+    unsigned int validMask(unsigned int mask) const;
+
+    std::map<unsigned int, GLuint> programs;
+    std::map<unsigned int, PendingProgram> pending;
+};
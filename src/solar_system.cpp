@@ -0,0 +1,108 @@
+#include "solar_system.hpp"
+#include "planet_file.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+char const* const solarSystemPackPath = "planets/solar_system.psys";
+char const* const solarSystemScenePath = "planets/solar_system.scene";
+
+static bool readBool(std::istringstream& line, bool& value) {
+    std::string word;
+    line >> word;
+    value = word == "true";
+    return word == "true" || word == "false";
+}
+
+static bool readVec3(std::istringstream& line, vcl::vec3& value) {
+    return bool(line >> value.x >> value.y >> value.z);
+}
+
+// "full", "full/n" or a number
+static bool readDivision(std::istringstream& line, int resolution, int& division) {
+    std::string word;
+    line >> word;
+    if (word.compare(0, 4, "full") == 0) {
+        int const divisor = word.size() > 5 && word[4] == '/' ? std::atoi(word.c_str() + 5) : 1;
+        division = divisor > 0 && (word.size() == 4 || word[4] == '/') ? resolution / divisor : 0;
+    }
+    else
+        division = std::atoi(word.c_str());
+    return division > 0;
+}
+
+bool readSystemScene(std::string const& path, int resolution, std::vector<SystemPlanet>& planets) {
+    planets.clear();
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "ERROR : cannot read the scene " << path << std::endl;
+        return false;
+    }
+    std::string const directory = path.substr(0, path.find_last_of("/\\") + 1); // npos + 1 is 0
+
+    std::string text;
+    for (int number = 1; std::getline(file, text); number++) {
+        std::istringstream line(text.substr(0, text.find('#')));
+        std::string key;
+        if (!(line >> key))
+            continue;
+
+        bool valid = true;
+        if (key == "body") {
+            planets.emplace_back();
+            SystemPlanet& planet = planets.back();
+            valid = bool(line >> planet.name) && readPlanetFile(directory + planet.name + ".pbf", planet.parameters);
+            planet.orbit.division = resolution;
+        }
+        else if (planets.empty())
+            valid = false;
+        else {
+            PlanetOrbit& orbit = planets.back().orbit;
+            PlanetParameters& parameters = planets.back().parameters;
+            if (key == "mu")
+                valid = bool(line >> orbit.gravitationalParameter);
+            else if (key == "parent") {
+                std::string parent;
+                line >> parent;
+                orbit.parent = -1;
+                for (size_t i = 0; i + 1 < planets.size(); i++)
+                    if (planets[i].name == parent)
+                        orbit.parent = int(i);
+                valid = orbit.parent >= 0;
+            }
+            else if (key == "distance")
+                valid = bool(line >> orbit.distance);
+            else if (key == "phase") {
+                std::string phase;
+                line >> phase;
+                orbit.randomPhase = phase == "random";
+                orbit.phase = orbit.randomPhase ? 0.0f : float(std::atof(phase.c_str()));
+                valid = !phase.empty();
+            }
+            else if (key == "position")
+                valid = readVec3(line, orbit.position);
+            else if (key == "velocity")
+                valid = readVec3(line, orbit.velocity);
+            else if (key == "division")
+                valid = readDivision(line, resolution, orbit.division);
+            else if (key == "isSun")
+                valid = readBool(line, parameters.isSun);
+            else if (key == "waterGlow")
+                valid = readBool(line, parameters.waterGlow);
+            else if (key == "specularWater")
+                valid = readBool(line, parameters.specularWater);
+            else if (key == "specular")
+                valid = bool(line >> parameters.specular);
+            else
+                valid = false;
+        }
+        if (!valid) {
+            std::cerr << "ERROR : " << path << ":" << number << ": invalid line \"" << text << "\"" << std::endl;
+            planets.clear();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "system_pack.hpp"
+
+#include <string>
+#include <vector>
+
+// Pack of the shipped system, built by the system_pack tool. The viewer reads the scene without it.
+extern char const* const solarSystemPackPath;
+// Description of the bodies of the system and of their orbits, see the comments of the file
+extern char const* const solarSystemScenePath;
+
+// Bodies of a scene file, with the parameters of the .pbf files next to it. The divisions written full are
+// the given resolution. False with a message on std::cerr when the file is missing or a line is invalid.
+bool readSystemScene(std::string const& path, int resolution, std::vector<SystemPlanet>& planets);
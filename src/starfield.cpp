@@ -0,0 +1,113 @@
+#include "starfield.hpp"
+#include "program_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace vcl;
+
+// Splitmix64: small, fast and identical everywhere, unlike rand()
+class StarRandom {
+public:
+    explicit StarRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // In [0, 1)
+    float uniform() { return float(next() >> 40) / float(1 << 24); }
+
+    float gaussian() {
+        float const u = std::max(uniform(), 1e-7f);
+        float const v = uniform();
+        return std::sqrt(-2.0f * std::log(u)) * std::cos(2.0f * 3.14159265f * v);
+    }
+
+private:
+    uint64_t state;
+};
+
+vec3 blackBodyColor(float temperature) {
+    // Fit of the Planck locus in sRGB, valid from 1000 K to 40000 K
+    float const t = std::min(std::max(temperature, 1000.0f), 40000.0f) / 100.0f;
+    float r, g, b;
+    if (t <= 66.0f) {
+        r = 255.0f;
+        g = 99.4708025861f * std::log(t) - 161.1195681661f;
+        b = t <= 19.0f ? 0.0f : 138.5177312231f * std::log(t - 10.0f) - 305.0447927307f;
+    }
+    else {
+        r = 329.698727446f * std::pow(t - 60.0f, -0.1332047592f);
+        g = 288.1221695283f * std::pow(t - 60.0f, -0.0755148492f);
+        b = 255.0f;
+    }
+    vec3 color = { std::min(std::max(r, 0.0f), 255.0f), std::min(std::max(g, 0.0f), 255.0f), std::min(std::max(b, 0.0f), 255.0f) };
+    return color / std::max(color.x, std::max(color.y, color.z));
+}
+
+std::vector<Star> generateStarCatalog(StarfieldSettings const& settings) {
+    StarRandom random(settings.seed);
+
+    // The number of stars brighter than m grows as 10^(0.5 m): the magnitude is sampled by inverting it
+    float const slope = 0.5f;
+    float const brightestFraction = std::pow(10.0f, slope * (settings.brightestMagnitude - settings.faintestMagnitude));
+
+    std::vector<Star> stars(settings.count);
+    for (Star& star : stars) {
+        float const z = 2.0f * random.uniform() - 1.0f;
+        float const phi = 2.0f * 3.14159265f * random.uniform();
+        float const r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        star.direction = { r * std::cos(phi), r * std::sin(phi), z };
+
+        float const u = brightestFraction + (1.0f - brightestFraction) * random.uniform();
+        star.magnitude = std::max(settings.brightestMagnitude, settings.faintestMagnitude + std::log10(u) / slope);
+
+        // B-V color index around the one of the Sun, then its temperature (Ballesteros)
+        float const colorIndex = std::min(std::max(0.65f + 0.45f * random.gaussian(), -0.3f), 1.9f);
+        float const temperature = 4600.0f * (1.0f / (0.92f * colorIndex + 1.7f) + 1.0f / (0.92f * colorIndex + 0.62f));
+        star.color = blackBodyColor(temperature);
+    }
+    return stars;
+}
+
+
+Starfield::Starfield(StarfieldSettings const& settings) {
+    shader = programCache().create(read_text_file("shaders/starfield/starfield.vert.glsl"), read_text_file("shaders/starfield/starfield.frag.glsl"));
+    regenerate(settings);
+}
+
+void Starfield::regenerate(StarfieldSettings const& settings_arg) {
+    settings = settings_arg;
+    std::vector<Star> const stars = generateStarCatalog(settings);
+    std::vector<StarVertex> packed(stars.size());
+    for (size_t i = 0; i < stars.size(); i++) {
+        packed[i].direction = stars[i].direction;
+        packed[i].magnitude = stars[i].magnitude;
+        packed[i].color[0] = (unsigned char)std::lround(255 * stars[i].color.x);
+        packed[i].color[1] = (unsigned char)std::lround(255 * stars[i].color.y);
+        packed[i].color[2] = (unsigned char)std::lround(255 * stars[i].color.z);
+        packed[i].color[3] = 255;
+    }
+    count = static_cast<unsigned int>(packed.size());
+
+    vertices = gl_buffer::create();
+    glBindBuffer(GL_ARRAY_BUFFER, vertices.id()); opengl_check;
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(packed.size() * sizeof(StarVertex)), packed.data(), GL_STATIC_DRAW); opengl_check;
+
+    vao = gl_vertex_array::create();
+    glBindVertexArray(vao.id()); opengl_check;
+    GLsizei const stride = sizeof(StarVertex);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(StarVertex, direction))); opengl_check;
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(StarVertex, magnitude))); opengl_check;
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(StarVertex, color))); opengl_check;
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+#include "gl_object.hpp"
+#include "depth.hpp"
+
+#include <vector>
+
+struct StarfieldSettings {
+    unsigned int seed = 1;
+    unsigned int count = 8000;
+    float faintestMagnitude = 6.5f; // Limit of the naked eye
+    float brightestMagnitude = -1.5f;
+};
+
+struct Star {
+    vcl::vec3 direction; // On the unit celestial sphere
+    float magnitude = 0.0f;
+    vcl::vec3 color;     // Normalized color of the black body, in [0, 1]
+};
+
+// Same catalog for the same settings on every platform
+std::vector<Star> generateStarCatalog(StarfieldSettings const& settings);
+
+// Color of a black body, in [0, 1] with the largest channel at 1
+vcl::vec3 blackBodyColor(float temperature);
+
+
+// Vertex of a star point sprite
+struct StarVertex {
+    vcl::vec3 direction;
+    float magnitude;
+    unsigned char color[4];
+};
+
+// Stars drawn as points at infinity, after the opaque geometry and only where the depth buffer is still clear
+class Starfield {
+public:
+    Starfield() {}
+    explicit Starfield(StarfieldSettings const& settings);
+    // New catalog in new buffers, the program is kept
+    void regenerate(StarfieldSettings const& settings);
+
+    template <typename SCENE>
+    void render(SCENE const& scene);
+
+    StarfieldSettings settings;
+    unsigned int count = 0;
+
+private:
+    gl_vertex_array vao;
+    gl_buffer vertices;
+    GLuint shader = 0;
+};
+
+template <typename SCENE>
+void Starfield::render(SCENE const& scene) {
+    if (count == 0)
+        return;
+    glUseProgram(shader);
+    vcl::mat4 const rotationView = vcl::inverse(vcl::frame(scene.camera.orientation(), { 0, 0, 0 })).matrix();
+    vcl::opengl_uniform(shader, "view", rotationView, false);
+    vcl::opengl_uniform(shader, "projection", scene.projection, false);
+    vcl::opengl_uniform(shader, "faintestMagnitude", settings.faintestMagnitude, false);
+
+    // The sky lies on the farthest depth, where nothing has been drawn yet
+    bool const reverseZ = scene.depth.mode == DepthMode::ReverseZ;
+    vcl::opengl_uniform(shader, "skyDepth", reverseZ ? 0.0f : 1.0f, false);
+    glDepthFunc(reverseZ ? GL_GEQUAL : GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    glBindVertexArray(vao.id()); opengl_check;
+    glDrawArrays(GL_POINTS, 0, GLsizei(count)); opengl_check;
+    glBindVertexArray(0);
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(reverseZ ? GL_GREATER : GL_LESS);
+}
@@ -0,0 +1,157 @@
+#include "system_pack.hpp"
+#include "planet_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static char const systemPackMagic[4] = { 'P', 'S', 'Y', 'S' };
+static uint32_t const systemPackVersion = 1;
+
+static void appendUint32(std::vector<unsigned char>& data, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        data.push_back((unsigned char)(value >> (8 * i)));
+}
+
+static uint32_t readUint32(unsigned char const* data) {
+    return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+}
+
+// Chunk data starts on 16 bytes from the start of the pack, so that a mapped bake keeps its alignment
+static void alignData(std::vector<unsigned char>& data) {
+    while (data.size() % 16 != 0)
+        data.push_back(0);
+}
+
+static void appendChunk(std::vector<unsigned char>& data, uint32_t tag, unsigned char const* bytes, size_t size) {
+    // The header ends where the data starts
+    while ((data.size() + 8) % 16 != 0)
+        data.push_back(0);
+    appendUint32(data, tag);
+    appendUint32(data, uint32_t(size));
+    data.insert(data.end(), bytes, bytes + size);
+}
+
+// Calls read(tag, data, size) for each chunk of [begin, end), false when a chunk overflows
+template <typename F>
+static bool forEachChunk(unsigned char const* base, size_t begin, size_t end, F const& read) {
+    size_t offset = begin;
+    while (true) {
+        while ((offset + 8) % 16 != 0)
+            offset++;
+        if (offset + 8 > end)
+            return true;
+        uint32_t const tag = readUint32(base + offset);
+        uint32_t const size = readUint32(base + offset + 4);
+        offset += 8;
+        if (offset + size > end)
+            return false;
+        if (!read(tag, base + offset, size_t(size)))
+            return false;
+        offset += size;
+    }
+}
+
+static void writeOrbit(PlanetOrbit const& orbit, std::vector<unsigned char>& data) {
+    appendFloats(data, GravitationalParameterField, &orbit.gravitationalParameter, 1);
+    appendInt(data, ParentField, orbit.parent);
+    appendFloats(data, DistanceField, &orbit.distance, 1);
+    appendFloats(data, PhaseField, &orbit.phase, 1);
+    appendBool(data, RandomPhaseField, orbit.randomPhase);
+    float const position[3] = { orbit.position.x, orbit.position.y, orbit.position.z };
+    appendFloats(data, PositionField, position, 3);
+    float const velocity[3] = { orbit.velocity.x, orbit.velocity.y, orbit.velocity.z };
+    appendFloats(data, VelocityField, velocity, 3);
+    appendInt(data, DivisionField, orbit.division);
+}
+
+static bool readOrbit(unsigned char const* data, size_t size, PlanetOrbit& orbit) {
+    return forEachField(data, size, [&orbit](uint16_t id, unsigned char const* value, uint16_t length) {
+        float v[3];
+        switch (id) {
+        case GravitationalParameterField: decodeFloats(value, length, &orbit.gravitationalParameter, 1); break;
+        case ParentField: decodeInt(value, length, orbit.parent); break;
+        case DistanceField: decodeFloats(value, length, &orbit.distance, 1); break;
+        case PhaseField: decodeFloats(value, length, &orbit.phase, 1); break;
+        case RandomPhaseField: decodeBool(value, length, orbit.randomPhase); break;
+        case PositionField: if (decodeFloats(value, length, v, 3)) orbit.position = { v[0], v[1], v[2] }; break;
+        case VelocityField: if (decodeFloats(value, length, v, 3)) orbit.velocity = { v[0], v[1], v[2] }; break;
+        case DivisionField: decodeInt(value, length, orbit.division); break;
+        default: break;
+        }
+    });
+}
+
+std::vector<unsigned char> writeSystemPack(std::vector<SystemPlanet> const& planets) {
+    // SystemPackHeader
+    std::vector<unsigned char> data(systemPackMagic, systemPackMagic + 4);
+    appendUint32(data, systemPackVersion);
+    appendUint32(data, uint32_t(planets.size()));
+    appendUint32(data, 0);
+
+    for (SystemPlanet const& planet : planets) {
+        // Built in place so that the bake keeps the alignment of the pack: the sub-chunks are aligned relatively
+        // to the start of the pack, the planet chunk size is patched once they are written
+        while ((data.size() + 8) % 16 != 0)
+            data.push_back(0);
+        appendUint32(data, PlanetChunk);
+        size_t const sizeOffset = data.size();
+        appendUint32(data, 0);
+        size_t const start = data.size();
+
+        appendChunk(data, NameChunk, reinterpret_cast<unsigned char const*>(planet.name.data()), planet.name.size());
+        std::vector<unsigned char> fields;
+        writePlanetFields(planet.parameters, fields);
+        appendChunk(data, FieldsChunk, fields.data(), fields.size());
+        if (planet.hasOrbit) {
+            std::vector<unsigned char> orbit;
+            writeOrbit(planet.orbit, orbit);
+            appendChunk(data, OrbitChunk, orbit.data(), orbit.size());
+        }
+        if (planet.bake != nullptr && planet.bakeSize > 0)
+            appendChunk(data, BakeChunk, planet.bake, planet.bakeSize);
+
+        uint32_t const size = uint32_t(data.size() - start);
+        for (int i = 0; i < 4; i++)
+            data[sizeOffset + i] = (unsigned char)(size >> (8 * i));
+    }
+    alignData(data);
+    return data;
+}
+
+bool isSystemPack(unsigned char const* data, size_t size) {
+    return data != nullptr && size >= sizeof(SystemPackHeader) && std::memcmp(data, systemPackMagic, 4) == 0;
+}
+
+bool parseSystemPack(unsigned char const* data, size_t size, std::vector<SystemPlanet>& planets) {
+    planets.clear();
+    if (!isSystemPack(data, size) || readUint32(data + 4) != systemPackVersion)
+        return false;
+    planets.reserve(std::min<size_t>(readUint32(data + 8), size / 16)); // Each planet takes at least one chunk header
+
+    return forEachChunk(data, sizeof(SystemPackHeader), size, [&](uint32_t tag, unsigned char const* chunk, size_t chunkSize) {
+        if (tag != PlanetChunk)
+            return true;
+        planets.emplace_back();
+        SystemPlanet& planet = planets.back();
+        planet.hasOrbit = false;
+        size_t const begin = size_t(chunk - data);
+        return forEachChunk(data, begin, begin + chunkSize, [&planet](uint32_t tag, unsigned char const* value, size_t valueSize) {
+            switch (tag) {
+            case NameChunk:
+                planet.name.assign(reinterpret_cast<char const*>(value), valueSize);
+                return true;
+            case FieldsChunk:
+                return readPlanetFields(value, valueSize, planet.parameters);
+            case OrbitChunk:
+                planet.hasOrbit = true;
+                return readOrbit(value, valueSize, planet.orbit);
+            case BakeChunk:
+                planet.bake = value;
+                planet.bakeSize = valueSize;
+                return true;
+            default:
+                return true;
+            }
+        });
+    });
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "planet_parameters.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// System pack: every planet of a system with its orbit and optionally its baked surface, loaded with a single
+// memory map. Planet files use the same layout with one planet and no orbit.
+//
+// Layout: SystemPackHeader, then chunks { uint32 tag, uint32 size } whose data starts on 16 bytes. A PlanetChunk
+// holds the chunks of one planet: its name, its fields (see planet_file.hpp), its orbit and its bake. Readers skip
+// the chunks and fields they do not know, every integer is little endian.
+
+struct SystemPackHeader {
+    char magic[4];
+    uint32_t version;     // Of the layout of the chunks, the fields have their own compatibility rules
+    uint32_t planetCount;
+    uint32_t reserved;
+};
+
+enum SystemChunkTag : uint32_t {
+    PlanetChunk = 1,
+    NameChunk = 2,
+    FieldsChunk = 3,
+    OrbitChunk = 4,
+    BakeChunk = 5 // A .pbake file, see planet_bake.hpp
+};
+
+enum OrbitFieldId : uint16_t {
+    GravitationalParameterField = 1,
+    ParentField = 2,
+    DistanceField = 3,
+    PhaseField = 4,
+    RandomPhaseField = 5,
+    PositionField = 6,
+    VelocityField = 7,
+    DivisionField = 8
+};
+
+struct PlanetOrbit {
+    float gravitationalParameter = 0.0f; // G times the mass
+    int parent = -1;          // Index of an earlier planet it orbits, -1 to start from position and velocity
+    float distance = 0.0f;    // To the parent
+    float phase = 0.0f;
+    bool randomPhase = false; // Drawn when the system is loaded instead of phase
+    vcl::vec3 position = { 0.0f, 0.0f, 0.0f }; // Without parent
+    vcl::vec3 velocity = { 0.0f, 0.0f, 0.0f }; // Added to the orbital velocity with a parent
+    int division = 200;       // Of the full resolution mesh
+};
+
+struct SystemPlanet {
+    std::string name;
+    PlanetParameters parameters;
+    bool hasOrbit = true;
+    PlanetOrbit orbit;
+
+    // Baked surface, pointing into the pack data once parsed. Empty when the planet is generated.
+    unsigned char const* bake = nullptr;
+    size_t bakeSize = 0;
+};
+
+std::vector<unsigned char> writeSystemPack(std::vector<SystemPlanet> const& planets);
+
+bool isSystemPack(unsigned char const* data, size_t size);
+// False when the data is not a pack of a known version or a chunk overflows it.
+// The bakes point into data, which has to outlive the planets.
+bool parseSystemPack(unsigned char const* data, size_t size, std::vector<SystemPlanet>& planets);
@@ -0,0 +1,67 @@
+#include "terrain.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vcl;
+
+static float smoothMax(float a, float b, float k) {
+    return std::log(std::exp(a * k) + std::exp(b * k)) / k;
+}
+
+static float blend(float noise, float blending) {
+    return std::atan(noise * blending) / pi + 0.5f;
+}
+
+// Combination of the three noises into the surface
+static vec3 surfacePosition(TerrainParameters const& terrain, vec3 const& posOnUnitSphere, float perlin_noise, float mask, float ridgeNoise) {
+    float moutainMask = blend(mask + terrain.maskShift, terrain.mountainsBlend);
+    float const ridges = ridgeNoise * moutainMask * terrain.mountainsBlend;
+
+    // Ocean bed
+    float oceanFloorShape = -terrain.oceanFloorDepth + perlin_noise * 0.15f;
+    float continentShape = smoothMax(perlin_noise, oceanFloorShape, terrain.oceanFloorSmoothing);
+    continentShape *= (continentShape < 0) ? 1 + terrain.oceanDepthMultiplier : 1;
+
+    return terrain.radius * posOnUnitSphere * (1 + (ridges + continentShape) * 0.03f);
+}
+
+vec3 terrainPosition(TerrainParameters const& terrain, vec3 const& posOnUnitSphere) {
+    // Continent (simple perlin noise)
+    float const perlin_noise = perlinNoise(posOnUnitSphere, terrain.continentParameters);
+    // Moutains
+    float const mask = perlinNoise(posOnUnitSphere, terrain.maskParameters);
+    float const ridges = ridgeNoise(posOnUnitSphere, terrain.mountainsParameters, terrain.mountainSharpness);
+    return surfacePosition(terrain, posOnUnitSphere, perlin_noise, mask, ridges);
+}
+
+void terrainPositions(TerrainParameters const& terrain, vec3 const* directions, vec3* positions, size_t count) {
+    size_t const block = 1024;
+    float continents[block];
+    float masks[block];
+    float ridges[block];
+    for (size_t first = 0; first < count; first += block) {
+        size_t const size = std::min(block, count - first);
+        perlinNoise(directions + first, continents, size, terrain.continentParameters);
+        perlinNoise(directions + first, masks, size, terrain.maskParameters);
+        ridgeNoise(directions + first, ridges, size, terrain.mountainsParameters, terrain.mountainSharpness);
+        for (size_t i = 0; i < size; i++)
+            positions[first + i] = surfacePosition(terrain, directions[first + i], continents[i], masks[i], ridges[i]);
+    }
+}
+
+float terrainSlope(TerrainParameters const& terrain, vec3 const& posOnUnitSphere, float height) {
+    float stepSize = 0.02f;
+    // Any tangent works, the poles take another axis than z
+    vec3 direction;
+    if (std::abs(posOnUnitSphere.z) < 1.0f - 0.00001f)
+        direction = normalize(cross(posOnUnitSphere, vec3(0.0f, 0.0f, 1.0f)));
+    else
+        direction = normalize(cross(posOnUnitSphere, vec3(1.0f, 0.0f, 0.0f)));
+
+    float slopeEstimate = std::abs(norm(terrainPosition(terrain, normalize(posOnUnitSphere + stepSize * direction))) - height) / stepSize;
+    direction = cross(posOnUnitSphere, direction);
+    slopeEstimate = std::max(slopeEstimate, std::abs(norm(terrainPosition(terrain, normalize(posOnUnitSphere + stepSize * direction))) - height) / stepSize);
+    return std::min(slopeEstimate / (terrain.maxSlope * terrain.radius), 1.0f);
+}
+
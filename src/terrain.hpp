@@ -0,0 +1,36 @@
+#pragma once
+
+#include "noises.hpp"
+
+// Shape of the surface of a planet, the part of its parameters the terrain depends on.
+// Needs neither OpenGL nor a Planet, so the surface can also be evaluated by the tools.
+struct TerrainParameters {
+    float radius = 1.0f;
+
+    // Continent
+    perlin_noise_parameters continentParameters;
+
+    // Mountains
+    perlin_noise_parameters mountainsParameters;
+    perlin_noise_parameters maskParameters;
+    float mountainSharpness = 1.0f;
+    float mountainsBlend = 1.0f;
+    float maskShift = 0.0f;
+
+    // Oceans
+    float oceanFloorDepth = 0.5f;
+    float oceanFloorSmoothing = 1.0f;
+    float oceanDepthMultiplier = 2.0f;
+
+    // Coloring
+    float maxSlope = 0.3f; // Slope, relative to the radius, from which the steep color is used
+};
+
+// Point of the surface above a direction of the unit sphere
+vcl::vec3 terrainPosition(TerrainParameters const& terrain, vcl::vec3 const& posOnUnitSphere);
+// Same positions for count directions, with the batched noises
+void terrainPositions(TerrainParameters const& terrain, vcl::vec3 const* directions, vcl::vec3* positions, size_t count);
+
+// Steepness around a point of the surface from two nearby samples, 0 when flat and 1 from maxSlope.
+// height is the norm of the position above posOnUnitSphere.
+float terrainSlope(TerrainParameters const& terrain, vcl::vec3 const& posOnUnitSphere, float height);
@@ -0,0 +1,43 @@
+#include "asset_manager.hpp"
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace planet_test
+{
+
+	void test_asset_manager()
+	{
+		// Small image written next to the executable
+		std::string const path = "test_asset_manager.png";
+		vcl::buffer<unsigned char> pixels;
+		for (int i = 0; i < 4 * 4 * 4; i++)
+			pixels.push_back((unsigned char)(i * 3));
+		vcl::image_save_png(path, vcl::image_raw(4, 4, vcl::image_color_type::rgba, pixels));
+
+		AssetManager manager;
+		manager.prefetch({ path, path });
+
+		// Users on several threads share a single decode
+		std::vector<AssetManager::Image> images(8);
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < images.size(); i++)
+			threads.push_back(std::thread([&manager, &images, &path, i]() { images[i] = manager.image(path); }));
+		for (std::thread& thread : threads)
+			thread.join();
+
+		for (AssetManager::Image const& image : images)
+			assert_vcl_no_msg(image == images[0]);
+		assert_vcl_no_msg(images[0]->width == 4 && images[0]->height == 4);
+		assert_vcl_no_msg(images[0]->data.size() == pixels.size());
+		assert_vcl_no_msg(images[0]->data[5] == pixels[5]);
+
+		AssetStats const stats = manager.stats();
+		assert_vcl_no_msg(stats.decodes == 1);
+		assert_vcl_no_msg(stats.imageRequests == 8);
+		assert_vcl_no_msg(stats.textureUploads == 0);
+
+		std::remove(path.c_str());
+	}
+}
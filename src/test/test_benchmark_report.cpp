@@ -0,0 +1,79 @@
+#include "benchmark_report.hpp"
+#include "vcl/vcl.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace planet_test
+{
+
+	void test_benchmark_report()
+	{
+		BenchmarkReport report;
+		report.suite = "noise";
+		report.threads = 8;
+		BenchmarkResult throughput;
+		throughput.name = "perlinNoise/octaves=6/batch/threads=1";
+		throughput.value = 1.25e6;
+		throughput.unit = "samples/s";
+		BenchmarkResult duration;
+		duration.name = "generate \"Gwen\"";
+		duration.value = 350.5;
+		duration.unit = "ms";
+		duration.lowerIsBetter = true;
+		report.results = { throughput, duration };
+
+		// Round trip, names with quotes included
+		BenchmarkReport parsed;
+		assert_vcl_no_msg(parseBenchmarkJson(benchmarkJson(report), parsed));
+		assert_vcl_no_msg(parsed.suite == "noise" && parsed.threads == 8 && parsed.results.size() == 2);
+		assert_vcl_no_msg(parsed.results[0].name == throughput.name && parsed.results[0].value == 1.25e6 && !parsed.results[0].lowerIsBetter);
+		assert_vcl_no_msg(parsed.results[1].name == duration.name && parsed.results[1].unit == "ms" && parsed.results[1].lowerIsBetter);
+		assert_vcl_no_msg(!parseBenchmarkJson("not a report", parsed));
+
+		// Slower throughput and longer duration are both regressions
+		BenchmarkReport current = report;
+		current.results[0].value = 1.0e6;  // -20%
+		current.results[1].value = 360.0;  // 2.7% longer
+		BenchmarkResult added;
+		added.name = "new";
+		added.value = 1.0;
+		current.results.push_back(added);
+		std::vector<BenchmarkChange> const changes = compareBenchmarks(report, current, 0.05);
+		assert_vcl_no_msg(changes.size() == 2);
+		assert_vcl_no_msg(changes[0].regression && std::abs(changes[0].improvement + 0.2) < 1e-9);
+		assert_vcl_no_msg(!changes[1].regression && changes[1].improvement < 0.0);
+		assert_vcl_no_msg(compareBenchmarks(report, current, 0.01)[1].regression);
+
+		current.results[1].value = 300.0;
+		assert_vcl_no_msg(compareBenchmarks(report, current, 0.05)[1].improvement > 0.0);
+
+		// Every shipped planet, the scene file left out
+		std::vector<std::string> const planets = planetFilesIn("planets");
+		assert_vcl_no_msg(std::is_sorted(planets.begin(), planets.end()));
+		assert_vcl_no_msg(std::find(planets.begin(), planets.end(), "planets/Gwen.pbf") != planets.end());
+		assert_vcl_no_msg(std::find(planets.begin(), planets.end(), "planets/example.pbf") != planets.end());
+		assert_vcl_no_msg(std::find(planets.begin(), planets.end(), "planets/solar_system.scene") == planets.end());
+		assert_vcl_no_msg(planetFilesIn("planets/missing").empty());
+
+		// Shared options, then the ones of the tool
+		int minTime = 0;
+		BenchmarkOption const option = [&minTime](int argc, char** argv, int& i) {
+			if (std::string(argv[i]) != "--min-time" || i + 1 >= argc)
+				return false;
+			minTime = std::atoi(argv[++i]);
+			return true;
+		};
+		char* arguments[] = { (char*)"bench", (char*)"--out", (char*)"out.json", (char*)"--min-time", (char*)"2", (char*)"a/Gwen.pbf" };
+		BenchmarkCommandLine commandLine;
+		assert_vcl_no_msg(parseBenchmarkCommandLine(6, arguments, "[--min-time seconds]", option, commandLine));
+		assert_vcl_no_msg(commandLine.output == "out.json" && minTime == 2);
+		assert_vcl_no_msg(commandLine.planets.size() == 1 && commandLine.planets[0] == "a/Gwen.pbf");
+		commandLine = BenchmarkCommandLine();
+		assert_vcl_no_msg(parseBenchmarkCommandLine(1, arguments, "[--min-time seconds]", option, commandLine));
+		assert_vcl_no_msg(commandLine.planets == planets);
+		char* unknown[] = { (char*)"bench", (char*)"--unknown" };
+		assert_vcl_no_msg(!parseBenchmarkCommandLine(2, unknown, "[--min-time seconds]", option, commandLine) && commandLine.exitCode == 1);
+	}
+
+}
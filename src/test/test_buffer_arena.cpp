@@ -0,0 +1,84 @@
+#include "buffer_arena.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace planet_test
+{
+
+	void test_buffer_arena()
+	{
+		{
+			// Consecutive allocations are packed from the start
+			RangeAllocator allocator(100);
+			size_t const a = allocator.allocate(10);
+			size_t const b = allocator.allocate(20);
+			size_t const c = allocator.allocate(30);
+			assert_vcl_no_msg(a == 0 && b == 10 && c == 30);
+
+			ArenaStats stats = allocator.stats();
+			assert_vcl_no_msg(stats.capacity == 100 && stats.used == 60 && stats.allocations == 3);
+			assert_vcl_no_msg(stats.freeRanges == 1 && stats.largestFreeRange == 40);
+			assert_vcl_no_msg(stats.fragmentation() == 0.0f);
+
+			// Not enough room left
+			assert_vcl_no_msg(allocator.allocate(41) == RangeAllocator::invalid);
+
+			// A hole is reused by the first allocation fitting in it
+			allocator.release(b);
+			stats = allocator.stats();
+			assert_vcl_no_msg(stats.freeRanges == 2 && stats.used == 40);
+			assert_vcl_no_msg(std::abs(stats.fragmentation() - 1.0f / 3.0f) < 1e-6f);
+			assert_vcl_no_msg(allocator.allocate(15) == 10);
+			assert_vcl_no_msg(allocator.allocate(10) == 60);
+
+			// Released neighbours merge back into a single range
+			allocator.release(0);
+			allocator.release(10);
+			allocator.release(30);
+			allocator.release(60);
+			stats = allocator.stats();
+			assert_vcl_no_msg(stats.used == 0 && stats.allocations == 0);
+			assert_vcl_no_msg(stats.freeRanges == 1 && stats.largestFreeRange == 100);
+		}
+
+		{
+			// Growing extends the free range at the end
+			RangeAllocator allocator(16);
+			assert_vcl_no_msg(allocator.allocate(8) == 0);
+			assert_vcl_no_msg(allocator.allocate(16) == RangeAllocator::invalid);
+			allocator.grow(32);
+			assert_vcl_no_msg(allocator.allocate(16) == 8);
+			ArenaStats const stats = allocator.stats();
+			assert_vcl_no_msg(stats.capacity == 32 && stats.freeRanges == 1 && stats.largestFreeRange == 8);
+
+			// A full allocator has no fragmentation
+			assert_vcl_no_msg(allocator.allocate(8) == 24);
+			assert_vcl_no_msg(allocator.stats().fragmentation() == 0.0f);
+		}
+
+		{
+			// Interleaved allocations and releases keep the ranges disjoint and the accounting exact
+			RangeAllocator allocator(1000);
+			std::vector<size_t> offsets;
+			std::vector<size_t> sizes;
+			for (size_t i = 0; i < 40; i++) {
+				size_t const size = 1 + (i * 7) % 23;
+				offsets.push_back(allocator.allocate(size));
+				sizes.push_back(size);
+			}
+			for (size_t i = 0; i < offsets.size(); i += 2)
+				allocator.release(offsets[i]);
+
+			size_t used = 0;
+			for (size_t i = 1; i < offsets.size(); i += 2) {
+				used += sizes[i];
+				for (size_t j = i + 2; j < offsets.size(); j += 2)
+					assert_vcl_no_msg(offsets[i] + sizes[i] <= offsets[j] || offsets[j] + sizes[j] <= offsets[i]);
+			}
+			ArenaStats const stats = allocator.stats();
+			assert_vcl_no_msg(stats.used == used && stats.allocations == offsets.size() / 2);
+			assert_vcl_no_msg(stats.fragmentation() > 0.0f && stats.fragmentation() < 1.0f);
+		}
+	}
+}
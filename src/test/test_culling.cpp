@@ -0,0 +1,53 @@
+#include "culling.hpp"
+#include "depth.hpp"
+
+#include <cmath>
+
+namespace planet_test
+{
+
+	void test_culling()
+	{
+		float const fov = 3.14159f / 3;
+		float const aspect = 1.25f;
+
+		{
+			// Reverse-Z camera at the origin looking towards -z
+			DepthSettings depth;
+			Frustum const frustum = extractFrustum(projectionForDepth(depth, fov, aspect), true);
+
+			assert_vcl_no_msg(sphereInFrustum(frustum, { 0, 0, -100 }, 1.0f));
+			assert_vcl_no_msg(!sphereInFrustum(frustum, { 0, 0, 100 }, 1.0f));  // Behind the camera
+			assert_vcl_no_msg(!sphereInFrustum(frustum, { 500, 0, -100 }, 1.0f)); // Outside of the field of view
+			assert_vcl_no_msg(sphereInFrustum(frustum, { 0, 0, 100 }, 150.0f)); // The camera is inside
+
+			// No far plane
+			assert_vcl_no_msg(sphereInFrustum(frustum, { 0, 0, -1e8f }, 1.0f));
+
+			// A sphere slightly outside of a side plane is kept while its radius reaches the frustum
+			float const halfWidth = 100.0f * std::tan(fov / 2) * aspect;
+			assert_vcl_no_msg(sphereInFrustum(frustum, { halfWidth + 5.0f, 0, -100 }, 10.0f));
+			assert_vcl_no_msg(!sphereInFrustum(frustum, { halfWidth + 20.0f, 0, -100 }, 10.0f));
+
+			// Closer than the near plane
+			assert_vcl_no_msg(!sphereInFrustum(frustum, { 0, 0, -0.01f }, 0.01f));
+		}
+
+		{
+			// Standard depth range, with the view matrix of a moved camera
+			DepthSettings depth;
+			depth.mode = DepthMode::Logarithmic;
+			depth.farPlane = 1000.0f;
+			vcl::mat4 view = vcl::mat4::identity();
+			view(0, 3) = -50.0f; // Camera at x = 50
+			Frustum const frustum = extractFrustum(projectionForDepth(depth, fov, aspect) * view, false);
+
+			assert_vcl_no_msg(sphereInFrustum(frustum, { 50, 0, -100 }, 1.0f));
+			assert_vcl_no_msg(!sphereInFrustum(frustum, { -100, 0, -100 }, 1.0f));
+			assert_vcl_no_msg(!sphereInFrustum(frustum, { 50, 0, -2000 }, 1.0f)); // Beyond the far plane
+
+			// Planes are normalized: the distance is in world units
+			assert_vcl_no_msg(std::abs(frustum.planes[4].distance({ 50, 0, -10.1f }) - 10.0f) < 1e-3f);
+		}
+	}
+}
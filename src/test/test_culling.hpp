@@ -0,0 +1,7 @@
+#pragma once
+
+
+namespace planet_test
+{
+	void test_culling();
+}
@@ -0,0 +1,55 @@
+#include "depth.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace planet_test
+{
+
+	static bool close(float a, float b, float relative)
+	{
+		return std::abs(a - b) <= relative * std::max(std::abs(a), std::abs(b));
+	}
+
+	void test_depth()
+	{
+		{
+			// Reverse-Z: 1 at the near plane, decreasing towards 0 at infinity
+			DepthSettings depth;
+			assert_vcl_no_msg(close(windowDepth(depth, depth.nearPlane), 1.0f, 1e-6f));
+			assert_vcl_no_msg(windowDepth(depth, 10.0f) > windowDepth(depth, 100.0f));
+			assert_vcl_no_msg(windowDepth(depth, 1e9f) > 0.0f);
+
+			// The projection gives the same depth as the formula
+			vcl::mat4 const projection = projectionForDepth(depth, 3.14159f / 3, 1.25f);
+			vcl::vec4 const clip = projection * vcl::vec4(0.0f, 0.0f, -250.0f, 1.0f);
+			assert_vcl_no_msg(close(clip.z / clip.w, windowDepth(depth, 250.0f), 1e-5f));
+			assert_vcl_no_msg(logDepthCoefficient(depth) == 0.0f);
+		}
+
+		{
+			// Distances from the ground under the player to the farthest planet are recovered from a float depth
+			DepthSettings depth;
+			float const distances[] = { 0.5f, 3.0f, 30.0f, 2000.0f, 9000.0f };
+			for (float const distance : distances)
+				assert_vcl_no_msg(close(linearizeDepth(depth, windowDepth(depth, distance)), distance, 1e-4f));
+
+			// No geometry: the depth buffer is cleared to 0 and reads as the far distance
+			assert_vcl_no_msg(linearizeDepth(depth, 0.0f) == depth.farPlane);
+		}
+
+		{
+			// Logarithmic fallback
+			DepthSettings depth;
+			depth.mode = DepthMode::Logarithmic;
+			assert_vcl_no_msg(logDepthCoefficient(depth) > 0.0f);
+			assert_vcl_no_msg(windowDepth(depth, 0.0f) == 0.0f);
+			assert_vcl_no_msg(close(windowDepth(depth, depth.farPlane), 1.0f, 1e-5f));
+			assert_vcl_no_msg(windowDepth(depth, 10.0f) < windowDepth(depth, 100.0f));
+
+			float const distances[] = { 0.5f, 30.0f, 2000.0f, 9000.0f };
+			for (float const distance : distances)
+				assert_vcl_no_msg(close(linearizeDepth(depth, windowDepth(depth, distance)), distance, 1e-3f));
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#include "gl_object.hpp"
+#include "planet.hpp"
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace planet_test
+{
+	// Stands for a GL object without a context: counts the creations and the deletions
+	struct fake_traits {
+		static GLuint next;
+		static int destroyed;
+		static GLuint create() { return next++; }
+		static void destroy(GLuint) { destroyed++; }
+	};
+	GLuint fake_traits::next = 1;
+	int fake_traits::destroyed = 0;
+
+	using fake_object = gl_object<fake_traits>;
+
+	// The resources of a planet can only change owner
+	static_assert(!std::is_copy_constructible<Planet>::value, "Planet must not be copyable");
+	static_assert(!std::is_copy_assignable<Planet>::value, "Planet must not be copyable");
+	static_assert(std::is_move_constructible<Planet>::value, "Planet must be movable");
+	static_assert(!std::is_copy_constructible<planet_mesh_drawable>::value, "planet_mesh_drawable must not be copyable");
+	static_assert(std::is_move_constructible<planet_mesh_drawable>::value, "planet_mesh_drawable must be movable");
+	static_assert(!std::is_copy_constructible<IcosphereTopology>::value, "IcosphereTopology must not be copyable");
+
+	void test_gl_object()
+	{
+		{
+			fake_object const empty;
+			assert_vcl_no_msg(!empty);
+			assert_vcl_no_msg(fake_object::live() == 0);
+		}
+		assert_vcl_no_msg(fake_traits::destroyed == 0); // Nothing to delete
+
+		{
+			// Deleted once with its last owner
+			fake_object a = fake_object::create();
+			GLuint const id = a.id();
+			assert_vcl_no_msg(a && fake_object::live() == 1);
+
+			fake_object b = std::move(a);
+			assert_vcl_no_msg(!a && b.id() == id);
+			assert_vcl_no_msg(fake_object::live() == 1);
+
+			fake_object c;
+			c = std::move(b);
+			assert_vcl_no_msg(!b && c.id() == id);
+			assert_vcl_no_msg(fake_traits::destroyed == 0);
+		}
+		assert_vcl_no_msg(fake_traits::destroyed == 1);
+		assert_vcl_no_msg(fake_object::live() == 0);
+
+		{
+			// Assigning over an object deletes the previous one
+			fake_object a = fake_object::create();
+			fake_object b = fake_object::create();
+			a = std::move(b);
+			assert_vcl_no_msg(fake_traits::destroyed == 2);
+			assert_vcl_no_msg(fake_object::live() == 1);
+			a.reset();
+			assert_vcl_no_msg(fake_traits::destroyed == 3);
+			assert_vcl_no_msg(fake_object::live() == 0);
+		}
+
+		{
+			// Growing a vector moves its elements without deleting them
+			std::vector<fake_object> objects;
+			for (int i = 0; i < 100; i++)
+				objects.push_back(fake_object::create());
+			assert_vcl_no_msg(fake_object::live() == 100);
+			assert_vcl_no_msg(fake_traits::destroyed == 3);
+			objects.erase(objects.begin(), objects.begin() + 40);
+			assert_vcl_no_msg(fake_object::live() == 60);
+			assert_vcl_no_msg(fake_traits::destroyed == 43);
+		}
+		assert_vcl_no_msg(fake_object::live() == 0);
+		assert_vcl_no_msg(fake_traits::destroyed == 103);
+	}
+}
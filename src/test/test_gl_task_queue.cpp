@@ -0,0 +1,83 @@
+#include "gl_task_queue.hpp"
+#include "vcl/vcl.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace planet_test
+{
+
+	void test_gl_task_queue()
+	{
+		{
+			// Higher priorities first, then in the order of posting
+			GLTaskQueue queue;
+			queue.budget = 1000.0f;
+			std::string order;
+			queue.post([&order]() { order += 'a'; return size_t(0); }, 0);
+			queue.post([&order]() { order += 'b'; return size_t(0); }, 2);
+			queue.post([&order]() { order += 'c'; return size_t(0); }, 0);
+			queue.post([&order]() { order += 'd'; return size_t(0); }, 2);
+			assert_vcl_no_msg(queue.stats().depth == 4);
+			queue.drain();
+			assert_vcl_no_msg(order == "bdac");
+			assert_vcl_no_msg(queue.stats().depth == 0);
+			assert_vcl_no_msg(queue.stats().slices == 4);
+		}
+
+		{
+			// A split upload keeps its place and reports its backlog until done
+			GLTaskQueue queue;
+			queue.budget = 1000.0f;
+			size_t left = 300;
+			std::string order;
+			queue.post([&]() { order += 'u'; left -= 100; return left; }, 1, left);
+			queue.post([&order]() { order += 'l'; return size_t(0); }, 0);
+			assert_vcl_no_msg(queue.stats().backlog == 300);
+			queue.drain();
+			assert_vcl_no_msg(order == "uuul");
+			assert_vcl_no_msg(queue.stats().backlog == 0);
+		}
+
+		{
+			// The budget stops the drain, at least one slice runs per frame
+			GLTaskQueue queue;
+			queue.budget = 0.0f;
+			int calls = 0;
+			queue.post([&calls]() { calls++; return size_t(calls < 3 ? 10 : 0); }, 0, 30);
+			queue.drain();
+			assert_vcl_no_msg(calls == 1);
+			GLTaskStats stats = queue.stats();
+			assert_vcl_no_msg(stats.depth == 1 && stats.backlog == 10 && stats.slices == 1);
+			queue.drain();
+			queue.drain();
+			assert_vcl_no_msg(calls == 3);
+			assert_vcl_no_msg(queue.stats().depth == 0);
+			queue.drain();
+			assert_vcl_no_msg(queue.stats().slices == 0);
+		}
+
+		{
+			// Posted from workers and from a running task
+			GLTaskQueue queue;
+			queue.budget = 1000.0f;
+			int count = 0;
+			std::vector<std::thread> workers;
+			for (int i = 0; i < 4; i++)
+				workers.emplace_back([&queue, &count]() {
+					for (int j = 0; j < 100; j++)
+						queue.post([&count]() { count++; return size_t(0); }, j % 3, 1);
+				});
+			for (std::thread& worker : workers)
+				worker.join();
+			assert_vcl_no_msg(queue.stats().depth == 400 && queue.stats().backlog == 400);
+			queue.post([&queue, &count]() {
+				queue.post([&count]() { count += 1000; return size_t(0); }, 5);
+				return size_t(0);
+			}, 10);
+			queue.drain();
+			assert_vcl_no_msg(count == 1400);
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#include "icosphere.hpp"
+
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace planet_test
+{
+
+	// Every edge of a closed mesh is shared by two triangles with opposite orientations
+	static bool closedAndOutward(vcl::buffer<vcl::uint3> const& connectivity, vcl::buffer<vcl::vec3> const& position)
+	{
+		std::map<std::pair<unsigned int, unsigned int>, int> edges;
+		for (vcl::uint3 const& face : connectivity) {
+			vcl::vec3 const& a = position[face[0]];
+			vcl::vec3 const& b = position[face[1]];
+			vcl::vec3 const& c = position[face[2]];
+			if (vcl::dot(vcl::cross(b - a, c - a), a + b + c) <= 0)
+				return false;
+			for (int k = 0; k < 3; k++)
+				edges[{ face[k], face[(k + 1) % 3] }]++;
+		}
+		for (auto const& edge : edges) {
+			if (edge.second != 1 || edges.count({ edge.first.second, edge.first.first }) == 0)
+				return false;
+		}
+		return true;
+	}
+
+	void test_icosphere()
+	{
+		{
+			// Rounding of the finest division so that the coarse level is nested
+			assert_vcl_no_msg(icosphere_lod_step(500, 100) == 5);
+			assert_vcl_no_msg(icosphere_nested_division(500, 5) == 499);
+			assert_vcl_no_msg(icosphere_lod_step(250, 100) == 2);
+			assert_vcl_no_msg(icosphere_nested_division(250, 2) == 251);
+			assert_vcl_no_msg(icosphere_lod_step(50, 100) == 1);
+			assert_vcl_no_msg(icosphere_nested_division(50, 1) == 50);
+		}
+
+		{
+			// Step 1 is the finest level itself
+			vcl::mesh const m = mesh_icosphere(1.0f, 11);
+			vcl::buffer<vcl::uint3> const lod = icosphere_lod_connectivity(11, 1);
+			assert_vcl_no_msg(m.position.size() == icosphere_vertex_count(11));
+			assert_vcl_no_msg(m.connectivity.size() == 2 * icosphere_vertex_count(11) - 4);
+			assert_vcl_no_msg(lod.size() == m.connectivity.size());
+			assert_vcl_no_msg(closedAndOutward(m.connectivity, m.position));
+			assert_vcl_no_msg(closedAndOutward(lod, m.position));
+		}
+
+		{
+			// Coarser level over the same vertices: a closed sphere with step^2 fewer triangles
+			unsigned int const division = 23;
+			unsigned int const step = 4;
+			vcl::mesh const m = mesh_icosphere(1.0f, division);
+			vcl::buffer<vcl::uint3> const lod = icosphere_lod_connectivity(division, step);
+			unsigned int const segments = (division + 1) / step;
+			assert_vcl_no_msg(lod.size() == 8 * segments * segments);
+			assert_vcl_no_msg(closedAndOutward(lod, m.position));
+
+			// It has the vertex count of the icosphere of that division, and the same vertex directions
+			std::map<unsigned int, int> used;
+			for (vcl::uint3 const& face : lod)
+				for (int k = 0; k < 3; k++)
+					used[face[k]]++;
+			vcl::mesh const coarse = mesh_icosphere(1.0f, segments - 1);
+			assert_vcl_no_msg(used.size() == coarse.position.size());
+			for (vcl::vec3 const& p : coarse.position) {
+				bool found = false;
+				for (auto const& vertex : used)
+					found = found || vcl::norm(m.position[vertex.first] - p) < 1e-5f;
+				assert_vcl_no_msg(found);
+			}
+		}
+
+		{
+			// One shared topology per division, built once even when requested from several threads
+			std::vector<std::shared_ptr<IcosphereTopology const>> results(6);
+			std::vector<std::thread> threads;
+			for (size_t i = 0; i < results.size(); i++)
+				threads.push_back(std::thread([&results, i]() { results[i] = icosphere_topology(40, 10, 64); }));
+			for (std::thread& thread : threads)
+				thread.join();
+			for (auto const& topology : results)
+				assert_vcl_no_msg(topology.get() == results[0].get());
+
+			IcosphereTopology const& topology = *results[0];
+			assert_vcl_no_msg(topology.division == 39 && topology.lodStep == 4);
+			assert_vcl_no_msg(topology.directions.size() == mesh_icosphere(1.0f, 39).position.size());
+			assert_vcl_no_msg(closedAndOutward(topology.levels[0].connectivity, topology.directions));
+			assert_vcl_no_msg(closedAndOutward(topology.levels[1].connectivity, topology.directions));
+			for (IcosphereLevel const& level : topology.levels) {
+				unsigned int covered = 0;
+				for (MeshCluster const& cluster : level.clusters.clusters)
+					covered += cluster.triangleCount;
+				assert_vcl_no_msg(covered == level.connectivity.size());
+			}
+
+			// Released with its last user, then built again
+			std::weak_ptr<IcosphereTopology const> weak = results[0];
+			results.clear();
+			assert_vcl_no_msg(weak.expired());
+			assert_vcl_no_msg(icosphere_topology(40, 10, 64)->division == 39);
+
+			// The entries of the released divisions do not pile up
+			for (unsigned int division = 20; division < 30; division++)
+				icosphere_topology(division, 10, 64);
+			icosphere_topology(40, 10, 64);
+			assert_vcl_no_msg(icosphere_cached_topologies() == 1);
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#include "mesh_clusters.hpp"
+#include "icosphere.hpp"
+
+namespace planet_test
+{
+
+	void test_mesh_clusters()
+	{
+		vcl::mesh m = mesh_icosphere(1.0f, 60);
+		size_t const triangleCount = m.connectivity.size();
+		MeshClusters clusters = partitionIntoClusters(m.connectivity, m.position, 256);
+		updateClusterBounds(clusters, m.position, m.connectivity);
+
+		{
+			// The clusters cover every triangle exactly once
+			assert_vcl_no_msg(m.connectivity.size() == triangleCount);
+			unsigned int next = 0;
+			for (MeshCluster const& cluster : clusters.clusters) {
+				assert_vcl_no_msg(cluster.firstTriangle == next);
+				assert_vcl_no_msg(cluster.triangleCount > 0);
+				next += cluster.triangleCount;
+			}
+			assert_vcl_no_msg(next == triangleCount);
+			assert_vcl_no_msg(clusters.clusters.size() > 24);
+		}
+
+		{
+			// Bounds contain their triangles and the normal cones are narrow
+			for (MeshCluster const& cluster : clusters.clusters) {
+				for (unsigned int k = cluster.firstTriangle; k < cluster.firstTriangle + cluster.triangleCount; k++)
+					assert_vcl_no_msg(vcl::norm(m.position[m.connectivity[k][0]] - cluster.center) <= cluster.radius * 1.0001f);
+				assert_vcl_no_msg(cluster.coneAngle < 0.5f);
+			}
+			assert_vcl_no_msg(std::abs(clusters.occluderRadius - 1.0f) < 1e-4f);
+		}
+
+		{
+			// In orbit, about half of the sphere faces away
+			unsigned int const submitted = cullClusters(clusters, { 0, 0, 6 });
+			assert_vcl_no_msg(submitted > 0 && 2 * submitted < triangleCount * 1.2f);
+			assert_vcl_no_msg(clusters.counts.size() == clusters.offsets.size());
+			assert_vcl_no_msg(!clusters.counts.empty());
+		}
+
+		{
+			// On the ground, the horizon hides most of the planet
+			unsigned int const submitted = cullClusters(clusters, { 0, 0, 1.002f });
+			assert_vcl_no_msg(submitted > 0 && 4 * submitted < triangleCount);
+
+			// The clusters under the eye are kept
+			vcl::vec3 const eye = { 0, 0, 1.002f };
+			for (MeshCluster const& cluster : clusters.clusters) {
+				if (vcl::norm(cluster.center - eye) < cluster.radius + 0.01f)
+					assert_vcl_no_msg(!clusterBackFacing(cluster, eye) && !clusterBeyondHorizon(cluster, eye, clusters.occluderRadius));
+			}
+		}
+
+		{
+			// A cluster containing the eye is never culled
+			MeshCluster cluster;
+			cluster.center = { 0, 0, 1 };
+			cluster.radius = 0.1f;
+			cluster.coneAxis = { 0, 0, 1 };
+			assert_vcl_no_msg(!clusterBackFacing(cluster, { 0, 0, 1.05f }));
+			assert_vcl_no_msg(clusterBackFacing(cluster, { 0, 0, -5.0f }));
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#include "planet_bake.hpp"
+#include "planet_file.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+namespace planet_test
+{
+
+	void test_planet_bake()
+	{
+		TerrainParameters terrain;
+		assert_vcl_no_msg(readTerrainParameters("planets/Gwen.pbf", terrain));
+		std::shared_ptr<IcosphereTopology const> const topology = icosphere_topology(20, 10, 64);
+
+		// The threaded generation gives the same surface as the stages run one after the other
+		PlanetBake bake;
+		initializeSurface(bake.surface, *topology);
+		generateSurface(terrain, *topology, bake.surface, 3);
+		PlanetSurface reference;
+		initializeSurface(reference, *topology);
+		displaceSurface(terrain, *topology, reference, 0, topology->directions.size());
+		colorSurfaceSlopes(terrain, *topology, reference, 0, topology->directions.size());
+		computeSurfaceNormals(*topology, reference);
+		updateSurfaceBounds(*topology, reference);
+		assert_vcl_no_msg(std::memcmp(bake.surface.positions.data.data(), reference.positions.data.data(), reference.positions.size() * sizeof(vcl::vec3)) == 0);
+		assert_vcl_no_msg(std::memcmp(bake.surface.slopes.data.data(), reference.slopes.data.data(), reference.slopes.size() * sizeof(float)) == 0);
+
+		// Anchors are deterministic and on gentle slopes
+		bake.anchors = vegetationAnchors(terrain, 50, 0.5f, 1);
+		bake.anchorRequest = 50;
+		assert_vcl_no_msg(bake.anchors.size() > 0 && bake.anchors.size() <= 50);
+		std::vector<vcl::vec3> const anchors = vegetationAnchors(terrain, 50, 0.5f, 1);
+		assert_vcl_no_msg(std::memcmp(anchors.data(), bake.anchors.data(), anchors.size() * sizeof(vcl::vec3)) == 0);
+		for (vcl::vec3 const& anchor : anchors)
+			assert_vcl_no_msg(terrainSlope(terrain, vcl::normalize(anchor), vcl::norm(anchor)) <= 0.5f + 1e-5f);
+
+		bake.heightfieldWidth = 8;
+		bake.heightfieldHeight = 4;
+		bake.heightfield = surfaceHeightfield(terrain, 8, 4);
+		assert_vcl_no_msg(bake.heightfield.size() == 32);
+
+		// Round trip
+		uint64_t const key = terrainBakeKey(terrain);
+		std::vector<unsigned char> const data = serializePlanetBake(bake, *topology, key);
+		PlanetBake loaded;
+		assert_vcl_no_msg(parsePlanetBake(data.data(), data.size(), *topology, key, loaded));
+		assert_vcl_no_msg(std::memcmp(loaded.surface.normals.data.data(), bake.surface.normals.data.data(), bake.surface.normals.size() * sizeof(vcl::vec3)) == 0);
+		assert_vcl_no_msg(loaded.surface.clusters.clusters.size() == bake.surface.clusters.clusters.size());
+		assert_vcl_no_msg(loaded.surface.clustersLowRes.occluderRadius == bake.surface.clustersLowRes.occluderRadius);
+		MeshCluster const& cluster = loaded.surface.clusters.clusters.back();
+		MeshCluster const& expected = bake.surface.clusters.clusters.back();
+		assert_vcl_no_msg(cluster.firstTriangle == expected.firstTriangle && cluster.radius == expected.radius && cluster.coneAngle == expected.coneAngle);
+		assert_vcl_no_msg(loaded.heightfield == bake.heightfield && loaded.heightfieldWidth == 8);
+		assert_vcl_no_msg(loaded.anchors.size() == bake.anchors.size() && loaded.anchorRequest == 50);
+
+		// Stale or damaged bakes are refused
+		TerrainParameters changed = terrain;
+		changed.maxSlope += 0.1f;
+		assert_vcl_no_msg(terrainBakeKey(changed) != key);
+		assert_vcl_no_msg(!parsePlanetBake(data.data(), data.size(), *topology, terrainBakeKey(changed), loaded));
+		assert_vcl_no_msg(!parsePlanetBake(data.data(), data.size() - 16, *topology, key, loaded));
+		std::shared_ptr<IcosphereTopology const> const other = icosphere_topology(30, 10, 64);
+		assert_vcl_no_msg(!parsePlanetBake(data.data(), data.size(), *other, key, loaded));
+
+		// Heightfield sizes whose byte size would wrap around
+		std::vector<unsigned char> corrupted = data;
+		uint32_t const huge[2] = { 1u << 31, 1u << 31 };
+		std::memcpy(corrupted.data() + offsetof(PlanetBakeHeader, heightfieldWidth), huge, sizeof(huge));
+		assert_vcl_no_msg(!parsePlanetBake(corrupted.data(), corrupted.size(), *topology, key, loaded));
+		uint32_t const large[2] = { 1u << 14, 1u << 14 };
+		std::memcpy(corrupted.data() + offsetof(PlanetBakeHeader, heightfieldWidth), large, sizeof(large));
+		assert_vcl_no_msg(!parsePlanetBake(corrupted.data(), corrupted.size(), *topology, key, loaded));
+
+		assert_vcl_no_msg(planetBakePath("bake", "Gwen", 500) == "bake/Gwen_500.pbake");
+	}
+
+}
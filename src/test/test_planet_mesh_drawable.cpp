@@ -0,0 +1,54 @@
+#include "planet_mesh_drawable.hpp"
+
+#include <cmath>
+
+namespace planet_test
+{
+
+	void test_planet_mesh_drawable()
+	{
+		{
+			// Octahedral normals in both hemispheres and on the axes
+			vcl::vec3 const normals[] = { {0,0,1}, {0,0,-1}, {1,0,0}, {0,-1,0}, vcl::normalize(vcl::vec3(1,2,3)), vcl::normalize(vcl::vec3(-3,1,-2)), vcl::normalize(vcl::vec3(0.2f,-0.1f,-5)) };
+			for (vcl::vec3 const& n : normals) {
+				vcl::vec2 const e = octahedralEncode(n);
+				assert_vcl_no_msg(std::abs(e.x) <= 1.0f && std::abs(e.y) <= 1.0f);
+				assert_vcl_no_msg(vcl::norm(octahedralDecode(e) - n) < 1e-5f);
+			}
+		}
+
+		{
+			// Packed vertex: 16 bit height and normal, 8 bit slope
+			vcl::vec2 const range = { 95.0f, 106.0f };
+			vcl::vec3 const position = 101.37f * vcl::normalize(vcl::vec3(0.3f, -0.4f, 0.8f));
+			vcl::vec3 const normal = vcl::normalize(vcl::vec3(-0.2f, 0.1f, -0.9f));
+			PlanetVertex const vertex = packPlanetVertex(position, normal, 0.6f, range);
+
+			assert_vcl_no_msg(std::abs(unpackHeight(vertex, range) - 101.37f) < 11.0f / 65535);
+			assert_vcl_no_msg(std::abs(vertex.slope / 255.0f - 0.6f) < 0.5f / 255);
+
+			vcl::vec3 const decoded = octahedralDecode(vcl::vec2(vertex.normal[0] / 32767.0f, vertex.normal[1] / 32767.0f));
+			assert_vcl_no_msg(vcl::dot(decoded, normal) > std::cos(0.001f));
+		}
+
+		{
+			// The height range covers the terrain, its extremes are exact
+			vcl::buffer<vcl::vec3> positions = { {0,0,98}, {99.5f,0,0}, {0,-103,0} };
+			vcl::vec2 const range = planetHeightRange(positions);
+			assert_vcl_no_msg(range.x == 98.0f && range.y == 103.0f);
+			assert_vcl_no_msg(unpackHeight(packPlanetVertex(positions[0], { 0,0,1 }, 0.0f, range), range) == 98.0f);
+			assert_vcl_no_msg(unpackHeight(packPlanetVertex(positions[2], { 0,0,1 }, 1.0f, range), range) == 103.0f);
+
+			// Packed in bulk off the main thread, the same vertices
+			vcl::buffer<vcl::vec3> const normals = { {0,0,1}, {1,0,0}, {0,-1,0} };
+			vcl::buffer<float> const slopes = { 0.0f, 0.5f, 1.0f };
+			std::vector<PlanetVertex> const packed = packPlanetVertices(positions, normals, slopes, range);
+			assert_vcl_no_msg(packed.size() == 3 && packed[1].slope == packPlanetVertex(positions[1], normals[1], 0.5f, range).slope);
+			assert_vcl_no_msg(packed[2].height == packPlanetVertex(positions[2], normals[2], 1.0f, range).height);
+
+			// Flat planet
+			vcl::vec2 const flat = { 1.0f, 1.0f };
+			assert_vcl_no_msg(unpackHeight(packPlanetVertex({ 1,0,0 }, { 1,0,0 }, 0.0f, flat), flat) == 1.0f);
+		}
+	}
+}
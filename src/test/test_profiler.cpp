@@ -0,0 +1,50 @@
+#include "profiler.hpp"
+
+namespace planet_test
+{
+
+	void test_profiler()
+	{
+		RollingSamples empty;
+		assert_vcl_no_msg(empty.size() == 0 && empty.average() == 0.0f && empty.percentile(0.99f) == 0.0f);
+
+		// Statistics over 1..100
+		RollingSamples samples(100);
+		for (int i = 1; i <= 100; i++)
+			samples.add(float(i));
+		assert_vcl_no_msg(samples.size() == 100);
+		assert_vcl_no_msg(samples.minimum() == 1.0f);
+		assert_vcl_no_msg(samples.average() == 50.5f);
+		assert_vcl_no_msg(samples.percentile(0.99f) == 99.0f);
+		assert_vcl_no_msg(samples.percentile(1.0f) == 100.0f);
+		assert_vcl_no_msg(samples.percentile(0.0f) == 1.0f);
+		assert_vcl_no_msg(samples.last() == 100.0f);
+
+		// The window keeps the last samples only
+		for (int i = 0; i < 50; i++)
+			samples.add(1000.0f);
+		assert_vcl_no_msg(samples.size() == 100);
+		assert_vcl_no_msg(samples.minimum() == 51.0f);
+		assert_vcl_no_msg(samples.last() == 1000.0f);
+		samples.add(2000.0f);
+		assert_vcl_no_msg(samples.last() == 2000.0f && samples.minimum() == 52.0f);
+
+		// One spike in a hundred frames shows in the p99 but barely in the average
+		RollingSamples frames(100);
+		for (int i = 0; i < 99; i++)
+			frames.add(10.0f);
+		frames.add(100.0f);
+		assert_vcl_no_msg(frames.percentile(0.99f) == 10.0f);
+		assert_vcl_no_msg(frames.percentile(1.0f) == 100.0f);
+		assert_vcl_no_msg(frames.average() < 11.0f);
+
+		ZoneStats zone;
+		zone.name = "Terrain";
+		zone.cpuSamples = 2;
+		zone.cpuAverage = 1.5f;
+		std::string const csv = profileCsv({ zone });
+		assert_vcl_no_msg(csv.find("zone,cpu_samples,") == 0);
+		assert_vcl_no_msg(csv.find("\nTerrain,2,0,1.5,0,0,0,0,0\n") != std::string::npos);
+	}
+
+}
@@ -0,0 +1,40 @@
+#include "program_cache.hpp"
+
+namespace planet_test
+{
+
+	void test_program_cache()
+	{
+		// The key changes with either source and with the driver
+		std::string const vertex = "#version 330 core\nvoid main() {}\n";
+		std::string const fragment = "#version 330 core\nout vec4 color;\nvoid main() { color = vec4(1.0); }\n";
+		uint64_t const key = programCacheKey(vertex, fragment, "Vendor|Renderer|4.6");
+		assert_vcl_no_msg(key == programCacheKey(vertex, fragment, "Vendor|Renderer|4.6"));
+		assert_vcl_no_msg(key != programCacheKey(vertex, fragment, "Vendor|Renderer|4.5"));
+		assert_vcl_no_msg(key != programCacheKey(vertex + " ", fragment, "Vendor|Renderer|4.6"));
+		assert_vcl_no_msg(key != programCacheKey(fragment, vertex, "Vendor|Renderer|4.6"));
+		assert_vcl_no_msg(programCacheKey("ab", "c", "") != programCacheKey("a", "bc", ""));
+
+		assert_vcl_no_msg(programCachePath("shader_cache", 0x0123456789abcdefull) == "shader_cache/0123456789abcdef.bin");
+
+		// Round trip of the file
+		std::vector<unsigned char> binary(1000);
+		for (size_t i = 0; i < binary.size(); i++)
+			binary[i] = static_cast<unsigned char>(i * 7);
+		std::vector<unsigned char> const data = packProgramBinary(key, 0x1234, binary);
+		GLenum format = 0;
+		std::vector<unsigned char> loaded;
+		assert_vcl_no_msg(unpackProgramBinary(data.data(), data.size(), key, format, loaded));
+		assert_vcl_no_msg(format == 0x1234 && loaded == binary);
+
+		// Another key, a truncated file or a corrupted header are misses
+		assert_vcl_no_msg(!unpackProgramBinary(data.data(), data.size(), key + 1, format, loaded));
+		assert_vcl_no_msg(!unpackProgramBinary(data.data(), data.size() - 1, key, format, loaded));
+		assert_vcl_no_msg(!unpackProgramBinary(data.data(), sizeof(ProgramBinaryHeader) - 1, key, format, loaded));
+		std::vector<unsigned char> corrupted = data;
+		corrupted[0] = 'X';
+		assert_vcl_no_msg(!unpackProgramBinary(corrupted.data(), corrupted.size(), key, format, loaded));
+		assert_vcl_no_msg(!unpackProgramBinary(nullptr, 0, key, format, loaded));
+	}
+
+}
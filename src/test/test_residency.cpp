@@ -0,0 +1,104 @@
+#include "residency.hpp"
+
+#include <cmath>
+
+namespace planet_test
+{
+
+	static ResidencyRequest planet(float x, Residency state, size_t fullBytes)
+	{
+		ResidencyRequest request;
+		request.center = { x, 0.0f, 0.0f };
+		request.radius = 100.0f;
+		request.state = state;
+		request.memory.cpu = state == Residency::Full ? 10 + fullBytes : 10;
+		request.fullMemory.cpu = fullBytes;
+		return request;
+	}
+
+	void test_residency()
+	{
+		using namespace vcl;
+		vec3 const origin = { 0.0f, 0.0f, 0.0f };
+		vec3 const still = { 0.0f, 0.0f, 0.0f };
+
+		{
+			// Distance to the surface, looking ahead along the velocity
+			assert_vcl_no_msg(std::abs(prefetchDistance(origin, still, { 1000.0f, 0.0f, 0.0f }, 100.0f, 3.0f) - 900.0f) < 1e-3f);
+			assert_vcl_no_msg(std::abs(prefetchDistance(origin, { 200.0f, 0.0f, 0.0f }, { 1000.0f, 0.0f, 0.0f }, 100.0f, 3.0f) - 300.0f) < 1e-3f);
+			// Moving away, or through the planet within the horizon
+			assert_vcl_no_msg(std::abs(prefetchDistance(origin, { -200.0f, 0.0f, 0.0f }, { 1000.0f, 0.0f, 0.0f }, 100.0f, 3.0f) - 900.0f) < 1e-3f);
+			assert_vcl_no_msg(prefetchDistance(origin, { 1000.0f, 0.0f, 0.0f }, { 1000.0f, 0.0f, 0.0f }, 100.0f, 3.0f) == 0.0f);
+		}
+
+		ResidencySettings settings;
+		settings.budget = 1000;
+		settings.refineDistance = 1000.0f;
+		settings.evictDistance = 2000.0f;
+		settings.maxLoads = 4;
+
+		{
+			// Nearest first within the budget, the far planets stay coarse
+			std::vector<ResidencyRequest> const planets = { planet(1500.0f, Residency::Coarse, 400), planet(500.0f, Residency::Coarse, 400),
+				planet(1000.0f, Residency::Coarse, 400), planet(5000.0f, Residency::Coarse, 100) };
+			std::vector<ResidencyAction> const actions = planResidency(planets, origin, still, settings);
+			assert_vcl_no_msg(actions[1] == ResidencyAction::Refine && actions[2] == ResidencyAction::Refine);
+			assert_vcl_no_msg(actions[0] == ResidencyAction::Keep && actions[3] == ResidencyAction::Keep);
+
+			// Approaching fast, the planet ahead is prefetched
+			std::vector<ResidencyAction> const ahead = planResidency({ planets[3] }, origin, { 2000.0f, 0.0f, 0.0f }, settings);
+			assert_vcl_no_msg(ahead[0] == ResidencyAction::Refine);
+		}
+
+		{
+			// The planet under the viewer, then the visible ones from the largest on screen, then the others
+			std::vector<ResidencyRequest> planets = { planet(1200.0f, Residency::Coarse, 100), planet(-600.0f, Residency::Coarse, 100),
+				planet(150.0f, Residency::Coarse, 100), planet(400.0f, Residency::Coarse, 100) };
+			planets[0].radius = 500.0f;
+			planets[1].visible = false;
+			planets[2].visible = false;
+			std::vector<float> distances;
+			for (ResidencyRequest const& p : planets)
+				distances.push_back(prefetchDistance(origin, still, p.center, p.radius, 0.0f));
+			std::vector<size_t> const order = refinementOrder(planets, origin, distances);
+			assert_vcl_no_msg(order[0] == 2 && order[1] == 0 && order[2] == 3 && order[3] == 1);
+
+			// One load at a time by default, the next one once it is resident
+			ResidencySettings single = settings;
+			single.maxLoads = 1;
+			std::vector<ResidencyAction> actions = planResidency(planets, origin, still, single);
+			assert_vcl_no_msg(actions[2] == ResidencyAction::Refine && actions[0] == ResidencyAction::Keep && actions[3] == ResidencyAction::Keep);
+			planets[2].state = Residency::Loading;
+			actions = planResidency(planets, origin, still, single);
+			assert_vcl_no_msg(actions[0] == ResidencyAction::Keep && actions[3] == ResidencyAction::Keep);
+			planets[2].state = Residency::Full;
+			actions = planResidency(planets, origin, still, single);
+			assert_vcl_no_msg(actions[0] == ResidencyAction::Refine && actions[3] == ResidencyAction::Keep);
+		}
+
+		{
+			// Left behind beyond the eviction distance only, to avoid reloading back and forth
+			std::vector<ResidencyRequest> const planets = { planet(1500.0f, Residency::Full, 400), planet(2500.0f, Residency::Full, 400),
+				planet(2500.0f, Residency::Loading, 100) };
+			std::vector<ResidencyAction> const actions = planResidency(planets, origin, still, settings);
+			assert_vcl_no_msg(actions[0] == ResidencyAction::Keep && actions[1] == ResidencyAction::Evict && actions[2] == ResidencyAction::Keep);
+		}
+
+		{
+			// A nearer planet takes the memory of a farther one
+			std::vector<ResidencyRequest> const planets = { planet(900.0f, Residency::Full, 600), planet(200.0f, Residency::Coarse, 600) };
+			std::vector<ResidencyAction> const actions = planResidency(planets, origin, still, settings);
+			assert_vcl_no_msg(actions[0] == ResidencyAction::Evict && actions[1] == ResidencyAction::Refine);
+
+			// Over budget, the farthest planets are released
+			settings.budget = 700;
+			std::vector<ResidencyRequest> const full = { planet(200.0f, Residency::Full, 400), planet(800.0f, Residency::Full, 400) };
+			std::vector<ResidencyAction> const released = planResidency(full, origin, still, settings);
+			assert_vcl_no_msg(released[0] == ResidencyAction::Keep && released[1] == ResidencyAction::Evict);
+
+			ResidencyStats const stats = summarizeResidency(full, settings);
+			assert_vcl_no_msg(stats.full == 2 && stats.loading == 0 && stats.memory.total() == 820 && stats.budget == 700);
+		}
+	}
+
+}
@@ -0,0 +1,65 @@
+#include "scattering.hpp"
+
+namespace planet_test
+{
+
+	void test_scattering()
+	{
+		{
+			// Resolution of the scattering target, rounded up
+			assert_vcl_no_msg(scatteringResolution(1280, ScatteringQuality::Full) == 1280);
+			assert_vcl_no_msg(scatteringResolution(1280, ScatteringQuality::Half) == 640);
+			assert_vcl_no_msg(scatteringResolution(1024, ScatteringQuality::Quarter) == 256);
+			assert_vcl_no_msg(scatteringResolution(1023, ScatteringQuality::Quarter) == 256);
+			assert_vcl_no_msg(scatteringResolution(1, ScatteringQuality::Quarter) == 1);
+		}
+
+		{
+			// Full resolution without accumulation keeps the single water pass
+			ScatteringSettings settings;
+			ScatteringPassPlan plan = planScatteringPass(settings, 1280, 1024, 15, 0);
+			assert_vcl_no_msg(!plan.separatePass);
+			assert_vcl_no_msg(!plan.temporal);
+			assert_vcl_no_msg(plan.sampleCount == 15);
+			assert_vcl_no_msg(plan.jitter == 0.0f && plan.historyWeight == 0.0f);
+		}
+
+		{
+			// Reduced resolution runs the scattering in its own pass
+			ScatteringSettings settings;
+			settings.quality = ScatteringQuality::Half;
+			ScatteringPassPlan plan = planScatteringPass(settings, 1280, 1024, 15, 3);
+			assert_vcl_no_msg(plan.separatePass);
+			assert_vcl_no_msg(plan.width == 640 && plan.height == 512);
+			assert_vcl_no_msg(plan.divisor == 2);
+			assert_vcl_no_msg(plan.sampleCount == 15);
+		}
+
+		{
+			// Temporal accumulation spreads the samples over the frames
+			ScatteringSettings settings;
+			settings.temporal = true;
+			settings.temporalFrames = 4;
+			float jitterSum = 0.0f;
+			for (unsigned int frame = 0; frame < 4; frame++) {
+				ScatteringPassPlan plan = planScatteringPass(settings, 1280, 1024, 15, frame);
+				assert_vcl_no_msg(plan.separatePass && plan.temporal);
+				assert_vcl_no_msg(plan.width == 1280);
+				assert_vcl_no_msg(plan.sampleCount == 4);
+				assert_vcl_no_msg(plan.jitter > 0.0f && plan.jitter < 1.0f);
+				assert_vcl_no_msg(std::abs(plan.historyWeight - 0.75f) < 1e-6f);
+				jitterSum += plan.jitter;
+			}
+			assert_vcl_no_msg(std::abs(jitterSum - 2.0f) < 1e-5f);
+			assert_vcl_no_msg(planScatteringPass(settings, 1280, 1024, 15, 5).jitter == planScatteringPass(settings, 1280, 1024, 15, 1).jitter);
+
+			// Never less than two samples per frame
+			assert_vcl_no_msg(planScatteringPass(settings, 1280, 1024, 3, 0).sampleCount == 2);
+
+			// A single frame cannot accumulate anything
+			settings.temporalFrames = 1;
+			assert_vcl_no_msg(!planScatteringPass(settings, 1280, 1024, 15, 0).separatePass);
+		}
+	}
+
+}
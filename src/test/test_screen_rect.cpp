@@ -0,0 +1,64 @@
+#include "screen_rect.hpp"
+
+namespace planet_test
+{
+
+	void test_screen_rect()
+	{
+		float const nearPlane = 0.1f;
+		vcl::mat4 const projection = vcl::projection_perspective(vcl::pi / 3, 1280 / 1024.0f, nearPlane, 1000.0f);
+
+		{
+			// Centered sphere: symmetric rectangle around the middle of the screen
+			ScreenRect rect = projectedSphereRect({ 0, 0, -100 }, 10, projection, nearPlane, 1280, 1024);
+			assert_vcl_no_msg(rect.visible);
+			assert_vcl_no_msg(std::abs(rect.x + rect.width / 2 - 640) <= 1);
+			assert_vcl_no_msg(std::abs(rect.y + rect.height / 2 - 512) <= 1);
+			assert_vcl_no_msg(rect.width < 1280 && rect.height < 1024);
+		}
+
+		{
+			// Further away is smaller
+			ScreenRect close = projectedSphereRect({ 0, 0, -100 }, 10, projection, nearPlane, 1280, 1024);
+			ScreenRect far = projectedSphereRect({ 0, 0, -400 }, 10, projection, nearPlane, 1280, 1024);
+			assert_vcl_no_msg(far.visible);
+			assert_vcl_no_msg(far.width < close.width && far.height < close.height);
+		}
+
+		{
+			// Behind the camera, outside of the field of view, or sub-pixel
+			assert_vcl_no_msg(!projectedSphereRect({ 0, 0, 100 }, 10, projection, nearPlane, 1280, 1024).visible);
+			assert_vcl_no_msg(!projectedSphereRect({ 500, 0, -100 }, 10, projection, nearPlane, 1280, 1024).visible);
+			assert_vcl_no_msg(!projectedSphereRect({ 0, -500, -100 }, 10, projection, nearPlane, 1280, 1024).visible);
+			assert_vcl_no_msg(!projectedSphereRect({ 0, 0, -100000 }, 1, projection, nearPlane, 1280, 1024).visible);
+		}
+
+		{
+			// Camera inside or sphere crossing the near plane: whole screen
+			ScreenRect inside = projectedSphereRect({ 1, 2, -3 }, 10, projection, nearPlane, 1280, 1024);
+			assert_vcl_no_msg(inside.visible && inside.x == 0 && inside.y == 0 && inside.width == 1280 && inside.height == 1024);
+			ScreenRect crossing = projectedSphereRect({ 0, 0, -5 }, 5.05f, projection, nearPlane, 1280, 1024);
+			assert_vcl_no_msg(crossing.visible && crossing.width == 1280);
+		}
+
+		{
+			// Partially visible sphere is clamped to the screen
+			ScreenRect rect = projectedSphereRect({ 60, 0, -100 }, 10, projection, nearPlane, 1280, 1024);
+			assert_vcl_no_msg(rect.visible);
+			assert_vcl_no_msg(rect.x + rect.width == 1280);
+		}
+
+		{
+			// Downscaled rectangle covers the original one
+			ScreenRect rect;
+			rect.x = 101; rect.y = 50; rect.width = 33; rect.height = 10; rect.visible = true;
+			ScreenRect scaled = downscaledRect(rect, 4, 320, 256);
+			assert_vcl_no_msg(scaled.visible);
+			assert_vcl_no_msg(scaled.x * 4 <= rect.x && scaled.y * 4 <= rect.y);
+			assert_vcl_no_msg((scaled.x + scaled.width) * 4 >= rect.x + rect.width);
+			assert_vcl_no_msg((scaled.y + scaled.height) * 4 >= rect.y + rect.height);
+			assert_vcl_no_msg(!downscaledRect(ScreenRect(), 4, 320, 256).visible);
+		}
+	}
+
+}
@@ -0,0 +1,27 @@
+#include "shader_variants.hpp"
+
+namespace planet_test
+{
+
+	void test_shader_variants()
+	{
+		std::vector<std::string> const features = { "SUN", "WATER_GLOW", "SPECULAR_WATER", "ATMOSPHERE" };
+		assert_vcl_no_msg(definesForFeatures(features, 0).empty());
+
+		std::vector<std::string> const defines = definesForFeatures(features, 1 | 8);
+		assert_vcl_no_msg(defines.size() == 2);
+		assert_vcl_no_msg(defines[0] == "SUN" && defines[1] == "ATMOSPHERE");
+
+		// Bits past the known features are ignored
+		assert_vcl_no_msg(definesForFeatures(features, 0xF0).empty());
+		assert_vcl_no_msg(definesForFeatures(features, 0xF).size() == 4);
+
+		// The defines go right after #version, which must stay first
+		std::string const source = "#version 330 core\nvoid main() {}\n";
+		assert_vcl_no_msg(shaderWithDefines(source, {}) == source);
+		std::string const defined = shaderWithDefines(source, { "SUN", "ATMOSPHERE" });
+		assert_vcl_no_msg(defined == "#version 330 core\n#define SUN\n#define ATMOSPHERE\nvoid main() {}\n");
+		assert_vcl_no_msg(shaderWithDefines("void main() {}\n", { "SUN" }) == "#define SUN\nvoid main() {}\n");
+	}
+
+}
@@ -0,0 +1,47 @@
+#include "starfield.hpp"
+
+#include <cmath>
+
+namespace planet_test
+{
+
+	void test_starfield()
+	{
+		StarfieldSettings settings;
+		settings.count = 20000;
+		std::vector<Star> const stars = generateStarCatalog(settings);
+		assert_vcl_no_msg(stars.size() == 20000);
+
+		// Deterministic for a seed
+		std::vector<Star> const again = generateStarCatalog(settings);
+		for (size_t i = 0; i < stars.size(); i++) {
+			assert_vcl_no_msg(stars[i].direction.x == again[i].direction.x && stars[i].direction.z == again[i].direction.z);
+			assert_vcl_no_msg(stars[i].magnitude == again[i].magnitude);
+		}
+		settings.seed = 2;
+		std::vector<Star> const other = generateStarCatalog(settings);
+		assert_vcl_no_msg(other[0].direction.x != stars[0].direction.x);
+
+		// Uniform on the sphere, magnitudes in range with many more faint stars than bright ones
+		vcl::vec3 mean;
+		int faint = 0, bright = 0;
+		for (Star const& star : stars) {
+			assert_vcl_no_msg(std::abs(vcl::norm(star.direction) - 1.0f) < 1e-4f);
+			assert_vcl_no_msg(star.magnitude >= settings.brightestMagnitude && star.magnitude <= settings.faintestMagnitude);
+			assert_vcl_no_msg(star.color.x >= 0 && star.color.x <= 1 && star.color.y >= 0 && star.color.y <= 1 && star.color.z >= 0 && star.color.z <= 1);
+			mean += star.direction / float(stars.size());
+			if (star.magnitude > settings.faintestMagnitude - 1)
+				faint++;
+			if (star.magnitude < 2)
+				bright++;
+		}
+		assert_vcl_no_msg(vcl::norm(mean) < 0.03f);
+		assert_vcl_no_msg(faint > 10 * bright && bright > 0);
+
+		// Hot stars are blue, cool ones red
+		vcl::vec3 const hot = blackBodyColor(20000.0f);
+		vcl::vec3 const cool = blackBodyColor(3000.0f);
+		assert_vcl_no_msg(hot.z == 1.0f && hot.x < 1.0f);
+		assert_vcl_no_msg(cool.x == 1.0f && cool.z < 0.5f);
+	}
+}
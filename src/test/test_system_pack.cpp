@@ -0,0 +1,88 @@
+#include "system_pack.hpp"
+#include "planet_file.hpp"
+#include "solar_system.hpp"
+
+namespace planet_test
+{
+
+	void test_system_pack()
+	{
+		// Planet names, as in the packs and the bakes
+		assert_vcl_no_msg(planetNameFromPath("planets/Gwen.pbf") == "Gwen" && planetNameFromPath("EE.pbf") == "EE");
+		assert_vcl_no_msg(planetNameFromPath("planets\\windows\\Dune.pbf") == "Dune");
+
+		// Legacy untagged file
+		PlanetParameters gwen;
+		assert_vcl_no_msg(readPlanetFile("planets/Gwen.pbf", gwen));
+		assert_vcl_no_msg(gwen.radius == 50.0f);
+
+		// Round trip of the parameters and the orbit
+		SystemPlanet planet;
+		planet.name = "Gwen";
+		planet.parameters = gwen;
+		planet.parameters.waterGlow = true;
+		planet.parameters.specular = 0.3f;
+		planet.orbit.gravitationalParameter = 25000.0f;
+		planet.orbit.parent = 0;
+		planet.orbit.distance = 2000.0f;
+		planet.orbit.randomPhase = true;
+		planet.orbit.velocity = { 1.0f, 2.0f, 3.0f };
+		unsigned char const bake[5] = { 1, 2, 3, 4, 5 };
+		planet.bake = bake;
+		planet.bakeSize = 5;
+		SystemPlanet sun;
+		sun.name = "Sun";
+		sun.parameters.isSun = true;
+		sun.hasOrbit = false;
+
+		std::vector<unsigned char> const data = writeSystemPack({ sun, planet });
+		assert_vcl_no_msg(isSystemPack(data.data(), data.size()));
+		std::vector<SystemPlanet> planets;
+		assert_vcl_no_msg(parseSystemPack(data.data(), data.size(), planets));
+		assert_vcl_no_msg(planets.size() == 2);
+		assert_vcl_no_msg(planets[0].name == "Sun" && planets[0].parameters.isSun && !planets[0].hasOrbit && planets[0].bake == nullptr);
+		SystemPlanet const& loaded = planets[1];
+		assert_vcl_no_msg(loaded.name == "Gwen" && loaded.hasOrbit);
+		assert_vcl_no_msg(loaded.parameters.radius == gwen.radius && loaded.parameters.mountainsParameters.octave == gwen.mountainsParameters.octave);
+		assert_vcl_no_msg(loaded.parameters.waterColorSurface.z == gwen.waterColorSurface.z && loaded.parameters.wavelengths[2] == gwen.wavelengths[2]);
+		assert_vcl_no_msg(loaded.parameters.waterGlow && loaded.parameters.specular == 0.3f);
+		assert_vcl_no_msg(loaded.orbit.parent == 0 && loaded.orbit.distance == 2000.0f && loaded.orbit.randomPhase && loaded.orbit.velocity.z == 3.0f);
+		// Bakes are mapped in place and keep their alignment
+		assert_vcl_no_msg(loaded.bakeSize == 5 && loaded.bake[4] == 5);
+		assert_vcl_no_msg((loaded.bake - data.data()) % 16 == 0);
+
+		// Unknown fields are skipped, missing ones keep their default value
+		std::vector<unsigned char> fields;
+		appendFloats(fields, RadiusField, &gwen.radius, 1);
+		float const unknown[2] = { 1.0f, 2.0f };
+		appendFloats(fields, 1000, unknown, 2);
+		appendBool(fields, HasAtmosphereField, true);
+		PlanetParameters parameters;
+		assert_vcl_no_msg(readPlanetFields(fields.data(), fields.size(), parameters));
+		assert_vcl_no_msg(parameters.radius == 50.0f && parameters.hasAtmosphere && parameters.waterLevel == PlanetParameters().waterLevel);
+		// A field of the wrong size is ignored
+		appendInt(fields, HasAtmosphereField, 0);
+		assert_vcl_no_msg(readPlanetFields(fields.data(), fields.size(), parameters) && parameters.hasAtmosphere);
+		assert_vcl_no_msg(planetFieldName(MaxSlopeField) != nullptr && planetFieldName(1000) == nullptr);
+
+		// Unknown chunks are skipped
+		std::vector<unsigned char> extended = data;
+		unsigned char const chunk[24] = { 0, 0, 0, 0, 0, 0, 0, 0, 99, 0, 0, 0, 4, 0, 0, 0, 1, 2, 3, 4 }; // Header aligned as a chunk
+		extended.insert(extended.end(), chunk, chunk + 24);
+		assert_vcl_no_msg(parseSystemPack(extended.data(), extended.size(), planets) && planets.size() == 2);
+
+		// Damaged data is refused
+		assert_vcl_no_msg(!readPlanetFields(fields.data(), fields.size() - 2, parameters));
+		assert_vcl_no_msg(!parseSystemPack(data.data(), data.size() - 20, planets));
+
+		// Scene of the shipped system
+		assert_vcl_no_msg(readSystemScene(solarSystemScenePath, 500, planets));
+		assert_vcl_no_msg(planets.size() == 9 && planets[0].parameters.isSun && planets[0].orbit.parent == -1);
+		assert_vcl_no_msg(planets[2].name == "Gwen" && planets[2].parameters.radius == 50.0f && !planets[2].parameters.specularWater);
+		assert_vcl_no_msg(planets[3].orbit.parent == 2 && planets[3].orbit.division == 250 && planets[3].orbit.phase == 1.57f);
+		assert_vcl_no_msg(planets[1].orbit.randomPhase && planets[1].orbit.division == 500 && planets[4].orbit.division == 50);
+		assert_vcl_no_msg(planets[6].parameters.specular == 0.3f && planets[8].orbit.velocity.y > 6.0f);
+		assert_vcl_no_msg(!readSystemScene("planets/missing.scene", 500, planets) && planets.empty());
+	}
+
+}
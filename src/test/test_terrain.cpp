@@ -0,0 +1,56 @@
+#include "planet_file.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace planet_test
+{
+
+	void test_terrain()
+	{
+		// Terrain fields of a shipped planet
+		TerrainParameters terrain;
+		assert_vcl_no_msg(readTerrainParameters("planets/Gwen.pbf", terrain));
+		assert_vcl_no_msg(terrain.radius == 50.0f);
+		assert_vcl_no_msg(terrain.maxSlope > 0.55f && terrain.maxSlope < 0.56f);
+		assert_vcl_no_msg(terrain.continentParameters.octave >= 1 && terrain.continentParameters.octave <= 8);
+		assert_vcl_no_msg(terrain.mountainsParameters.octave >= 1 && terrain.mountainsParameters.octave <= 8);
+		assert_vcl_no_msg(!readTerrainParameters("planets/missing.pbf", terrain));
+
+		// The batched noises give exactly the values of the scalar ones, across several blocks
+		std::vector<vcl::vec3> directions(3000);
+		for (size_t i = 0; i < directions.size(); i++) {
+			float const angle = 0.01f * float(i);
+			float const z = 2.0f * float(i) / float(directions.size()) - 1.0f;
+			float const r = std::sqrt(1.0f - z * z);
+			directions[i] = { r * std::cos(angle), r * std::sin(angle), z };
+		}
+		std::vector<float> values(directions.size());
+		perlinNoise(directions.data(), values.data(), values.size(), terrain.continentParameters);
+		for (size_t i = 0; i < directions.size(); i++)
+			assert_vcl_no_msg(values[i] == perlinNoise(directions[i], terrain.continentParameters));
+		ridgeNoise(directions.data(), values.data(), values.size(), terrain.mountainsParameters, terrain.mountainSharpness);
+		for (size_t i = 0; i < directions.size(); i++)
+			assert_vcl_no_msg(values[i] == ridgeNoise(directions[i], terrain.mountainsParameters, terrain.mountainSharpness));
+
+		std::vector<vcl::vec3> positions(directions.size());
+		terrainPositions(terrain, directions.data(), positions.data(), positions.size());
+		for (size_t i = 0; i < directions.size(); i++) {
+			vcl::vec3 const expected = terrainPosition(terrain, directions[i]);
+			assert_vcl_no_msg(positions[i].x == expected.x && positions[i].y == expected.y && positions[i].z == expected.z);
+			// Displaced by a few percent of the radius at most
+			assert_vcl_no_msg(std::abs(vcl::norm(expected) - terrain.radius) < 0.2f * terrain.radius);
+		}
+
+		// Slopes stay in [0, 1] and are deterministic, the poles included
+		directions.push_back({ 0.0f, 0.0f, 1.0f });
+		directions.push_back({ 0.0f, 0.0f, -1.0f });
+		for (vcl::vec3 const& direction : directions) {
+			float const height = vcl::norm(terrainPosition(terrain, direction));
+			float const slope = terrainSlope(terrain, direction, height);
+			assert_vcl_no_msg(slope >= 0.0f && slope <= 1.0f);
+			assert_vcl_no_msg(slope == terrainSlope(terrain, direction, height));
+		}
+	}
+
+}
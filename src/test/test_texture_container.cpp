@@ -0,0 +1,124 @@
+#include "texture_container.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+namespace planet_test
+{
+	static vcl::image_raw gradientImage(unsigned int width, unsigned int height) {
+		vcl::buffer<unsigned char> pixels;
+		for (unsigned int y = 0; y < height; y++) {
+			for (unsigned int x = 0; x < width; x++) {
+				pixels.push_back((unsigned char)(255 * x / (width - 1)));
+				pixels.push_back((unsigned char)(255 * y / (height - 1)));
+				pixels.push_back(64);
+				pixels.push_back(255);
+			}
+		}
+		return vcl::image_raw(width, height, vcl::image_color_type::rgba, pixels);
+	}
+
+	void test_texture_container()
+	{
+		{
+			// Full chain with odd sizes
+			std::vector<vcl::image_raw> const mips = buildMipChain(gradientImage(13, 6));
+			assert_vcl_no_msg(mips.size() == 4);
+			assert_vcl_no_msg(mips[1].width == 6 && mips[1].height == 3);
+			assert_vcl_no_msg(mips[2].width == 3 && mips[2].height == 1);
+			assert_vcl_no_msg(mips[3].width == 1 && mips[3].height == 1);
+			assert_vcl_no_msg(mips[3].data.size() == 4 && mips[3].data[2] == 64 && mips[3].data[3] == 255);
+		}
+
+		{
+			// Box filter of a 2x2 image
+			vcl::buffer<unsigned char> pixels;
+			for (int value : { 0, 0, 0, 255, 100, 0, 0, 255, 0, 200, 0, 255, 100, 200, 0, 255 })
+				pixels.push_back((unsigned char)value);
+			std::vector<vcl::image_raw> const mips = buildMipChain(vcl::image_raw(2, 2, vcl::image_color_type::rgba, pixels));
+			assert_vcl_no_msg(mips.size() == 2);
+			assert_vcl_no_msg(mips[1].data[0] == 50 && mips[1].data[1] == 100 && mips[1].data[2] == 0);
+		}
+
+		{
+			// A uniform block and a block of two colors are encoded without loss
+			unsigned char pixels[64], block[8], decoded[64];
+			for (int i = 0; i < 16; i++) {
+				pixels[4 * i + 0] = 255; pixels[4 * i + 1] = 0; pixels[4 * i + 2] = 0; pixels[4 * i + 3] = 255;
+			}
+			encodeBC1Block(pixels, block);
+			decodeBC1Block(block, decoded);
+			for (int i = 0; i < 64; i++)
+				assert_vcl_no_msg(decoded[i] == pixels[i]);
+
+			for (int i = 0; i < 16; i++) {
+				unsigned char const value = (i % 3 == 0) ? 255 : 0;
+				pixels[4 * i + 0] = value; pixels[4 * i + 1] = value; pixels[4 * i + 2] = value;
+			}
+			encodeBC1Block(pixels, block);
+			decodeBC1Block(block, decoded);
+			for (int i = 0; i < 64; i++)
+				assert_vcl_no_msg(decoded[i] == pixels[i]);
+		}
+
+		{
+			// A horizontal gradient stays close after compression, the border blocks are clamped
+			vcl::buffer<unsigned char> pixels;
+			for (int y = 0; y < 14; y++) {
+				for (int x = 0; x < 14; x++) {
+					for (int value : { 10 * x, 120, 255 - 10 * x, 255 })
+						pixels.push_back((unsigned char)value);
+				}
+			}
+			vcl::image_raw const image(14, 14, vcl::image_color_type::rgba, pixels);
+			std::vector<unsigned char> const blocks = compressBC1(image);
+			assert_vcl_no_msg(blocks.size() == 16 * 8);
+			std::vector<unsigned char> const decoded = decompressBC1(blocks.data(), 14, 14);
+			assert_vcl_no_msg(decoded.size() == image.data.size());
+			for (size_t i = 0; i < decoded.size(); i++)
+				assert_vcl_no_msg(std::abs(int(decoded[i]) - int(image.data[i])) <= 12);
+		}
+
+		{
+			// Round trip through the file layout
+			vcl::image_raw const image = gradientImage(20, 9);
+			for (TextureFormat format : { TextureFormat::RGBA8, TextureFormat::BC1 }) {
+				std::vector<unsigned char> const file = bakeTextureContainer(image, format);
+				TextureView view;
+				assert_vcl_no_msg(parseTextureContainer(file.data(), file.size(), view));
+				assert_vcl_no_msg(view.format == format);
+				assert_vcl_no_msg(view.levels.size() == 5);
+				assert_vcl_no_msg(view.levels[0].width == 20 && view.levels[0].height == 9);
+				assert_vcl_no_msg(view.levels[4].width == 1 && view.levels[4].height == 1);
+				for (size_t i = 0; i < view.levels.size(); i++)
+					assert_vcl_no_msg(view.levels[i].offset % 16 == 0);
+				if (format == TextureFormat::RGBA8)
+					assert_vcl_no_msg(view.data[0][4 * 21 + 1] == image.data[4 * 21 + 1]);
+
+				// Truncated or corrupted files are rejected
+				size_t const end = size_t(view.levels.back().offset + view.levels.back().size);
+				assert_vcl_no_msg(parseTextureContainer(file.data(), end, view));
+				assert_vcl_no_msg(!parseTextureContainer(file.data(), end - 1, view));
+				std::vector<unsigned char> corrupted = file;
+				corrupted[0] = 'X';
+				assert_vcl_no_msg(!parseTextureContainer(corrupted.data(), corrupted.size(), view));
+
+				// Second level off the mip chain with the byte size of its pixels, then a wrong byte size
+				size_t const second = sizeof(TextureContainerHeader) + sizeof(TextureContainerLevel);
+				uint32_t const dimensions[2] = { format == TextureFormat::BC1 ? 12u : 8u, format == TextureFormat::BC1 ? 4u : 5u };
+				corrupted = file;
+				std::memcpy(corrupted.data() + second, dimensions, sizeof(dimensions));
+				assert_vcl_no_msg(!parseTextureContainer(corrupted.data(), corrupted.size(), view));
+				assert_vcl_no_msg(parseTextureContainer(file.data(), file.size(), view));
+				corrupted = file;
+				uint64_t const size = view.levels[1].size + 8;
+				std::memcpy(corrupted.data() + second + offsetof(TextureContainerLevel, size), &size, sizeof(size));
+				assert_vcl_no_msg(!parseTextureContainer(corrupted.data(), corrupted.size(), view));
+			}
+		}
+
+		assert_vcl_no_msg(bakedTexturePath("assets/moon_normal_map1.png") == "assets/moon_normal_map1.ptex");
+		assert_vcl_no_msg(bakedTexturePath("assets.dir/sky") == "assets.dir/sky.ptex");
+	}
+}
@@ -0,0 +1,57 @@
+#include "trace.hpp"
+#include "vcl/vcl.hpp"
+
+#include <thread>
+
+namespace planet_test
+{
+
+	void test_trace()
+	{
+		// A full ring keeps its last events, oldest first
+		TraceRing ring(7);
+		for (int i = 0; i < int(TraceRing::capacity) + 10; i++) {
+			TraceEvent event;
+			event.name = "event";
+			event.start = i;
+			ring.push(event);
+		}
+		std::vector<TraceEvent> const events = ring.snapshot();
+		assert_vcl_no_msg(ring.written() == TraceRing::capacity + 10);
+		// The slot the writer would fill next is not trusted
+		assert_vcl_no_msg(events.size() == TraceRing::capacity - 1);
+		assert_vcl_no_msg(events.front().start == 11 && events.back().start == int64_t(TraceRing::capacity) + 9);
+		for (size_t i = 1; i < events.size(); i++)
+			assert_vcl_no_msg(events[i].start == events[i - 1].start + 1);
+
+		TraceRing small(0);
+		for (int i = 0; i < 3; i++)
+			small.push(TraceEvent());
+		assert_vcl_no_msg(small.snapshot().size() == 3);
+
+		// Events of several threads, recorded after their end
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; i++)
+			threads.push_back(std::thread([]() {
+				traceThreadName("Worker");
+				TraceScope scope("test_trace_worker", "a \"quoted\" detail");
+			}));
+		for (std::thread& thread : threads)
+			thread.join();
+		{
+			TraceScope scope("test_trace_main");
+		}
+
+		std::string const json = chromeTraceJson();
+		assert_vcl_no_msg(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+		assert_vcl_no_msg(json.find("\"name\":\"test_trace_main\"") != std::string::npos);
+		assert_vcl_no_msg(json.find("\"args\":{\"detail\":\"a \\\"quoted\\\" detail\"}") != std::string::npos);
+		size_t workers = 0;
+		for (size_t position = json.find("test_trace_worker"); position != std::string::npos; position = json.find("test_trace_worker", position + 1))
+			workers++;
+		assert_vcl_no_msg(workers == 4);
+		assert_vcl_no_msg(json.find("\"name\":\"thread_name\",\"pid\":1") != std::string::npos);
+		assert_vcl_no_msg(json.rfind("]}\n") == json.size() - 3);
+	}
+
+}
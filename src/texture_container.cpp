@@ -0,0 +1,303 @@
+#include "texture_container.hpp"
+#include "opengl_extensions.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace vcl;
+
+static char const containerMagic[4] = { 'P', 'T', 'E', 'X' };
+static uint32_t const containerVersion = 1;
+static uint32_t const maxContainerSize = 1u << 16; // Largest width or height accepted by the parser
+
+static image_raw toRGBA(image_raw const& image) {
+    if (image.color_type == image_color_type::rgba)
+        return image;
+    image_raw converted(image.width, image.height, image_color_type::rgba, buffer<unsigned char>());
+    converted.data.resize(4 * size_t(image.width) * image.height);
+    for (size_t i = 0; i < size_t(image.width) * image.height; i++) {
+        for (int c = 0; c < 3; c++)
+            converted.data[4 * i + c] = image.data[3 * i + c];
+        converted.data[4 * i + 3] = 255;
+    }
+    return converted;
+}
+
+std::vector<image_raw> buildMipChain(image_raw const& image) {
+    std::vector<image_raw> levels;
+    levels.push_back(toRGBA(image));
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        image_raw const& source = levels.back();
+        unsigned int const width = std::max(1u, source.width / 2);
+        unsigned int const height = std::max(1u, source.height / 2);
+        image_raw level(width, height, image_color_type::rgba, buffer<unsigned char>());
+        level.data.resize(4 * size_t(width) * height);
+
+        // Average of the 2x2 pixels above, clamped on the odd borders
+        for (unsigned int y = 0; y < height; y++) {
+            for (unsigned int x = 0; x < width; x++) {
+                unsigned int const x0 = std::min(2 * x, source.width - 1), x1 = std::min(2 * x + 1, source.width - 1);
+                unsigned int const y0 = std::min(2 * y, source.height - 1), y1 = std::min(2 * y + 1, source.height - 1);
+                for (int c = 0; c < 4; c++) {
+                    unsigned int const sum = source.data[4 * (size_t(y0) * source.width + x0) + c] + source.data[4 * (size_t(y0) * source.width + x1) + c]
+                        + source.data[4 * (size_t(y1) * source.width + x0) + c] + source.data[4 * (size_t(y1) * source.width + x1) + c];
+                    level.data[4 * (size_t(y) * width + x) + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+
+static uint16_t packColor565(int r, int g, int b) {
+    return uint16_t(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+static void unpackColor565(uint16_t color, int rgb[3]) {
+    int const r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// The four colors of a block, in the order of the indices
+static void bc1Palette(uint16_t color0, uint16_t color1, int palette[4][4]) {
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+    for (int c = 0; c < 3; c++) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = color0 > color1 ? 255 : 0;
+}
+
+void encodeBC1Block(unsigned char const rgba[64], unsigned char block[8]) {
+    // Endpoints on the diagonal of the bounding box, oriented along the correlation with the widest channel
+    int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+    float mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            low[c] = std::min(low[c], int(rgba[4 * i + c]));
+            high[c] = std::max(high[c], int(rgba[4 * i + c]));
+            mean[c] += rgba[4 * i + c] / 16.0f;
+        }
+    }
+    int reference = 0;
+    for (int c = 1; c < 3; c++)
+        if (high[c] - low[c] > high[reference] - low[reference])
+            reference = c;
+    float covariance[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            covariance[c] += (rgba[4 * i + c] - mean[c]) * (rgba[4 * i + reference] - mean[reference]);
+    for (int c = 0; c < 3; c++)
+        if (covariance[c] < 0)
+            std::swap(low[c], high[c]);
+
+    uint16_t color0 = packColor565(high[0], high[1], high[2]);
+    uint16_t color1 = packColor565(low[0], low[1], low[2]);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][4];
+        bc1Palette(color0, color1, palette);
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int distance = 0;
+                for (int c = 0; c < 3; c++) {
+                    int const d = rgba[4 * i + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= uint32_t(best) << (2 * i);
+        }
+    }
+
+    block[0] = uint8_t(color0 & 0xFF);
+    block[1] = uint8_t(color0 >> 8);
+    block[2] = uint8_t(color1 & 0xFF);
+    block[3] = uint8_t(color1 >> 8);
+    for (int i = 0; i < 4; i++)
+        block[4 + i] = uint8_t(indices >> (8 * i));
+}
+
+void decodeBC1Block(unsigned char const block[8], unsigned char rgba[64]) {
+    uint16_t const color0 = uint16_t(block[0] | block[1] << 8);
+    uint16_t const color1 = uint16_t(block[2] | block[3] << 8);
+    uint32_t const indices = uint32_t(block[4]) | uint32_t(block[5]) << 8 | uint32_t(block[6]) << 16 | uint32_t(block[7]) << 24;
+    int palette[4][4];
+    bc1Palette(color0, color1, palette);
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            rgba[4 * i + c] = (unsigned char)palette[(indices >> (2 * i)) & 3][c];
+}
+
+static size_t bc1Size(unsigned int width, unsigned int height) {
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+std::vector<unsigned char> compressBC1(image_raw const& image) {
+    image_raw const source = toRGBA(image);
+    std::vector<unsigned char> blocks(bc1Size(source.width, source.height));
+    unsigned char pixels[64];
+    size_t offset = 0;
+    for (unsigned int by = 0; by < source.height; by += 4) {
+        for (unsigned int bx = 0; bx < source.width; bx += 4) {
+            // The blocks crossing the border repeat the last pixels
+            for (unsigned int i = 0; i < 16; i++) {
+                unsigned int const x = std::min(bx + i % 4, source.width - 1);
+                unsigned int const y = std::min(by + i / 4, source.height - 1);
+                std::memcpy(&pixels[4 * i], &source.data[4 * (size_t(y) * source.width + x)], 4);
+            }
+            encodeBC1Block(pixels, &blocks[offset]);
+            offset += 8;
+        }
+    }
+    return blocks;
+}
+
+std::vector<unsigned char> decompressBC1(unsigned char const* blocks, unsigned int width, unsigned int height) {
+    std::vector<unsigned char> rgba(4 * size_t(width) * height);
+    unsigned char pixels[64];
+    for (unsigned int by = 0; by < height; by += 4) {
+        for (unsigned int bx = 0; bx < width; bx += 4) {
+            decodeBC1Block(blocks, pixels);
+            blocks += 8;
+            for (unsigned int i = 0; i < 16; i++) {
+                unsigned int const x = bx + i % 4, y = by + i / 4;
+                if (x < width && y < height)
+                    std::memcpy(&rgba[4 * (size_t(y) * width + x)], &pixels[4 * i], 4);
+            }
+        }
+    }
+    return rgba;
+}
+
+
+static size_t alignOffset(size_t offset) {
+    return (offset + 15) & ~size_t(15);
+}
+
+std::vector<unsigned char> bakeTextureContainer(image_raw const& image, TextureFormat format) {
+    std::vector<image_raw> const mips = buildMipChain(image);
+
+    std::vector<std::vector<unsigned char>> payloads;
+    for (image_raw const& mip : mips) {
+        if (format == TextureFormat::BC1)
+            payloads.push_back(compressBC1(mip));
+        else
+            payloads.push_back(std::vector<unsigned char>(mip.data.data.begin(), mip.data.data.end()));
+    }
+
+    TextureContainerHeader header;
+    std::memcpy(header.magic, containerMagic, 4);
+    header.version = containerVersion;
+    header.format = uint32_t(format);
+    header.width = mips[0].width;
+    header.height = mips[0].height;
+    header.levelCount = uint32_t(mips.size());
+
+    std::vector<TextureContainerLevel> levels(mips.size());
+    size_t offset = alignOffset(sizeof(header) + levels.size() * sizeof(TextureContainerLevel));
+    for (size_t i = 0; i < mips.size(); i++) {
+        levels[i].width = mips[i].width;
+        levels[i].height = mips[i].height;
+        levels[i].offset = offset;
+        levels[i].size = payloads[i].size();
+        offset = alignOffset(offset + payloads[i].size());
+    }
+
+    std::vector<unsigned char> file(offset, 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    std::memcpy(file.data() + sizeof(header), levels.data(), levels.size() * sizeof(TextureContainerLevel));
+    for (size_t i = 0; i < mips.size(); i++)
+        std::memcpy(file.data() + levels[i].offset, payloads[i].data(), payloads[i].size());
+    return file;
+}
+
+bool parseTextureContainer(unsigned char const* data, size_t size, TextureView& view) {
+    TextureContainerHeader header;
+    if (data == nullptr || size < sizeof(header))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, containerMagic, 4) != 0 || header.version != containerVersion)
+        return false;
+    if (header.format > uint32_t(TextureFormat::BC1) || header.levelCount == 0 || header.levelCount > 32)
+        return false;
+    if (size < sizeof(header) + header.levelCount * sizeof(TextureContainerLevel))
+        return false;
+
+    view.format = TextureFormat(header.format);
+    view.levels.resize(header.levelCount);
+    view.data.resize(header.levelCount);
+    std::memcpy(view.levels.data(), data + sizeof(header), header.levelCount * sizeof(TextureContainerLevel));
+    // Bounded so that the byte sizes below cannot overflow
+    if (header.width == 0 || header.height == 0 || header.width > maxContainerSize || header.height > maxContainerSize)
+        return false;
+    for (size_t i = 0; i < view.levels.size(); i++) {
+        TextureContainerLevel const& level = view.levels[i];
+        // Each level halves the previous one, as glTexImage2D expects of a mip chain
+        uint32_t const width = i == 0 ? header.width : std::max(1u, view.levels[i - 1].width / 2);
+        uint32_t const height = i == 0 ? header.height : std::max(1u, view.levels[i - 1].height / 2);
+        if (level.width != width || level.height != height)
+            return false;
+        size_t const expected = view.format == TextureFormat::BC1 ? bc1Size(level.width, level.height) : 4 * size_t(level.width) * level.height;
+        if (level.size != expected || level.offset > size || level.size > size - level.offset)
+            return false;
+        view.data[i] = data + level.offset;
+    }
+    return true;
+}
+
+GLuint uploadTextureContainer(TextureView const& view, GLint wrapS, GLint wrapT) {
+    GLuint id = 0;
+    glGenTextures(1, &id); opengl_check;
+    glBindTexture(GL_TEXTURE_2D, id); opengl_check;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t i = 0; i < view.levels.size(); i++) {
+        GLint const level = GLint(i);
+        GLsizei const width = GLsizei(view.levels[i].width), height = GLsizei(view.levels[i].height);
+        if (view.format == TextureFormat::RGBA8) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, view.data[i]); opengl_check;
+        }
+        else if (glExtensions.textureCompressionS3TC) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, 0, GLsizei(view.levels[i].size), view.data[i]); opengl_check;
+        }
+        else {
+            std::vector<unsigned char> const rgba = decompressBC1(view.data[i], view.levels[i].width, view.levels[i].height);
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data()); opengl_check;
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(view.levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0); opengl_check;
+    return id;
+}
+
+std::string bakedTexturePath(std::string const& path) {
+    size_t const dot = path.find_last_of('.');
+    size_t const slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + ".ptex";
+    return path.substr(0, dot) + ".ptex";
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vcl/vcl.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baked texture: the pixels of every mip level ready to be sent to OpenGL, so loading needs no decode.
+// Layout: TextureContainerHeader, levelCount TextureContainerLevel, then the level data aligned on 16 bytes.
+
+enum class TextureFormat : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1 // DXT1, 8 bytes per 4x4 block, no alpha
+};
+
+struct TextureContainerHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+};
+
+struct TextureContainerLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // From the start of the file
+    uint64_t size;
+};
+
+// Levels of a container in memory, pointing into the file data
+struct TextureView {
+    TextureFormat format = TextureFormat::RGBA8;
+    std::vector<TextureContainerLevel> levels;
+    std::vector<unsigned char const*> data;
+};
+
+// Box-filtered levels down to 1x1, the first one is the image converted to RGBA
+std::vector<vcl::image_raw> buildMipChain(vcl::image_raw const& image);
+
+// 4x4 block of RGBA pixels to BC1 and back, used by the converter and by the drivers without S3TC
+void encodeBC1Block(unsigned char const rgba[64], unsigned char block[8]);
+void decodeBC1Block(unsigned char const block[8], unsigned char rgba[64]);
+std::vector<unsigned char> compressBC1(vcl::image_raw const& image);
+std::vector<unsigned char> decompressBC1(unsigned char const* blocks, unsigned int width, unsigned int height);
+
+// Whole container file
+std::vector<unsigned char> bakeTextureContainer(vcl::image_raw const& image, TextureFormat format);
+
+// False when the data is not a valid container of the current version
+bool parseTextureContainer(unsigned char const* data, size_t size, TextureView& view);
+
+// Requires a current context. BC1 levels are decompressed when the driver lacks S3TC.
+GLuint uploadTextureContainer(TextureView const& view, GLint wrapS, GLint wrapT);
+
+// Path of the baked version of an image: the extension is replaced by .ptex
+std::string bakedTexturePath(std::string const& path);
@@ -0,0 +1,143 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+TraceRing::TraceRing(unsigned int thread_arg) : thread(thread_arg), events(new TraceEvent[capacity]) {
+}
+
+void TraceRing::push(TraceEvent const& event) {
+    uint64_t const index = count.load(std::memory_order_relaxed);
+    events[index % capacity] = event;
+    count.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TraceEvent> TraceRing::snapshot() const {
+    uint64_t const end = count.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity ? end - capacity : 0;
+    std::vector<TraceEvent> copy;
+    copy.reserve(size_t(end - begin));
+    for (uint64_t i = begin; i < end; i++)
+        copy.push_back(events[i % capacity]);
+
+    // The writer may have wrapped around meanwhile, the slot of its next event included
+    uint64_t const after = count.load(std::memory_order_acquire);
+    uint64_t const firstValid = after + 1 > capacity ? after + 1 - capacity : 0;
+    if (firstValid > begin) {
+        size_t const dropped = size_t(std::min(firstValid - begin, uint64_t(copy.size())));
+        copy.erase(copy.begin(), copy.begin() + dropped);
+    }
+    return copy;
+}
+
+
+static std::chrono::steady_clock::time_point const traceEpoch = std::chrono::steady_clock::now();
+
+static std::mutex ringsMutex;
+static std::vector<std::unique_ptr<TraceRing>>& rings() {
+    // The rings outlive their threads, so that the events of the workers can be written after they end
+    static std::vector<std::unique_ptr<TraceRing>> all;
+    return all;
+}
+
+static TraceRing& threadRing() {
+    thread_local TraceRing* ring = nullptr;
+    if (ring == nullptr) {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings().push_back(std::unique_ptr<TraceRing>(new TraceRing((unsigned int)rings().size())));
+        ring = rings().back().get();
+    }
+    return *ring;
+}
+
+int64_t traceNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+void traceEvent(char const* name, int64_t start, int64_t end, std::string const& detail) {
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    std::strncpy(event.detail, detail.c_str(), sizeof(event.detail) - 1);
+    threadRing().push(event);
+}
+
+void traceThreadName(std::string const& name) {
+    TraceRing& ring = threadRing();
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring.name = name;
+}
+
+TraceScope::TraceScope(char const* name_arg, std::string const& detail_arg) : name(name_arg), detail(detail_arg), start(traceNow()) {
+}
+
+TraceScope::~TraceScope() {
+    traceEvent(name, start, traceNow(), detail);
+}
+
+
+static void writeJsonString(std::ostream& out, char const* text) {
+    out << '"';
+    for (char const* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            out << '\\' << *c;
+        else if ((unsigned char)*c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)(unsigned char)*c);
+            out << escaped;
+        }
+        else
+            out << *c;
+    }
+    out << '"';
+}
+
+std::string chromeTraceJson() {
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (std::unique_ptr<TraceRing> const& ring : rings()) {
+        if (!ring->name.empty()) {
+            json << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->thread << ",\"args\":{\"name\":";
+            writeJsonString(json, ring->name.c_str());
+            json << "}}";
+            first = false;
+        }
+        // Microseconds, with the nanoseconds as decimals
+        for (TraceEvent const& event : ring->snapshot()) {
+            json << (first ? "" : ",") << "\n{\"ph\":\"X\",\"cat\":\"startup\",\"name\":";
+            writeJsonString(json, event.name);
+            json << ",\"pid\":1,\"tid\":" << ring->thread
+                << ",\"ts\":" << event.start / 1000 << '.' << (event.start % 1000) / 100
+                << ",\"dur\":" << event.duration / 1000 << '.' << (event.duration % 1000) / 100;
+            if (event.detail[0] != '\0') {
+                json << ",\"args\":{\"detail\":";
+                writeJsonString(json, event.detail);
+                json << '}';
+            }
+            json << '}';
+            first = false;
+        }
+    }
+    json << "\n]}\n";
+    return json.str();
+}
+
+bool writeChromeTrace(std::string const& path) {
+    std::ofstream file(path);
+    file << chromeTraceJson();
+    if (!file) {
+        std::cerr << "Cannot write the trace in " << path << std::endl;
+        return false;
+    }
+    std::cout << "Trace written in " << path << ", open it in chrome://tracing or ui.perfetto.dev" << std::endl;
+    return true;
+}
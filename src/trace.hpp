@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Timeline of the startup, written in the trace_event JSON format of chrome://tracing and Perfetto.
+// Each thread records its events in its own ring buffer without any lock, the oldest events are overwritten
+// once a ring is full. Only the first event of a thread takes a lock, to register its ring.
+
+struct TraceEvent {
+    char const* name = nullptr; // Static string, the events keep the pointer
+    int64_t start = 0;          // Nanoseconds since the first use of the trace
+    int64_t duration = 0;
+    char detail[24] = {};       // Truncated copy of an optional argument, as a file or planet name
+};
+
+// Written by one thread, read by any: a slot is published by the counter, and the reader drops the slots
+// overwritten while it copied them.
+class TraceRing {
+public:
+    static const size_t capacity = 2048;
+
+    explicit TraceRing(unsigned int thread);
+    void push(TraceEvent const& event);
+    std::vector<TraceEvent> snapshot() const; // Oldest first
+    uint64_t written() const { return count.load(std::memory_order_acquire); }
+
+    unsigned int const thread;
+    std::string name; // Set by its thread before its first event, or left empty
+
+private:
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<uint64_t> count{ 0 };
+};
+
+int64_t traceNow();
+void traceEvent(char const* name, int64_t start, int64_t end, std::string const& detail = std::string());
+// Name of the calling thread in the trace viewer
+void traceThreadName(std::string const& name);
+
+// Complete event covering the scope
+class TraceScope {
+public:
+    explicit TraceScope(char const* name, std::string const& detail = std::string());
+    ~TraceScope();
+    TraceScope(TraceScope const&) = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+    char const* name;
+    std::string detail;
+    int64_t start;
+};
+
+// Every event recorded so far, safe to call while the other threads record
+std::string chromeTraceJson();
+bool writeChromeTrace(std::string const& path);
@@ -1,5 +1,6 @@
 #include "vcl/vcl.hpp"
 #include "vegetation.hpp"
+#include "trace.hpp"
 
 using namespace vcl;
 
@@ -52,7 +53,8 @@ static vec3 point13 = { 0,1.f,13.f };
 static vec3 point14 = { 0,.3f,13.5f };
 static vec3 point15 = { 0,0,14.f };
 
-void createPlant(hierarchy_mesh_drawable& hierarchy) {
+void createPlant(Plant& plant, MeshArena& arena) {
+	TraceScope trace("createPlant");
 	int nombreTroncons = 13;
 	buffer<vec3> pointsInterpolation;
 	pointsInterpolation.push_back(point0);
@@ -117,7 +119,7 @@ void createPlant(hierarchy_mesh_drawable& hierarchy) {
 	numberPointsCircle.push_back(100); //p14
 	vec3 colorLow = { .38f,.33f,.24f };
 	vec3 colorHigh = { .38f,.88f,.69f };
-	buffer<mesh_drawable> troncons;
+	hierarchy_mesh_drawable& hierarchy = plant.hierarchy;
 
 	buffer<buffer<vec3>> spines; // La spine d'indice 0 est spine1
 	for (int indiceTroncon = 0; indiceTroncon < nombreTroncons; indiceTroncon++) {
@@ -163,16 +165,19 @@ void createPlant(hierarchy_mesh_drawable& hierarchy) {
 				base + 2 * numberPointsCircle[indiceTroncon] - 1 });
 		}
 		meshTroncon.fill_empty_field();
-		mesh_drawable troncon = mesh_drawable(meshTroncon);
+		arena_mesh_drawable troncon;
+		troncon.range = arena.add(meshTroncon);
+		troncon.shader = mesh_drawable::default_shader;
+		troncon.texture = mesh_drawable::default_texture;
 		troncon.shading.phong.specular = 0.0f;
 		troncon.shading.color = colorLow + (float)indiceTroncon / nombreTroncons * (colorHigh - colorLow);
-		troncons.push_back(troncon);
+		plant.segments.push_back(troncon);
 	}
 
-	mesh_drawable disque = mesh_drawable(mesh_primitive_disc(1.f, { 0,0,0 }, { 0,0,1.f }, 40));
-	hierarchy.add(troncons[0], "troncon " + std::to_string(0));
+	// The nodes carry no mesh_drawable, the segments are drawn from the arena
+	hierarchy.add(mesh_drawable(), "troncon " + std::to_string(0));
 	for (int compteur = 1; compteur < nombreTroncons; compteur++) {
-		hierarchy.add(troncons[compteur], "troncon " + std::to_string(compteur), "troncon " + std::to_string(compteur - 1),
+		hierarchy.add(mesh_drawable(), "troncon " + std::to_string(compteur), "troncon " + std::to_string(compteur - 1),
 			pointsInterpolation[compteur + 1] - pointsInterpolation[compteur]);
 	}
 }
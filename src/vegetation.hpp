@@ -1,7 +1,16 @@
 #pragma once
 
 #include "vcl/vcl.hpp"
+#include "buffer_arena.hpp"
 
-void createPlant(vcl::hierarchy_mesh_drawable& hierarchy);
+#include <vector>
+
+// The segments are stored in the mesh arena, the hierarchy only animates their frames
+struct Plant {
+	vcl::hierarchy_mesh_drawable hierarchy;
+	std::vector<arena_mesh_drawable> segments; // Same order as the elements of the hierarchy
+};
+
+void createPlant(Plant& plant, MeshArena& arena);
 void plantAnimation(vcl::hierarchy_mesh_drawable& hierarchy, float t);
 vcl::buffer<vcl::buffer<float>> plantSpawn(int nombrePousses, vcl::vec3 colorLow, vcl::vec3 colorHigh, float sizeMax);
\ No newline at end of file
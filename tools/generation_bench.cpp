@@ -0,0 +1,202 @@
+// Cost of generating the planet meshes, without any window or OpenGL context.
+//
+// Usage: generation_bench [--out report.json] [--resolutions 100,250,500,1000] [--threads n] [planet.pbf...]
+//        generation_bench --compare baseline.json current.json [--threshold percent]
+//
+// For each resolution, builds the shared icosphere topology (unit sphere, nested low resolution level and
+// clusters), then generates every planet as Planet::updatePlanetMesh does: displacement, slope coloring,
+// normals and the cluster bounds of both levels. Reports the time of each stage, the vertices per second of
+// the whole generation, the scaling of the displacement and slopes from one thread to every hardware thread,
+// and the peak resident memory after each resolution.
+
+#include "benchmark_report.hpp"
+#include "planet_file.hpp"
+#include "planet_surface.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Peak resident set size of the process in megabytes
+static double peakResidentMegabytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0.0;
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes
+#else
+    return usage.ru_maxrss / 1024.0; // Kilobytes
+#endif
+#endif
+}
+
+template <typename F>
+static double milliseconds(F const& function) {
+    auto const start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Calls work(first, last) on consecutive ranges of [0, size), one per thread
+template <typename F>
+static void parallelRanges(size_t size, unsigned int threads, F const& work) {
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++)
+        workers.push_back(std::thread(work, size * t / threads, size * (t + 1) / threads));
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+static void displace(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, unsigned int threads) {
+    parallelRanges(topology.directions.size(), threads, [&](size_t first, size_t last) {
+        displaceSurface(terrain, topology, surface, first, last);
+    });
+}
+
+static void colorSlopes(TerrainParameters const& terrain, IcosphereTopology const& topology, PlanetSurface& surface, unsigned int threads) {
+    parallelRanges(topology.directions.size(), threads, [&](size_t first, size_t last) {
+        colorSurfaceSlopes(terrain, topology, surface, first, last);
+    });
+}
+
+static std::vector<unsigned int> parseList(std::string const& text) {
+    std::vector<unsigned int> values;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (std::atoi(item.c_str()) > 0)
+            values.push_back((unsigned int)std::atoi(item.c_str()));
+    return values;
+}
+
+int main(int argc, char** argv) {
+    std::vector<unsigned int> resolutions = { 100, 250, 500, 1000 };
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    BenchmarkCommandLine commandLine;
+    commandLine.output = "generation_bench.json";
+    bool const parsed = parseBenchmarkCommandLine(argc, argv, "[--resolutions 100,250,500,1000] [--threads n]", [&](int argc, char** argv, int& i) {
+        std::string const argument = argv[i];
+        if (argument == "--resolutions" && i + 1 < argc)
+            resolutions = parseList(argv[++i]);
+        else if (argument == "--threads" && i + 1 < argc)
+            maxThreads = std::max(1, std::atoi(argv[++i]));
+        else
+            return false;
+        return true;
+    }, commandLine);
+    if (!parsed)
+        return commandLine.exitCode;
+
+    struct NamedTerrain {
+        std::string name;
+        TerrainParameters terrain;
+    };
+    std::vector<NamedTerrain> terrains;
+    for (std::string const& path : commandLine.planets) {
+        NamedTerrain planet;
+        if (!readTerrainParameters(path, planet.terrain)) {
+            std::cerr << "Cannot read " << path << ", skipped" << std::endl;
+            continue;
+        }
+        planet.name = planetNameFromPath(path);
+        terrains.push_back(planet);
+    }
+    if (terrains.empty() || resolutions.empty()) {
+        std::cerr << "Nothing to generate" << std::endl;
+        return 1;
+    }
+
+    BenchmarkReport report;
+    report.suite = "generation";
+    report.threads = std::max(1u, std::thread::hardware_concurrency());
+    auto const add = [&report](std::string const& name, double value, std::string const& unit, bool lowerIsBetter) {
+        BenchmarkResult result;
+        result.name = name;
+        result.value = value;
+        result.unit = unit;
+        result.lowerIsBetter = lowerIsBetter;
+        report.results.push_back(result);
+    };
+
+    for (unsigned int resolution : resolutions) {
+        std::string const prefix = "resolution=" + std::to_string(resolution) + "/";
+
+        // Shared by every planet of the resolution, includes the low resolution index buffer
+        std::shared_ptr<IcosphereTopology const> topology;
+        double const topologyTime = milliseconds([&]() {
+            topology = icosphere_topology(resolution, LOW_RES_DIVISION, TRIANGLES_PER_CLUSTER);
+        });
+        size_t const vertexCount = topology->directions.size();
+        add(prefix + "icosphere", topologyTime, "ms", true);
+        std::cout << prefix << "icosphere: " << vertexCount << " vertices in " << topologyTime << " ms" << std::endl;
+
+        // Kept between the planets of the resolution, as the buffers of a Planet
+        PlanetSurface surface;
+        initializeSurface(surface, *topology);
+
+        for (NamedTerrain const& planet : terrains) {
+            std::string const name = prefix + planet.name + "/";
+            double const displacement = milliseconds([&]() { displace(planet.terrain, *topology, surface, maxThreads); });
+            double const slopes = milliseconds([&]() { colorSlopes(planet.terrain, *topology, surface, maxThreads); });
+            double const normals = milliseconds([&]() { computeSurfaceNormals(*topology, surface); });
+            double const bounds = milliseconds([&]() { updateSurfaceBounds(*topology, surface); });
+            double const total = displacement + slopes + normals + bounds;
+
+            add(name + "displacement", displacement, "ms", true);
+            add(name + "slopes", slopes, "ms", true);
+            add(name + "normals", normals, "ms", true);
+            add(name + "bounds", bounds, "ms", true);
+            add(name + "vertices_per_second", vertexCount / (total / 1000.0), "vertices/s", false);
+            std::cout << name << " displacement " << displacement << " ms, slopes " << slopes << " ms, normals " << normals
+                << " ms, bounds " << bounds << " ms, " << vertexCount / (total / 1000.0) / 1e6 << " M vertices/s" << std::endl;
+        }
+
+        // Displacement and slopes of the first planet, the stages that use the worker threads
+        std::vector<unsigned int> threadCounts;
+        for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(maxThreads);
+        double singleThread = 0.0;
+        for (unsigned int threads : threadCounts) {
+            TerrainParameters const& terrain = terrains.front().terrain;
+            double const time = milliseconds([&]() {
+                displace(terrain, *topology, surface, threads);
+                colorSlopes(terrain, *topology, surface, threads);
+            });
+            if (threads == 1)
+                singleThread = time;
+            std::string const name = prefix + "scaling/threads=" + std::to_string(threads);
+            add(name, vertexCount / (time / 1000.0), "vertices/s", false);
+            std::cout << name << ": " << vertexCount / (time / 1000.0) / 1e6 << " M vertices/s, speedup "
+                << singleThread / time << std::endl;
+        }
+
+        double const peak = peakResidentMegabytes();
+        add(prefix + "peak_rss", peak, "MB", true);
+        std::cout << prefix << "peak_rss: " << peak << " MB" << std::endl;
+    }
+
+    if (!writeBenchmarkReport(commandLine.output, report)) {
+        std::cerr << "Cannot write " << commandLine.output << std::endl;
+        return 1;
+    }
+    std::cout << report.results.size() << " results written in " << commandLine.output << std::endl;
+    return 0;
+}
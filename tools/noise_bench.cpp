@@ -0,0 +1,192 @@
+// Throughput of the terrain noises in samples per second.
+//
+// Usage: noise_bench [--out report.json] [--min-time seconds] [--filter text] [planet.pbf...]
+//        noise_bench --compare baseline.json current.json [--threshold percent]
+//
+// Sweeps snoise3, perlinNoise and ridgeNoise over the octave counts, then evaluates the terrain of every planet
+// with its own parameters, by default every .pbf file of planets/. Each measure runs point by point ("scalar")
+// and through the batched functions ("batch"), on one thread and on every hardware thread. The comparison
+// exits with 1 when a result got worse by more than the threshold, 5% by default.
+
+#include "benchmark_report.hpp"
+#include "planet_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Evaluates the points [first, last) and returns a value depending on all of them, so that nothing is optimized out
+using Workload = std::function<float(size_t first, size_t last)>;
+
+struct BenchSettings {
+    double minTime = 0.25; // Seconds per repetition
+    int repetitions = 3;   // The best one is kept
+    std::string filter;
+};
+
+static volatile float sink = 0.0f;
+
+// Best throughput of the repetitions, the points being split between the threads
+static double samplesPerSecond(Workload const& workload, size_t points, unsigned int threads, BenchSettings const& settings) {
+    double best = 0.0;
+    for (int repetition = 0; repetition < settings.repetitions; repetition++) {
+        size_t samples = 0;
+        auto const start = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        do {
+            std::vector<std::thread> workers;
+            std::vector<float> results(threads);
+            for (unsigned int t = 0; t < threads; t++) {
+                size_t const first = points * t / threads;
+                size_t const last = points * (t + 1) / threads;
+                workers.push_back(std::thread([&, t, first, last]() { results[t] = workload(first, last); }));
+            }
+            for (std::thread& worker : workers)
+                worker.join();
+            for (float const result : results)
+                sink = sink + result;
+            samples += points;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < settings.minTime);
+        best = std::max(best, samples / elapsed);
+    }
+    return best;
+}
+
+// Deterministic directions spread over the unit sphere
+static std::vector<vcl::vec3> unitDirections(size_t count) {
+    std::vector<vcl::vec3> directions(count);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    auto const random = [&state]() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return float(state >> 40) / float(1 << 24);
+    };
+    for (vcl::vec3& direction : directions) {
+        float const z = 2.0f * random() - 1.0f;
+        float const angle = 2.0f * vcl::pi * random();
+        float const r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        direction = { r * std::cos(angle), r * std::sin(angle), z };
+    }
+    return directions;
+}
+
+int main(int argc, char** argv) {
+    BenchSettings settings;
+    BenchmarkCommandLine commandLine;
+    commandLine.output = "noise_bench.json";
+    bool const parsed = parseBenchmarkCommandLine(argc, argv, "[--min-time seconds] [--filter text]", [&settings](int argc, char** argv, int& i) {
+        std::string const argument = argv[i];
+        if (argument == "--min-time" && i + 1 < argc)
+            settings.minTime = std::atof(argv[++i]);
+        else if (argument == "--filter" && i + 1 < argc)
+            settings.filter = argv[++i];
+        else
+            return false;
+        return true;
+    }, commandLine);
+    if (!parsed)
+        return commandLine.exitCode;
+
+    BenchmarkReport report;
+    report.suite = "noise";
+    report.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts = { 1 };
+    if (report.threads > 1)
+        threadCounts.push_back(report.threads);
+
+    size_t const pointCount = 1 << 16;
+    std::vector<vcl::vec3> const directions = unitDirections(pointCount);
+
+    auto const run = [&](std::string const& name, Workload const& workload) {
+        for (unsigned int threads : threadCounts) {
+            std::string const fullName = name + "/threads=" + std::to_string(threads);
+            if (!settings.filter.empty() && fullName.find(settings.filter) == std::string::npos)
+                continue;
+            BenchmarkResult result;
+            result.name = fullName;
+            result.unit = "samples/s";
+            result.value = samplesPerSecond(workload, pointCount, threads, settings);
+            std::cout << fullName << ": " << result.value / 1e6 << " M samples/s" << std::endl;
+            report.results.push_back(result);
+        }
+    };
+
+    // Raw simplex noise, one sample per point
+    run("snoise3", [&](size_t first, size_t last) {
+        float sum = 0.0f;
+        for (size_t i = first; i < last; i++)
+            sum += float(snoise3(directions[i].x, directions[i].y, directions[i].z));
+        return sum;
+    });
+
+    // Octave sweep with the default parameters, a sample being a point with all its octaves
+    for (int octaves = 1; octaves <= 8; octaves++) {
+        perlin_noise_parameters parameters;
+        parameters.octave = octaves;
+        std::string const suffix = "/octaves=" + std::to_string(octaves);
+        run("perlinNoise" + suffix + "/scalar", [&](size_t first, size_t last) {
+            float sum = 0.0f;
+            for (size_t i = first; i < last; i++)
+                sum += perlinNoise(directions[i], parameters);
+            return sum;
+        });
+        run("perlinNoise" + suffix + "/batch", [&](size_t first, size_t last) {
+            std::vector<float> values(last - first);
+            perlinNoise(directions.data() + first, values.data(), values.size(), parameters);
+            float sum = 0.0f;
+            for (float const value : values)
+                sum += value;
+            return sum;
+        });
+        run("ridgeNoise" + suffix + "/scalar", [&](size_t first, size_t last) {
+            float sum = 0.0f;
+            for (size_t i = first; i < last; i++)
+                sum += ridgeNoise(directions[i], parameters, 2.0f);
+            return sum;
+        });
+        run("ridgeNoise" + suffix + "/batch", [&](size_t first, size_t last) {
+            std::vector<float> values(last - first);
+            ridgeNoise(directions.data() + first, values.data(), values.size(), parameters, 2.0f);
+            float sum = 0.0f;
+            for (float const value : values)
+                sum += value;
+            return sum;
+        });
+    }
+
+    // Whole surface of each planet, as Planet::getPlanetRadiusAt
+    for (std::string const& path : commandLine.planets) {
+        TerrainParameters terrain;
+        if (!readTerrainParameters(path, terrain)) {
+            std::cerr << "Cannot read " << path << ", skipped" << std::endl;
+            continue;
+        }
+        std::string const planet = planetNameFromPath(path);
+        run("terrain/" + planet + "/scalar", [&](size_t first, size_t last) {
+            float sum = 0.0f;
+            for (size_t i = first; i < last; i++)
+                sum += terrainPosition(terrain, directions[i]).x;
+            return sum;
+        });
+        run("terrain/" + planet + "/batch", [&](size_t first, size_t last) {
+            std::vector<vcl::vec3> positions(last - first);
+            terrainPositions(terrain, directions.data() + first, positions.data(), positions.size());
+            float sum = 0.0f;
+            for (vcl::vec3 const& position : positions)
+                sum += position.x;
+            return sum;
+        });
+    }
+
+    if (!writeBenchmarkReport(commandLine.output, report)) {
+        std::cerr << "Cannot write " << commandLine.output << std::endl;
+        return 1;
+    }
+    std::cout << report.results.size() << " results written in " << commandLine.output << std::endl;
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Offline generation of the planet surfaces, loaded by the viewer instead of generating them at startup.
+//
+// Usage: planet_bake [--resolution 500[,250...]] [--workers n] [--out bake] [--heightfield WxH] [--anchors n]
+//                    [--shard i/n] [--force] planet.pbf...
+//
+// Each planet and resolution is a job, generated with every worker thread and written in
+// out/Name_division.pbake. A bake whose terrain, division and options are unchanged is skipped unless --force
+// is given.
+// --shard i/n only runs the jobs whose index modulo n is i, so n processes (or machines sharing the output
+// directory) bake the whole list together. The viewer reads the bakes of its own resolution from "bake".
+
+#include "planet_bake.hpp"
+#include "planet_file.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+struct BakeSettings {
+    std::vector<unsigned int> resolutions = { 500 }; // The default resolution of the viewer
+    unsigned int workers = std::max(1u, std::thread::hardware_concurrency());
+    std::string directory = "bake";
+    unsigned int heightfieldWidth = 0;
+    unsigned int heightfieldHeight = 0;
+    unsigned int anchorCount = 0;
+    unsigned int shard = 0;
+    unsigned int shardCount = 1;
+    bool force = false;
+};
+
+// Steepest ground where a plant can grow, on the scale of terrainSlope
+static float const anchorMaxSteepness = 0.5f;
+
+static std::vector<unsigned int> parseList(std::string const& text) {
+    std::vector<unsigned int> values;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (std::atoi(item.c_str()) > 0)
+            values.push_back((unsigned int)std::atoi(item.c_str()));
+    return values;
+}
+
+// "a<separator>b" with both values positive
+static bool parsePair(std::string const& text, char separator, unsigned int& a, unsigned int& b) {
+    size_t const position = text.find(separator);
+    if (position == std::string::npos)
+        return false;
+    int const first = std::atoi(text.substr(0, position).c_str());
+    int const second = std::atoi(text.substr(position + 1).c_str());
+    if (first < 0 || second <= 0)
+        return false;
+    a = (unsigned int)first;
+    b = (unsigned int)second;
+    return true;
+}
+
+static bool upToDate(std::string const& path, IcosphereTopology const& topology, uint64_t key, BakeSettings const& settings) {
+    MappedFile const file(path);
+    PlanetBake bake;
+    return file.valid() && parsePlanetBake(file.data(), file.size(), topology, key, bake)
+        && bake.heightfieldWidth == settings.heightfieldWidth && bake.heightfieldHeight == settings.heightfieldHeight
+        && bake.anchorRequest == settings.anchorCount;
+}
+
+int main(int argc, char** argv) {
+    BakeSettings settings;
+    std::vector<std::string> planets;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        std::string const argument = argv[i];
+        if (argument == "--resolution" && i + 1 < argc)
+            settings.resolutions = parseList(argv[++i]);
+        else if (argument == "--workers" && i + 1 < argc)
+            settings.workers = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--out" && i + 1 < argc)
+            settings.directory = argv[++i];
+        else if (argument == "--heightfield" && i + 1 < argc)
+            valid = parsePair(argv[++i], 'x', settings.heightfieldWidth, settings.heightfieldHeight) && settings.heightfieldWidth > 0;
+        else if (argument == "--anchors" && i + 1 < argc)
+            settings.anchorCount = (unsigned int)std::max(0, std::atoi(argv[++i]));
+        else if (argument == "--shard" && i + 1 < argc)
+            valid = parsePair(argv[++i], '/', settings.shard, settings.shardCount) && settings.shard < settings.shardCount;
+        else if (argument == "--force")
+            settings.force = true;
+        else if (argument.size() > 4 && argument.compare(argument.size() - 4, 4, ".pbf") == 0)
+            planets.push_back(argument);
+        else
+            valid = false;
+    }
+    if (!valid || planets.empty() || settings.resolutions.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--resolution 500[,250...]] [--workers n] [--out bake] [--heightfield WxH] [--anchors n]" << std::endl
+            << "       [--shard i/n] [--force] planet.pbf..." << std::endl;
+        return 1;
+    }
+
+    createBakeDirectory(settings.directory);
+
+    // Every shard enumerates the same jobs in the same order
+    int baked = 0, skipped = 0, failed = 0;
+    size_t job = 0;
+    for (unsigned int resolution : settings.resolutions) {
+        std::shared_ptr<IcosphereTopology const> topology;
+        for (std::string const& path : planets) {
+            if (job++ % settings.shardCount != settings.shard)
+                continue;
+            if (!topology)
+                topology = icosphere_topology(resolution, LOW_RES_DIVISION, TRIANGLES_PER_CLUSTER);
+
+            TerrainParameters terrain;
+            if (!readTerrainParameters(path, terrain)) {
+                std::cerr << "Cannot read " << path << std::endl;
+                failed++;
+                continue;
+            }
+            std::string const name = planetNameFromPath(path);
+            uint64_t const key = terrainBakeKey(terrain);
+            std::string const output = planetBakePath(settings.directory, name, topology->division);
+            if (!settings.force && upToDate(output, *topology, key, settings)) {
+                std::cout << output << " is up to date" << std::endl;
+                skipped++;
+                continue;
+            }
+
+            auto const start = std::chrono::steady_clock::now();
+            PlanetBake bake;
+            initializeSurface(bake.surface, *topology);
+            generateSurface(terrain, *topology, bake.surface, settings.workers);
+            if (settings.heightfieldWidth > 0) {
+                bake.heightfieldWidth = settings.heightfieldWidth;
+                bake.heightfieldHeight = settings.heightfieldHeight;
+                bake.heightfield = surfaceHeightfield(terrain, bake.heightfieldWidth, bake.heightfieldHeight);
+            }
+            bake.anchors = vegetationAnchors(terrain, settings.anchorCount, anchorMaxSteepness, 1);
+            bake.anchorRequest = settings.anchorCount;
+
+            std::vector<unsigned char> const data = serializePlanetBake(bake, *topology, key);
+            if (!writeFileAtomically(output, data)) {
+                std::cerr << "Cannot write " << output << std::endl;
+                failed++;
+                continue;
+            }
+            double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << path << " -> " << output << " (" << topology->directions.size() << " vertices, "
+                << data.size() / 1024 << " KB, " << seconds << " s)" << std::endl;
+            baked++;
+        }
+    }
+
+    std::cout << baked << " baked, " << skipped << " up to date, " << failed << " failed";
+    if (settings.shardCount > 1)
+        std::cout << " in shard " << settings.shard << "/" << settings.shardCount;
+    std::cout << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// Packs the planets of the solar system, their orbits and their bakes into the single file the viewer maps.
+//
+// Usage: system_pack [--scene planets/solar_system.scene] [--resolution 500] [--bake bake] [--out planets/solar_system.psys]
+//        system_pack --list pack.psys|planet.pbf
+//
+// The bodies and their orbits are read from the scene, their parameters from the .pbf files next to it. The bake of a
+// planet is embedded when bake/Name_division.pbake exists, the viewer checks its terrain key when loading it and
+// generates the planet when it is stale. --list prints the planets and the fields of a pack or a planet file.
+
+#include "solar_system.hpp"
+#include "system_pack.hpp"
+#include "planet_file.hpp"
+#include "planet_bake.hpp"
+#include "icosphere.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+static void listFields(unsigned char const* data, size_t size) {
+    forEachField(data, size, [](uint16_t id, unsigned char const*, uint16_t length) {
+        char const* const name = planetFieldName(id);
+        std::cout << "    " << id << " " << (name != nullptr ? name : "(unknown)") << " " << length << " B" << std::endl;
+    });
+}
+
+static int list(std::string const& path) {
+    MappedFile const file(path);
+    std::vector<SystemPlanet> planets;
+    if (!file.valid() || !parseSystemPack(file.data(), file.size(), planets)) {
+        // Untagged planet file of the first versions
+        planets.resize(1);
+        planets[0].name = path;
+        planets[0].hasOrbit = false;
+        if (!readPlanetFile(path, planets[0].parameters)) {
+            std::cerr << "Cannot read " << path << std::endl;
+            return 1;
+        }
+    }
+    std::cout << path << ": " << planets.size() << " planets, " << file.size() / 1024 << " KB" << std::endl;
+    for (SystemPlanet const& planet : planets) {
+        std::cout << planet.name;
+        if (planet.hasOrbit)
+            std::cout << ", division " << planet.orbit.division << ", parent " << planet.orbit.parent;
+        if (planet.bake != nullptr)
+            std::cout << ", bake " << planet.bakeSize / 1024 << " KB";
+        std::cout << std::endl;
+        std::vector<unsigned char> fields;
+        writePlanetFields(planet.parameters, fields);
+        listFields(fields.data(), fields.size());
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int resolution = 500; // The default resolution of the viewer
+    std::string scene = solarSystemScenePath;
+    std::string bakeDirectory;
+    std::string output = solarSystemPackPath;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        std::string const argument = argv[i];
+        if (argument == "--list" && i + 1 < argc)
+            return list(argv[++i]);
+        else if (argument == "--scene" && i + 1 < argc)
+            scene = argv[++i];
+        else if (argument == "--resolution" && i + 1 < argc)
+            valid = (resolution = std::atoi(argv[++i])) > 0;
+        else if (argument == "--bake" && i + 1 < argc)
+            bakeDirectory = argv[++i];
+        else if (argument == "--out" && i + 1 < argc)
+            output = argv[++i];
+        else
+            valid = false;
+    }
+    if (!valid) {
+        std::cerr << "Usage: " << argv[0] << " [--scene " << solarSystemScenePath << "] [--resolution 500] [--bake bake] [--out " << solarSystemPackPath << "]" << std::endl
+            << "       " << argv[0] << " --list pack.psys|planet.pbf" << std::endl;
+        return 1;
+    }
+
+    std::vector<SystemPlanet> planets;
+    if (!readSystemScene(scene, resolution, planets))
+        return 1;
+    // Kept mapped until the pack is written
+    std::vector<MappedFile> bakes;
+    bakes.reserve(planets.size());
+    for (SystemPlanet& planet : planets) {
+        if (bakeDirectory.empty())
+            break;
+        unsigned int const division = (unsigned int)planet.orbit.division;
+        unsigned int const nestedDivision = icosphere_nested_division(division, icosphere_lod_step(division, LOW_RES_DIVISION));
+        std::string const path = planetBakePath(bakeDirectory, planet.name, nestedDivision);
+        bakes.emplace_back(path);
+        if (!bakes.back().valid()) {
+            std::cout << planet.name << ": no bake in " << path << std::endl;
+            continue;
+        }
+        planet.bake = bakes.back().data();
+        planet.bakeSize = bakes.back().size();
+    }
+
+    std::vector<unsigned char> const data = writeSystemPack(planets);
+    if (!writeFileAtomically(output, data)) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    std::cout << planets.size() << " planets -> " << output << " (" << data.size() / 1024 << " KB)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,42 @@
+// Offline conversion of PNG textures into baked containers with their mip chain.
+// The application loads "name.ptex" instead of "name.png" when it exists next to it.
+//
+// Usage: texture_bake [--rgba8] image.png...
+//   BC1 by default, --rgba8 keeps the pixels uncompressed (for textures using their alpha).
+
+#include "texture_container.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    TextureFormat format = TextureFormat::BC1;
+    int converted = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--rgba8") == 0) {
+            format = TextureFormat::RGBA8;
+            continue;
+        }
+
+        std::string const input = argv[i];
+        std::string const output = bakedTexturePath(input);
+        vcl::image_raw const image = vcl::image_load_png(input);
+        std::vector<unsigned char> const file = bakeTextureContainer(image, format);
+
+        std::ofstream stream(output, std::ios::binary);
+        stream.write(reinterpret_cast<char const*>(file.data()), std::streamsize(file.size()));
+        if (!stream) {
+            std::cerr << "Cannot write " << output << std::endl;
+            return 1;
+        }
+        std::cout << input << " -> " << output << " (" << image.width << "x" << image.height << ", " << file.size() / 1024 << " KB)" << std::endl;
+        converted++;
+    }
+
+    if (converted == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--rgba8] image.png..." << std::endl;
+        return 1;
+    }
+    return 0;
+}